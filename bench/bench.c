@@ -0,0 +1,438 @@
+/*
+ * bench.c - Microbenchmarks for the sampling and rendering hot paths
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ *
+ * Each benchmark reports nanoseconds, system calls and heap allocations
+ * per operation. System calls are counted by interposing the libc
+ * wrappers the code under test uses; allocations by wrapping malloc and
+ * friends (glibc only, "-" elsewhere). The fake backend returns fixed
+ * values without any system calls, so those results are deterministic
+ * and comparable across machines; the native backend is measured too.
+ */
+
+#include "display.h"
+#include "format.h"
+#include "frame.h"
+#include "memory.h"
+#include "sampler.h"
+#include "ticker.h"
+#include "utils.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+    #include <mach/mach.h>
+    #include <sys/sysctl.h>
+#endif
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define BENCH_MIN_TIME   (200 * NSEC_PER_MSEC) /* Time per benchmark */
+#define BENCH_START_ITER 64                    /* First calibration round */
+
+/*
+ * ============================================================================
+ * System Call Counting
+ * ============================================================================
+ */
+
+static unsigned long long g_syscalls = 0;
+
+/* Look up the libc definition that our wrapper shadows */
+static void *next_symbol(const char *name)
+{
+    void *sym = dlsym(RTLD_NEXT, name);
+    if (sym == NULL)
+    {
+        fprintf(stderr, "Error: Cannot resolve %s\n", name);
+        abort();
+    }
+    return sym;
+}
+
+/*
+ * ISO C has no conversion from void * to a function pointer; copy the
+ * bits instead, which is what POSIX guarantees dlsym() results allow.
+ */
+#define RESOLVE(var, name)                                                     \
+    do                                                                         \
+    {                                                                          \
+        if ((var) == NULL)                                                     \
+        {                                                                      \
+            void *sym_ = next_symbol(name);                                    \
+            memcpy(&(var), &sym_, sizeof(var));                                \
+        }                                                                      \
+    } while (0)
+
+int open(const char *path, int flags, ...)
+{
+    static int (*real)(const char *, int, ...);
+    mode_t mode = 0;
+
+    if (flags & O_CREAT)
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = (mode_t)va_arg(ap, int);
+        va_end(ap);
+    }
+
+    RESOLVE(real, "open");
+    g_syscalls++;
+    return real(path, flags, mode);
+}
+
+int close(int fd)
+{
+    static int (*real)(int);
+
+    RESOLVE(real, "close");
+    g_syscalls++;
+    return real(fd);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    static ssize_t (*real)(int, void *, size_t);
+
+    RESOLVE(real, "read");
+    g_syscalls++;
+    return real(fd, buf, count);
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+    static ssize_t (*real)(int, void *, size_t, off_t);
+
+    RESOLVE(real, "pread");
+    g_syscalls++;
+    return real(fd, buf, count, offset);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    static ssize_t (*real)(int, const void *, size_t);
+
+    RESOLVE(real, "write");
+    g_syscalls++;
+    return real(fd, buf, count);
+}
+
+#ifdef __APPLE__
+int sysctl(int *name, u_int namelen, void *oldp, size_t *oldlenp, void *newp,
+           size_t newlen)
+{
+    static int (*real)(int *, u_int, void *, size_t *, void *, size_t);
+
+    RESOLVE(real, "sysctl");
+    g_syscalls++;
+    return real(name, namelen, oldp, oldlenp, newp, newlen);
+}
+
+kern_return_t host_statistics64(host_t host, host_flavor_t flavor,
+                                host_info64_t info,
+                                mach_msg_type_number_t *count)
+{
+    static kern_return_t (*real)(host_t, host_flavor_t, host_info64_t,
+                                 mach_msg_type_number_t *);
+
+    RESOLVE(real, "host_statistics64");
+    g_syscalls++;
+    return real(host, flavor, info, count);
+}
+#endif
+
+/*
+ * ============================================================================
+ * Allocation Counting
+ * ============================================================================
+ */
+
+static unsigned long long g_allocs = 0;
+
+#ifdef __GLIBC__
+    #define COUNT_ALLOCS 1
+
+/* glibc exports its allocator under these names, so no dlsym() is needed */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    g_allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    g_allocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    g_allocs++;
+    return __libc_realloc(ptr, size);
+}
+#else
+    #define COUNT_ALLOCS 0
+#endif
+
+/*
+ * ============================================================================
+ * Fake Backend
+ * ============================================================================
+ */
+
+#define FAKE_GIB (1024ULL * 1024 * 1024)
+
+static int fake_init(void)
+{
+    return 0;
+}
+
+static size_t fake_page_size(void)
+{
+    return 16384;
+}
+
+static uint64_t fake_total_memory(void)
+{
+    return 16 * FAKE_GIB;
+}
+
+static int fake_memory_info(mem_info_t *mem)
+{
+    mem->total      = 16 * FAKE_GIB;
+    mem->free       = 2 * FAKE_GIB;
+    mem->active     = 5 * FAKE_GIB;
+    mem->inactive   = 4 * FAKE_GIB;
+    mem->wired      = 2 * FAKE_GIB;
+    mem->compressed = 1 * FAKE_GIB;
+    mem->cached     = 1 * FAKE_GIB;
+    mem->app_memory = 5 * FAKE_GIB;
+    mem->used       = mem->active + mem->wired + mem->compressed;
+    mem->available  = mem->free + mem->inactive + mem->cached;
+    mem->shared     = mem->compressed;
+    mem->buff_cache = mem->cached + mem->inactive;
+    return 0;
+}
+
+static int fake_swap_info(swap_info_t *swap)
+{
+    swap->total = 2 * FAKE_GIB;
+    swap->used  = FAKE_GIB / 2;
+    swap->free  = swap->total - swap->used;
+    return 0;
+}
+
+static int fake_vm_counters(vm_counters_t *counters)
+{
+    memset(counters, 0, sizeof(vm_counters_t));
+    return 0;
+}
+
+static const memory_backend_t fake_backend = {
+    .name          = "fake",
+    .init          = fake_init,
+    .cleanup       = NULL,
+    .page_size     = fake_page_size,
+    .total_memory  = fake_total_memory,
+    .memory_info   = fake_memory_info,
+    .swap_info     = fake_swap_info,
+    .vm_counters   = fake_vm_counters,
+    .pressure_info = NULL,
+};
+
+/*
+ * ============================================================================
+ * Benchmarks
+ * ============================================================================
+ */
+
+/* Results are written here so the compiler cannot drop the work */
+static volatile uint64_t g_sink;
+
+static FILE           *g_out;
+static system_memory_t g_sample;
+static options_t       g_opts;
+static sampler_t       g_sampler;
+static frame_t         g_frame;
+
+static void bench_get_system_memory(void)
+{
+    get_system_memory(&g_sample);
+    g_sink = g_sample.mem.used;
+}
+
+static void bench_get_memory_info(void)
+{
+    get_memory_info(&g_sample.mem);
+    g_sink = g_sample.mem.used;
+}
+
+static void bench_sampler_sample(void)
+{
+    /* Bound to the backend active on first use, the native one */
+    if (g_sampler.backend == NULL && sampler_init(&g_sampler, 0) != 0)
+    {
+        abort();
+    }
+
+    sampler_sample(&g_sampler, &g_sample);
+    g_sink = g_sample.mem.used;
+}
+
+static void bench_convert_unit(void)
+{
+    double value = convert_unit(g_sink | 123456789, UNIT_MEBI);
+    g_sink       = (uint64_t)value;
+}
+
+static void bench_format_human(void)
+{
+    char buf[32];
+
+    g_sink = format_human(g_sample.mem.used + g_sink % 7, buf, sizeof(buf));
+}
+
+static void bench_print_memory_info(void)
+{
+    print_memory_info(&g_sample, &g_opts);
+}
+
+static void bench_render_json(void)
+{
+    frame_reset(&g_frame);
+    render_json(&g_frame, &g_sample, &g_opts);
+    g_sink = g_frame.len;
+}
+
+/*
+ * ============================================================================
+ * Harness
+ * ============================================================================
+ */
+
+typedef struct
+{
+    const char *name;
+    void (*fn)(void);
+    int native; /* Uses the platform backend rather than the fake one */
+} bench_t;
+
+static const bench_t benches[] = {
+    {"get_system_memory (fake)", bench_get_system_memory, 0},
+    {"get_memory_info (fake)", bench_get_memory_info, 0},
+    {"get_system_memory (native)", bench_get_system_memory, 1},
+    {"get_memory_info (native)", bench_get_memory_info, 1},
+    {"sampler_sample (native)", bench_sampler_sample, 1},
+    {"convert_unit", bench_convert_unit, 0},
+    {"format_human", bench_format_human, 0},
+    {"print_memory_info -h > /dev/null", bench_print_memory_info, 0},
+    {"render_json", bench_render_json, 0},
+};
+
+/* Run fn until it has taken at least BENCH_MIN_TIME and report per call */
+static void run_bench(const bench_t *bench)
+{
+    uint64_t           iterations = BENCH_START_ITER;
+    uint64_t           elapsed;
+    unsigned long long syscalls;
+    unsigned long long allocs;
+
+    memory_set_backend(bench->native ? NULL : &fake_backend);
+    memory_init();
+
+    /* Warm up: first calls open descriptors and fault in pages */
+    for (int i = 0; i < 16; i++)
+    {
+        bench->fn();
+    }
+
+    for (;;)
+    {
+        syscalls = g_syscalls;
+        allocs   = g_allocs;
+
+        uint64_t start = monotonic_ns();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            bench->fn();
+        }
+        elapsed = monotonic_ns() - start;
+
+        syscalls = g_syscalls - syscalls;
+        allocs   = g_allocs - allocs;
+
+        if (elapsed >= BENCH_MIN_TIME)
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    fprintf(g_out, "%-34s %12llu %12.1f %12.2f", bench->name,
+           (unsigned long long)iterations, (double)elapsed / (double)iterations,
+           (double)syscalls / (double)iterations);
+    if (COUNT_ALLOCS)
+    {
+        fprintf(g_out, " %12.2f\n", (double)allocs / (double)iterations);
+    }
+    else
+    {
+        fprintf(g_out, " %12s\n", "-");
+    }
+    fflush(g_out);
+}
+
+int main(void)
+{
+    /*
+     * print_memory_info() writes to stdout, which goes to /dev/null for
+     * the whole run; results go to a copy of the original stdout.
+     */
+    int results = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+
+    if (results < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0 ||
+        (g_out = fdopen(results, "w")) == NULL)
+    {
+        perror("bench");
+        return EXIT_FAILURE;
+    }
+    close(null_fd);
+
+    init_options(&g_opts);
+    g_opts.unit = UNIT_HUMAN;
+
+    memory_set_backend(&fake_backend);
+    get_system_memory(&g_sample);
+
+    fprintf(g_out, "%-34s %12s %12s %12s %12s\n", "benchmark", "iterations",
+            "ns/op", "syscalls/op", "allocs/op");
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        run_bench(&benches[i]);
+    }
+
+    memory_set_backend(NULL);
+    memory_cleanup();
+    fclose(g_out);
+
+    return EXIT_SUCCESS;
+}
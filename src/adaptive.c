@@ -0,0 +1,165 @@
+/*
+ * adaptive.c - Sampling that speeds up while memory is moving
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "adaptive.h"
+
+#include "utils.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+static uint64_t distance(uint64_t a, uint64_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/*
+ * Whether the sample moved more than delta. The change is scaled to one
+ * slow interval, so a steady climb keeps counting as movement when
+ * samples come ten times as often and each sees a tenth of it.
+ */
+static int moved(const adaptive_t *adaptive, const system_memory_t *sys_mem)
+{
+    uint64_t elapsed = sys_mem->timestamp - adaptive->last_time;
+    uint64_t change  = distance(sys_mem->mem.used, adaptive->last_used);
+    uint64_t avail   = distance(sys_mem->mem.available, adaptive->last_avail);
+    uint64_t swap    = distance(sys_mem->swap.used, adaptive->last_swap);
+
+    change = avail > change ? avail : change;
+    change = swap > change ? swap : change;
+
+    if (elapsed == 0)
+    {
+        return 0;
+    }
+
+    return (double)change * (double)adaptive->slow / (double)elapsed >=
+           (double)adaptive->delta;
+}
+
+static void set_mode(adaptive_t *adaptive, int fast)
+{
+    if (adaptive->fast_mode != fast)
+    {
+        adaptive->fast_mode = fast;
+        adaptive->switches++;
+    }
+}
+
+/*
+ * ============================================================================
+ * Adaptive Functions
+ * ============================================================================
+ */
+
+void adaptive_init(adaptive_t *adaptive, uint64_t slow, uint64_t fast,
+                   uint64_t delta)
+{
+    memset(adaptive, 0, sizeof(adaptive_t));
+
+    if (fast == 0)
+    {
+        fast = slow / ADAPTIVE_FAST_DIVISOR;
+    }
+    if (fast < TICKER_MIN_INTERVAL)
+    {
+        fast = TICKER_MIN_INTERVAL;
+    }
+
+    adaptive->slow       = slow;
+    adaptive->fast       = fast < slow ? fast : slow;
+    adaptive->delta      = delta;
+    adaptive->trigger_fd = adaptive_trigger_open();
+}
+
+uint64_t adaptive_update(adaptive_t *adaptive, const system_memory_t *sys_mem)
+{
+    if (adaptive->has_last && moved(adaptive, sys_mem))
+    {
+        adaptive->fast_until = sys_mem->timestamp + adaptive->slow;
+    }
+
+    adaptive->has_last   = 1;
+    adaptive->last_time  = sys_mem->timestamp;
+    adaptive->last_used  = sys_mem->mem.used;
+    adaptive->last_avail = sys_mem->mem.available;
+    adaptive->last_swap  = sys_mem->swap.used;
+
+    set_mode(adaptive, sys_mem->timestamp < adaptive->fast_until);
+
+    return adaptive->fast_mode ? adaptive->fast : adaptive->slow;
+}
+
+int64_t adaptive_wait(adaptive_t *adaptive, ticker_t *ticker)
+{
+    uint64_t interval = adaptive->fast_mode ? adaptive->fast : adaptive->slow;
+
+    /* Keep the last tick as the reference, so switching adds no drift */
+    if (ticker->interval != interval)
+    {
+        ticker_reschedule(ticker, interval,
+                          ticker->deadline - ticker->interval);
+    }
+
+    if (adaptive->trigger_fd < 0)
+    {
+        return ticker_wait(ticker);
+    }
+
+    for (;;)
+    {
+        struct pollfd pfd = {.fd = adaptive->trigger_fd, .events = POLLPRI};
+
+        int ready = poll(&pfd, 1, ticker_timeout_ms(ticker));
+        if (ready < 0)
+        {
+            return errno == EINTR ? -1 : ticker_wait(ticker);
+        }
+
+        if (ready > 0 && (pfd.revents & POLLPRI))
+        {
+            uint64_t now = monotonic_ns();
+
+            adaptive->triggers++;
+            adaptive->fast_until = now + adaptive->slow;
+            set_mode(adaptive, 1);
+            ticker_reschedule(ticker, adaptive->fast, now);
+            ticker->ticks++;
+            return 0;
+        }
+
+        if (ready > 0)
+        {
+            /* POLLERR: the trigger went away; carry on with the timer */
+            adaptive_cleanup(adaptive);
+            return ticker_wait(ticker);
+        }
+
+        int64_t missed = ticker_advance(ticker);
+        if (missed >= 0)
+        {
+            return missed;
+        }
+    }
+}
+
+void adaptive_cleanup(adaptive_t *adaptive)
+{
+    if (adaptive->trigger_fd >= 0)
+    {
+        close(adaptive->trigger_fd);
+        adaptive->trigger_fd = -1;
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * adaptive.h - Sampling that speeds up while memory is moving
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include "memory.h"
+#include "ticker.h"
+
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define ADAPTIVE_FAST_DIVISOR  10 /* Default fast interval: slow / 10 */
+#define ADAPTIVE_DELTA_PERCENT 1  /* Default movement: 1% of total memory */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Adaptive sampling state
+ *
+ * Samples every slow interval while used, available and swap used stay
+ * within delta bytes of the previous sample (scaled to one slow
+ * interval), and every fast interval from the first sample that moves
+ * more until one slow interval has passed without movement. Where the
+ * kernel supports it (Linux PSI triggers) a burst of memory stalls also
+ * wakes the loop at once, without waiting for the next deadline.
+ */
+typedef struct
+{
+    uint64_t slow;       /* Interval while memory is steady, ns */
+    uint64_t fast;       /* Interval while memory is moving, ns */
+    uint64_t delta;      /* Movement per slow interval that counts, bytes */
+    uint64_t fast_until; /* Monotonic time to stay fast until */
+    int      fast_mode;  /* Currently sampling at the fast interval */
+    int      trigger_fd; /* Pressure trigger to poll, or -1 */
+    int      has_last;   /* last_* hold a previous sample */
+    uint64_t last_time;  /* Monotonic time of the previous sample */
+    uint64_t last_used;  /* Its used memory, bytes */
+    uint64_t last_avail; /* Its available memory, bytes */
+    uint64_t last_swap;  /* Its swap used, bytes */
+    uint64_t switches;   /* Changes between slow and fast */
+    uint64_t triggers;   /* Wake-ups by the pressure trigger */
+} adaptive_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Start adaptive sampling at the slow interval
+ *
+ * @param adaptive  State to initialize
+ * @param slow      Interval while memory is steady, ns
+ * @param fast      Interval while memory is moving, ns (0 = slow / 10)
+ * @param delta     Movement per slow interval that counts, bytes
+ */
+void adaptive_init(adaptive_t *adaptive, uint64_t slow, uint64_t fast,
+                   uint64_t delta);
+
+/**
+ * Feed a sample and pick the interval to the next one
+ *
+ * @param adaptive  Adaptive state
+ * @param sys_mem   Sample just taken
+ * @return          Interval to use from now on, ns
+ */
+uint64_t adaptive_update(adaptive_t *adaptive, const system_memory_t *sys_mem);
+
+/**
+ * Sleep until the ticker's next deadline or a pressure trigger
+ *
+ * Moves the ticker to the interval chosen by adaptive_update() first.
+ * A trigger counts as a tick reached now: the loop samples at once and
+ * keeps sampling at the fast interval from there.
+ *
+ * @param adaptive  Adaptive state
+ * @param ticker    Ticker driving the loop
+ * @return          As ticker_wait(): deadlines missed, or -1 if a signal
+ *                  interrupted the sleep
+ */
+int64_t adaptive_wait(adaptive_t *adaptive, ticker_t *ticker);
+
+/**
+ * Release the pressure trigger
+ *
+ * @param adaptive  Adaptive state
+ */
+void adaptive_cleanup(adaptive_t *adaptive);
+
+/**
+ * Register for pressure notifications (platform-specific)
+ *
+ * @return          Descriptor that polls POLLPRI when memory stalls pile
+ *                  up, or -1 if the platform or kernel has none
+ */
+int adaptive_trigger_open(void);
+
+#endif /* ADAPTIVE_H */
@@ -0,0 +1,23 @@
+/*
+ * adaptive_darwin.c - Pressure triggers for adaptive sampling on macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "adaptive.h"
+
+/*
+ * ============================================================================
+ * Trigger Functions
+ * ============================================================================
+ */
+
+/*
+ * macOS delivers pressure changes only through dispatch sources, not a
+ * pollable descriptor; adaptive sampling relies on the deltas alone.
+ */
+int adaptive_trigger_open(void)
+{
+    return -1;
+}
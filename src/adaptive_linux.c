@@ -0,0 +1,52 @@
+/*
+ * adaptive_linux.c - Pressure stall triggers for adaptive sampling
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "adaptive.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define TRIGGER_PATH "/proc/pressure/memory"
+
+/*
+ * 200 ms of some-stall within a 2 s window: a tenth of the time, the
+ * same share ALERT_DEFAULT_STALL alerts on. Unprivileged processes may
+ * only register windows that are a multiple of 2 s (Linux 6.5+); older
+ * kernels require CAP_SYS_RESOURCE for any trigger.
+ */
+#define TRIGGER_SPEC "some 200000 2000000"
+
+/*
+ * ============================================================================
+ * Trigger Functions
+ * ============================================================================
+ */
+
+int adaptive_trigger_open(void)
+{
+    int fd = open(TRIGGER_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    /* The trigger lives as long as the descriptor */
+    if (write(fd, TRIGGER_SPEC, strlen(TRIGGER_SPEC) + 1) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
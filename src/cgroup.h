@@ -0,0 +1,67 @@
+/*
+ * cgroup.h - Container-aware memory accounting from cgroup v2
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include "memory.h"
+
+#include <stddef.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define CGROUP_PATH_MAX  4096 /* Longest cgroup directory accepted */
+#define CGROUP_MAX_DEPTH 32   /* Ancestors whose memory.max is followed */
+
+/*
+ * ============================================================================
+ * Backend
+ * ============================================================================
+ */
+
+/*
+ * Reports one cgroup's memory instead of the host's: total is the
+ * tightest memory.max along the path to the root, used and cached come
+ * from memory.current and memory.stat, swap from memory.swap.*. Without
+ * a limit the host's totals are used. The control files stay open
+ * between samples.
+ */
+#ifdef __linux__
+extern const memory_backend_t memory_backend_cgroup;
+#endif
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Find where the cgroup v2 hierarchy is mounted
+ *
+ * @param buf       Buffer for the mount point
+ * @param size      Size of buf
+ * @return          0 on success, -1 if there is no cgroup2 mount
+ */
+int cgroup_mount(char *buf, size_t size);
+
+/**
+ * Switch memory sampling to a cgroup
+ *
+ * Selects memory_backend_cgroup and initializes it, so a missing cgroup
+ * or memory controller is reported before sampling starts.
+ *
+ * @param path      Cgroup directory, or NULL for this process's own
+ * @return          0 on success, -1 on error
+ */
+int cgroup_select(const char *path);
+
+#endif /* CGROUP_H */
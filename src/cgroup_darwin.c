@@ -0,0 +1,32 @@
+/*
+ * cgroup_darwin.c - Container-aware memory accounting, unavailable on macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "cgroup.h"
+
+#include <stdio.h>
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+/* macOS has no cgroups; containers there run inside a Linux VM */
+int cgroup_mount(char *buf, size_t size)
+{
+    (void)buf;
+    (void)size;
+    return -1;
+}
+
+int cgroup_select(const char *path)
+{
+    (void)path;
+
+    fprintf(stderr, "Error: --cgroup is only supported on Linux\n");
+    return -1;
+}
@@ -0,0 +1,670 @@
+/*
+ * cgroup_linux.c - Container-aware memory accounting from cgroup v2
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "cgroup.h"
+#include "procfs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define MOUNTINFO_PATH   "/proc/self/mountinfo"
+#define SELF_CGROUP_PATH "/proc/self/cgroup"
+#define STAT_BUF_SIZE    8192
+#define VALUE_BUF_SIZE   64
+#define PSI_BUF_SIZE     256
+
+/* A limit file holding "max" */
+#define CGROUP_UNLIMITED UINT64_MAX
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Raw memory.stat values we care about, in bytes or events */
+typedef struct
+{
+    uint64_t anon;
+    uint64_t file;
+    uint64_t kernel;
+    uint64_t kernel_stack;
+    uint64_t pagetables;
+    uint64_t shmem;
+    uint64_t slab_reclaimable;
+    uint64_t slab_unreclaimable;
+    uint64_t active_anon;
+    uint64_t inactive_anon;
+    uint64_t active_file;
+    uint64_t inactive_file;
+    uint64_t unevictable;
+    uint64_t zswap;
+    uint64_t zswapped;
+    uint64_t anon_thp;
+    uint64_t file_thp;
+    uint64_t shmem_thp;
+    uint64_t pgfault;
+    uint64_t pgmajfault;
+    uint64_t pswpin;
+    uint64_t pswpout;
+    uint64_t zswpin;
+    uint64_t zswpout;
+    uint64_t thp_collapse_alloc;
+} cgstat_t;
+
+#define CGSTAT_KEY(name) PROCFS_KEY(#name, cgstat_t, name)
+
+/* Positions in cgstat_keys, for the bits procfs_parse() returns */
+enum
+{
+    CGSTAT_ANON,
+    CGSTAT_FILE,
+    CGSTAT_KERNEL,
+    CGSTAT_KERNEL_STACK,
+    CGSTAT_PAGETABLES,
+    CGSTAT_SHMEM,
+    CGSTAT_SLAB_RECLAIMABLE,
+    CGSTAT_SLAB_UNRECLAIMABLE,
+    CGSTAT_ACTIVE_ANON,
+    CGSTAT_INACTIVE_ANON,
+    CGSTAT_ACTIVE_FILE,
+    CGSTAT_INACTIVE_FILE,
+    CGSTAT_UNEVICTABLE,
+    CGSTAT_ZSWAP,
+    CGSTAT_ZSWAPPED,
+    CGSTAT_ANON_THP,
+    CGSTAT_FILE_THP,
+    CGSTAT_SHMEM_THP,
+    CGSTAT_PGFAULT,
+    CGSTAT_PGMAJFAULT,
+    CGSTAT_PSWPIN,
+    CGSTAT_PSWPOUT,
+    CGSTAT_ZSWPIN,
+    CGSTAT_ZSWPOUT,
+    CGSTAT_THP_COLLAPSE_ALLOC,
+    CGSTAT_NKEYS
+};
+
+static const procfs_key_t cgstat_keys[CGSTAT_NKEYS] = {
+    [CGSTAT_ANON]               = CGSTAT_KEY(anon),
+    [CGSTAT_FILE]               = CGSTAT_KEY(file),
+    [CGSTAT_KERNEL]             = CGSTAT_KEY(kernel),
+    [CGSTAT_KERNEL_STACK]       = CGSTAT_KEY(kernel_stack),
+    [CGSTAT_PAGETABLES]         = CGSTAT_KEY(pagetables),
+    [CGSTAT_SHMEM]              = CGSTAT_KEY(shmem),
+    [CGSTAT_SLAB_RECLAIMABLE]   = CGSTAT_KEY(slab_reclaimable),
+    [CGSTAT_SLAB_UNRECLAIMABLE] = CGSTAT_KEY(slab_unreclaimable),
+    [CGSTAT_ACTIVE_ANON]        = CGSTAT_KEY(active_anon),
+    [CGSTAT_INACTIVE_ANON]      = CGSTAT_KEY(inactive_anon),
+    [CGSTAT_ACTIVE_FILE]        = CGSTAT_KEY(active_file),
+    [CGSTAT_INACTIVE_FILE]      = CGSTAT_KEY(inactive_file),
+    [CGSTAT_UNEVICTABLE]        = CGSTAT_KEY(unevictable),
+    [CGSTAT_ZSWAP]              = CGSTAT_KEY(zswap),
+    [CGSTAT_ZSWAPPED]           = CGSTAT_KEY(zswapped),
+    [CGSTAT_ANON_THP]           = CGSTAT_KEY(anon_thp),
+    [CGSTAT_FILE_THP]           = CGSTAT_KEY(file_thp),
+    [CGSTAT_SHMEM_THP]          = CGSTAT_KEY(shmem_thp),
+    [CGSTAT_PGFAULT]            = CGSTAT_KEY(pgfault),
+    [CGSTAT_PGMAJFAULT]         = CGSTAT_KEY(pgmajfault),
+    [CGSTAT_PSWPIN]             = CGSTAT_KEY(pswpin),
+    [CGSTAT_PSWPOUT]            = CGSTAT_KEY(pswpout),
+    [CGSTAT_ZSWPIN]             = CGSTAT_KEY(zswpin),
+    [CGSTAT_ZSWPOUT]            = CGSTAT_KEY(zswpout),
+    [CGSTAT_THP_COLLAPSE_ALLOC] = CGSTAT_KEY(thp_collapse_alloc),
+};
+
+/* Limit files of the cgroup or one of its ancestors */
+typedef struct
+{
+    int max_fd;      /* memory.max */
+    int swap_max_fd; /* memory.swap.max, or -1 */
+} cgroup_level_t;
+
+/*
+ * ============================================================================
+ * Backend State
+ * ============================================================================
+ */
+
+static const char *g_requested = NULL; /* Directory given to cgroup_select */
+static char        g_path[CGROUP_PATH_MAX];
+
+static int            g_current_fd      = -1;
+static int            g_stat_fd         = -1;
+static int            g_swap_current_fd = -1;
+static int            g_pressure_fd     = -1;
+static cgroup_level_t g_levels[CGROUP_MAX_DEPTH];
+static size_t         g_level_count = 0;
+static char           g_stat_buf[STAT_BUF_SIZE];
+static uint64_t       g_host_total = 0;
+
+/* Event counters parsed alongside the last memory_info() call */
+static vm_counters_t g_counters;
+static int           g_counters_pending = 0;
+
+/*
+ * ============================================================================
+ * Locating the Cgroup
+ * ============================================================================
+ */
+
+int cgroup_mount(char *buf, size_t size)
+{
+    char  line[CGROUP_PATH_MAX + 256];
+    FILE *fp = fopen(MOUNTINFO_PATH, "re");
+    int   status = -1;
+
+    if (fp == NULL)
+    {
+        perror("open " MOUNTINFO_PATH);
+        return -1;
+    }
+
+    /* "ID PARENT MAJ:MIN ROOT MOUNTPOINT OPTIONS... - FSTYPE SOURCE ..." */
+    while (status != 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        char  mountpoint[CGROUP_PATH_MAX];
+        char *sep = strstr(line, " - ");
+
+        if (sep == NULL || strncmp(sep + 3, "cgroup2 ", 8) != 0)
+        {
+            continue;
+        }
+        if (sscanf(line, "%*s %*s %*s %*s %4095s", mountpoint) == 1 &&
+            strlen(mountpoint) < size)
+        {
+            memcpy(buf, mountpoint, strlen(mountpoint) + 1);
+            status = 0;
+        }
+    }
+
+    fclose(fp);
+    return status;
+}
+
+/* This process's cgroup directory, from the "0::/path" line */
+static int find_self(char *buf, size_t size)
+{
+    char  mount[CGROUP_PATH_MAX];
+    char  line[CGROUP_PATH_MAX];
+    FILE *fp = fopen(SELF_CGROUP_PATH, "re");
+    int   status = -1;
+
+    if (fp == NULL)
+    {
+        perror("open " SELF_CGROUP_PATH);
+        return -1;
+    }
+
+    while (status != 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (strncmp(line, "0::", 3) != 0)
+        {
+            continue;
+        }
+
+        line[strcspn(line, "\n")] = '\0';
+
+        if (cgroup_mount(mount, sizeof(mount)) != 0)
+        {
+            break;
+        }
+
+        int len = snprintf(buf, size, "%s%s", mount,
+                           strcmp(line + 3, "/") == 0 ? "" : line + 3);
+        status = len > 0 && (size_t)len < size ? 0 : -1;
+    }
+
+    fclose(fp);
+
+    if (status != 0)
+    {
+        fprintf(stderr, "Error: This process is not in a cgroup v2 "
+                        "hierarchy\n");
+    }
+    return status;
+}
+
+/*
+ * ============================================================================
+ * Control File Reading
+ * ============================================================================
+ */
+
+static int open_at(int dir, const char *name)
+{
+    return openat(dir, name, O_RDONLY | O_CLOEXEC);
+}
+
+/* Read a single-number file such as memory.current */
+static int read_counter(int fd, uint64_t *value)
+{
+    char    buf[VALUE_BUF_SIZE];
+    ssize_t len = procfs_read(fd, buf, sizeof(buf));
+
+    if (len <= 0)
+    {
+        return -1;
+    }
+
+    procfs_parse_uint(buf, buf + len, value);
+    return 0;
+}
+
+/* Read a limit file: a byte count, or "max" for none */
+static uint64_t read_limit(int fd)
+{
+    char    buf[VALUE_BUF_SIZE];
+    ssize_t len = procfs_read(fd, buf, sizeof(buf));
+    uint64_t value;
+
+    if (len <= 0 || strncmp(buf, "max", 3) == 0)
+    {
+        return CGROUP_UNLIMITED;
+    }
+
+    procfs_parse_uint(buf, buf + len, &value);
+    return value;
+}
+
+/*
+ * The effective limit is the tightest one on the way to the root: a
+ * container's own cgroup is often unlimited while its parent is not.
+ */
+static uint64_t effective_limit(int swap)
+{
+    uint64_t limit = CGROUP_UNLIMITED;
+
+    for (size_t i = 0; i < g_level_count; i++)
+    {
+        int fd = swap ? g_levels[i].swap_max_fd : g_levels[i].max_fd;
+
+        if (fd >= 0)
+        {
+            uint64_t value = read_limit(fd);
+            if (value < limit)
+            {
+                limit = value;
+            }
+        }
+    }
+
+    return limit;
+}
+
+/*
+ * Open memory.max (and memory.swap.max) of the cgroup and each ancestor.
+ * The root cgroup has no limit files, which ends the walk.
+ */
+static void open_levels(void)
+{
+    char path[CGROUP_PATH_MAX];
+
+    memcpy(path, g_path, strlen(g_path) + 1);
+    g_level_count = 0;
+
+    while (g_level_count < CGROUP_MAX_DEPTH && path[0] != '\0')
+    {
+        int dir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir < 0)
+        {
+            break;
+        }
+
+        cgroup_level_t *level = &g_levels[g_level_count];
+        level->max_fd         = open_at(dir, "memory.max");
+        level->swap_max_fd    = open_at(dir, "memory.swap.max");
+        close(dir);
+
+        if (level->max_fd < 0)
+        {
+            if (level->swap_max_fd >= 0)
+            {
+                close(level->swap_max_fd);
+            }
+            break;
+        }
+        g_level_count++;
+
+        /* Up one level */
+        char *slash = strrchr(path, '/');
+        if (slash == NULL || slash == path)
+        {
+            break;
+        }
+        *slash = '\0';
+    }
+}
+
+static int read_stat(cgstat_t *stat, uint64_t *found)
+{
+    ssize_t len = procfs_read(g_stat_fd, g_stat_buf, sizeof(g_stat_buf));
+    if (len <= 0)
+    {
+        perror("read memory.stat");
+        return -1;
+    }
+
+    memset(stat, 0, sizeof(cgstat_t));
+    *found =
+        procfs_parse(g_stat_buf, (size_t)len, cgstat_keys, CGSTAT_NKEYS, stat);
+    return 0;
+}
+
+static void fill_counters(const cgstat_t *stat, vm_counters_t *counters)
+{
+    /* Major faults are the reads from backing store this cgroup caused */
+    counters->pageins        = stat->pgmajfault;
+    counters->pageouts       = 0; /* Not accounted per cgroup */
+    counters->swapins        = stat->pswpin;
+    counters->swapouts       = stat->pswpout;
+    counters->compressions   = stat->zswpout;
+    counters->decompressions = stat->zswpin;
+    counters->faults         = stat->pgfault;
+    counters->purges         = 0; /* No Linux equivalent */
+    counters->thp_collapses  = stat->thp_collapse_alloc;
+    counters->thp_splits     = 0; /* Not accounted per cgroup */
+}
+
+/*
+ * ============================================================================
+ * Backend Operations
+ * ============================================================================
+ */
+
+static void cgroup_cleanup(void)
+{
+    int *fds[] = {&g_current_fd, &g_stat_fd, &g_swap_current_fd,
+                  &g_pressure_fd};
+
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        if (*fds[i] >= 0)
+        {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+
+    for (size_t i = 0; i < g_level_count; i++)
+    {
+        close(g_levels[i].max_fd);
+        if (g_levels[i].swap_max_fd >= 0)
+        {
+            close(g_levels[i].swap_max_fd);
+        }
+    }
+    g_level_count = 0;
+
+    memory_backend_linux.cleanup();
+    g_counters_pending = 0;
+}
+
+static int cgroup_init(void)
+{
+    if (g_requested != NULL)
+    {
+        if (strlen(g_requested) >= sizeof(g_path))
+        {
+            fprintf(stderr, "Error: Cgroup path too long: %s\n", g_requested);
+            return -1;
+        }
+        memcpy(g_path, g_requested, strlen(g_requested) + 1);
+    }
+    else if (find_self(g_path, sizeof(g_path)) != 0)
+    {
+        return -1;
+    }
+
+    /* Host values fill in whatever the cgroup does not limit */
+    if (memory_backend_linux.init() != 0)
+    {
+        return -1;
+    }
+
+    int dir = open(g_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0)
+    {
+        fprintf(stderr, "Error: Cannot open cgroup %s: %s\n", g_path,
+                strerror(errno));
+        memory_backend_linux.cleanup();
+        return -1;
+    }
+
+    g_current_fd      = open_at(dir, "memory.current");
+    g_stat_fd         = open_at(dir, "memory.stat");
+    g_swap_current_fd = open_at(dir, "memory.swap.current");
+    g_pressure_fd     = open_at(dir, "memory.pressure");
+    close(dir);
+
+    if (g_current_fd < 0 || g_stat_fd < 0)
+    {
+        /* The root cgroup, or the memory controller is not enabled */
+        fprintf(stderr, "Error: No memory accounting in cgroup %s\n", g_path);
+        cgroup_cleanup();
+        return -1;
+    }
+
+    open_levels();
+
+    g_host_total = memory_backend_linux.total_memory();
+    if (g_host_total == 0)
+    {
+        cgroup_cleanup();
+        return -1;
+    }
+
+    return 0;
+}
+
+static size_t cgroup_page_size(void)
+{
+    return memory_backend_linux.page_size();
+}
+
+static uint64_t cgroup_total_memory(void)
+{
+    uint64_t limit = effective_limit(0);
+
+    return limit < g_host_total ? limit : g_host_total;
+}
+
+static int cgroup_memory_info(mem_info_t *mem)
+{
+    cgstat_t stat;
+    uint64_t found;
+    uint64_t current;
+
+    if (read_counter(g_current_fd, &current) != 0)
+    {
+        perror("read memory.current");
+        return -1;
+    }
+    if (read_stat(&stat, &found) != 0)
+    {
+        return -1;
+    }
+
+    uint64_t   limit   = effective_limit(0);
+    int        limited = limit < g_host_total;
+    mem_info_t host;
+
+    /* Without a limit the container may use whatever the host has left */
+    if (!limited)
+    {
+        if (memory_backend_linux.memory_info(&host) != 0)
+        {
+            return -1;
+        }
+        limit = host.total;
+    }
+
+    /* Usage may briefly overshoot the limit while reclaim catches up */
+    uint64_t usage = current < limit ? current : limit;
+
+    mem->total      = limit;
+    mem->active     = stat.active_anon + stat.active_file;
+    mem->inactive   = stat.inactive_anon + stat.inactive_file;
+    mem->compressed = stat.zswap;
+    mem->app_memory = stat.anon;
+    mem->shared     = stat.shmem;
+
+    /* Page cache plus reclaimable slab, as the host backend counts it */
+    mem->cached     = stat.file + stat.slab_reclaimable;
+    mem->buff_cache = mem->cached;
+
+    /* Huge pages are charged to the hugetlb controller, not memory.max */
+    mem->hugetlb = 0;
+
+    /* THP and zswap usage charged to this cgroup */
+    mem->compressed_orig = stat.zswapped;
+    mem->thp_anon        = stat.anon_thp;
+    mem->thp_shmem       = stat.shmem_thp;
+    mem->thp_file        = stat.file_thp;
+
+    /* "kernel" (5.18+) covers stacks, page tables and all slab */
+    uint64_t kernel = stat.kernel_stack + stat.pagetables +
+                      stat.slab_unreclaimable;
+    if ((found & PROCFS_FOUND(CGSTAT_KERNEL)) &&
+        stat.kernel > stat.slab_reclaimable)
+    {
+        kernel = stat.kernel - stat.slab_reclaimable;
+    }
+    mem->wired = stat.unevictable + kernel;
+
+    mem->used = usage > mem->cached ? usage - mem->cached : 0;
+    mem->free = limit - usage;
+
+    /*
+     * Available is the limit minus the working set, the usage less the
+     * inactive file cache, which is how the kubelet decides evictions.
+     */
+    uint64_t working = usage > stat.inactive_file ? usage - stat.inactive_file
+                                                  : 0;
+    mem->available   = limit - working;
+
+    if (!limited)
+    {
+        mem->free = mem->free < host.free ? mem->free : host.free;
+        mem->available =
+            mem->available < host.available ? mem->available : host.available;
+    }
+
+    /* The same read carries the event counters; keep them for later */
+    fill_counters(&stat, &g_counters);
+    g_counters_pending = 1;
+
+    return 0;
+}
+
+static int cgroup_swap_info(swap_info_t *swap)
+{
+    swap_info_t host;
+    uint64_t    current;
+
+    if (memory_backend_linux.swap_info(&host) != 0)
+    {
+        return -1;
+    }
+
+    /* Swap accounting is off (swapaccount=0): report the host's */
+    if (g_swap_current_fd < 0)
+    {
+        *swap = host;
+        return 0;
+    }
+
+    if (read_counter(g_swap_current_fd, &current) != 0)
+    {
+        perror("read memory.swap.current");
+        return -1;
+    }
+
+    uint64_t limit = effective_limit(1);
+
+    swap->total = limit < host.total ? limit : host.total;
+    swap->used  = current;
+    swap->free  = swap->total > current ? swap->total - current : 0;
+
+    return 0;
+}
+
+static int cgroup_vm_counters(vm_counters_t *counters)
+{
+    /* Reuse the counters from a preceding memory_info() call if fresh */
+    if (g_counters_pending)
+    {
+        *counters          = g_counters;
+        g_counters_pending = 0;
+        return 0;
+    }
+
+    cgstat_t stat;
+    uint64_t found;
+    if (read_stat(&stat, &found) != 0)
+    {
+        return -1;
+    }
+
+    fill_counters(&stat, counters);
+    return 0;
+}
+
+static int cgroup_pressure_info(pressure_info_t *pressure)
+{
+    char buf[PSI_BUF_SIZE];
+
+    /* Stalls of this cgroup's tasks only; the host's without PSI here */
+    if (g_pressure_fd < 0)
+    {
+        return memory_backend_linux.pressure_info(pressure);
+    }
+
+    ssize_t len = procfs_read(g_pressure_fd, buf, sizeof(buf));
+    if (len <= 0)
+    {
+        return -1;
+    }
+
+    return procfs_parse_psi(buf, (size_t)len, pressure);
+}
+
+/*
+ * ============================================================================
+ * Backend Definition
+ * ============================================================================
+ */
+
+const memory_backend_t memory_backend_cgroup = {
+    .name          = "cgroup",
+    .init          = cgroup_init,
+    .cleanup       = cgroup_cleanup,
+    .page_size     = cgroup_page_size,
+    .total_memory  = cgroup_total_memory,
+    .memory_info   = cgroup_memory_info,
+    .swap_info     = cgroup_swap_info,
+    .vm_counters   = cgroup_vm_counters,
+    .pressure_info = cgroup_pressure_info,
+};
+
+int cgroup_select(const char *path)
+{
+    g_requested = path;
+    memory_set_backend(&memory_backend_cgroup);
+
+    return memory_init();
+}
@@ -0,0 +1,110 @@
+/*
+ * cgtree.h - Memory of every cgroup below a root, as a tree
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef CGTREE_H
+#define CGTREE_H
+
+#include "cgroup.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define CGTREE_NAME_LEN      96  /* Directory name, including NUL */
+#define CGTREE_DEFAULT_DEPTH 4   /* Levels below the root walked */
+#define CGTREE_MAX_ROWS      100 /* Rows printed, largest subtrees first */
+#define CGTREE_MAX_WORKERS   8   /* Threads used for one walk */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* One cgroup; usage is hierarchical, so it includes every descendant */
+typedef struct
+{
+    char     name[CGTREE_NAME_LEN]; /* Directory name (root: "/") */
+    uint32_t parent;                /* Index of the parent (root: itself) */
+    uint32_t depth;                 /* Levels below the root */
+    uint32_t first;                 /* First child in cgtree_t.sorted */
+    uint32_t children;              /* Children walked */
+    uint64_t current;               /* memory.current, bytes */
+    uint64_t anon;                  /* memory.stat anon, bytes */
+    uint64_t file;                  /* memory.stat file, bytes */
+    uint64_t swap;                  /* memory.swap.current, bytes */
+    int      accounted;             /* memory.current was readable */
+} cgtree_node_t;
+
+/*
+ * Cgroup tree
+ *
+ * Each walk starts from the root directory and fans out over up to
+ * CGTREE_MAX_WORKERS threads sharing a queue of open directories. Every
+ * file is opened relative to its directory's descriptor, so no path is
+ * ever resolved twice. Levels beyond max_depth are not read at all, nor
+ * are the children of a cgroup already smaller than min_size: usage is
+ * hierarchical, so none of them could be shown.
+ */
+typedef struct
+{
+    char           root[CGROUP_PATH_MAX]; /* Directory walked */
+    uint32_t       max_depth;             /* Deepest level walked */
+    uint64_t       min_size;              /* Smallest cgroup shown, bytes */
+    cgtree_node_t *nodes;                 /* Cgroups walked; root first */
+    size_t         count;                 /* Entries in nodes */
+    size_t         cap;                   /* Capacity of nodes */
+    uint32_t      *sorted;                /* Siblings by usage, largest first */
+    uint32_t      *rows;                  /* Nodes shown, in print order */
+    size_t         row_count;             /* Entries in rows */
+    size_t         omitted;               /* Subtrees cut by CGTREE_MAX_ROWS */
+    uint64_t       elapsed;               /* Duration of the last walk, ns */
+} cgtree_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Prepare a tree
+ *
+ * @param tree      Tree to initialize
+ * @param root      Directory to walk, or NULL for the cgroup v2 mount
+ * @param max_depth Levels below the root to walk
+ * @param min_size  Smallest cgroup shown, bytes
+ * @return          0 on success, -1 on error
+ */
+int cgtree_init(cgtree_t *tree, const char *root, uint32_t max_depth,
+                uint64_t min_size);
+
+/**
+ * Walk the hierarchy and order the rows to print
+ *
+ * Cgroups that disappear during the walk are skipped. A directory without
+ * memory.current (the root cgroup, or one without the memory controller)
+ * is given the sum of its children.
+ *
+ * @param tree      Initialized tree
+ * @return          0 on success, -1 on error
+ */
+int cgtree_scan(cgtree_t *tree);
+
+/**
+ * Release a tree's buffers
+ *
+ * @param tree      Tree to clean up
+ */
+void cgtree_cleanup(cgtree_t *tree);
+
+#endif /* CGTREE_H */
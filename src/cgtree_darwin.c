@@ -0,0 +1,41 @@
+/*
+ * cgtree_darwin.c - Cgroup tree, unavailable on macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "cgtree.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Tree Functions
+ * ============================================================================
+ */
+
+/* macOS has no cgroups; containers there run inside a Linux VM */
+int cgtree_init(cgtree_t *tree, const char *root, uint32_t max_depth,
+                uint64_t min_size)
+{
+    (void)root;
+    (void)max_depth;
+    (void)min_size;
+    memset(tree, 0, sizeof(cgtree_t));
+
+    fprintf(stderr, "Error: --cgroup-tree is only supported on Linux\n");
+    return -1;
+}
+
+int cgtree_scan(cgtree_t *tree)
+{
+    (void)tree;
+    return -1;
+}
+
+void cgtree_cleanup(cgtree_t *tree)
+{
+    memset(tree, 0, sizeof(cgtree_t));
+}
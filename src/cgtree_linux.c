@@ -0,0 +1,622 @@
+/*
+ * cgtree_linux.c - Memory of every cgroup below a root, as a tree
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "cgtree.h"
+#include "procfs.h"
+#include "utils.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define STAT_BUF_SIZE  8192
+#define VALUE_BUF_SIZE 64
+#define WALK_BATCH     32 /* Children queued per lock acquisition */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* memory.stat values shown in the tree */
+typedef struct
+{
+    uint64_t anon;
+    uint64_t file;
+} cgtree_stat_t;
+
+static const procfs_key_t stat_keys[] = {
+    PROCFS_KEY("anon", cgtree_stat_t, anon),
+    PROCFS_KEY("file", cgtree_stat_t, file),
+};
+
+#define STAT_NKEYS (sizeof(stat_keys) / sizeof(stat_keys[0]))
+
+/*
+ * Walk state of one node. A directory stays open only until each of its
+ * children has been opened relative to it, so however wide the tree is,
+ * the descriptors held at once stay close to depth times workers.
+ */
+typedef struct
+{
+    DIR     *dir;     /* Open while children remain to be opened */
+    uint32_t pending; /* Children queued but not yet opened */
+    int      listed;  /* Every child has been queued */
+    int      gone;    /* Removed before it could be read */
+} walk_dir_t;
+
+/* State shared by the walking threads, guarded by lock */
+typedef struct
+{
+    cgtree_t       *tree;      /* Tree being filled */
+    walk_dir_t     *dirs;      /* Parallel to tree->nodes */
+    uint32_t       *jobs;      /* Nodes to open; as large as nodes */
+    size_t          job_count; /* Entries in jobs */
+    size_t          busy;      /* Workers holding a node */
+    int             failed;    /* Out of memory; stop */
+    pthread_mutex_t lock;      /* Guards everything above */
+    pthread_cond_t  wake;      /* Signalled when jobs are queued or done */
+} walk_t;
+
+/* Children found by one worker, queued together */
+typedef struct
+{
+    char   names[WALK_BATCH][CGTREE_NAME_LEN];
+    size_t count;
+} walk_batch_t;
+
+/*
+ * ============================================================================
+ * Control File Reading
+ * ============================================================================
+ */
+
+static ssize_t read_at(int dir, const char *name, char *buf, size_t size)
+{
+    int fd = openat(dir, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    ssize_t len = procfs_read(fd, buf, size);
+    close(fd);
+    return len;
+}
+
+static void read_usage(int dir, cgtree_node_t *usage)
+{
+    char          buf[STAT_BUF_SIZE];
+    cgtree_stat_t stat;
+    ssize_t       len;
+
+    len = read_at(dir, "memory.current", buf, VALUE_BUF_SIZE);
+    if (len > 0)
+    {
+        procfs_parse_uint(buf, buf + len, &usage->current);
+        usage->accounted = 1;
+    }
+
+    len = read_at(dir, "memory.stat", buf, sizeof(buf));
+    if (len > 0)
+    {
+        memset(&stat, 0, sizeof(stat));
+        procfs_parse(buf, (size_t)len, stat_keys, STAT_NKEYS, &stat);
+        usage->anon = stat.anon;
+        usage->file = stat.file;
+    }
+
+    len = read_at(dir, "memory.swap.current", buf, VALUE_BUF_SIZE);
+    if (len > 0)
+    {
+        procfs_parse_uint(buf, buf + len, &usage->swap);
+    }
+}
+
+/*
+ * ============================================================================
+ * Ordering
+ * ============================================================================
+ */
+
+/* Sort key: siblings together, largest first */
+typedef struct
+{
+    uint32_t parent;
+    uint32_t index;
+    uint64_t current;
+} order_key_t;
+
+static int compare_keys(const void *a, const void *b)
+{
+    const order_key_t *ka = a;
+    const order_key_t *kb = b;
+
+    if (ka->parent != kb->parent)
+    {
+        return ka->parent < kb->parent ? -1 : 1;
+    }
+    if (ka->current != kb->current)
+    {
+        return ka->current > kb->current ? -1 : 1;
+    }
+    return ka->index < kb->index ? -1 : ka->index > kb->index;
+}
+
+/* Depth-first, each level largest first, until the rows run out */
+static void add_rows(cgtree_t *tree, uint32_t index)
+{
+    const cgtree_node_t *node = &tree->nodes[index];
+
+    if (tree->row_count == CGTREE_MAX_ROWS)
+    {
+        tree->omitted++;
+        return;
+    }
+    tree->rows[tree->row_count++] = index;
+
+    for (uint32_t i = 0; i < node->children; i++)
+    {
+        uint32_t child = tree->sorted[node->first + i];
+
+        if (tree->nodes[child].current >= tree->min_size)
+        {
+            add_rows(tree, child);
+        }
+    }
+}
+
+static int order_rows(cgtree_t *tree, const walk_dir_t *dirs)
+{
+    order_key_t *keys   = malloc(tree->count * sizeof(order_key_t));
+    uint32_t    *sorted = realloc(tree->sorted, tree->count * sizeof(uint32_t));
+
+    if (sorted != NULL)
+    {
+        tree->sorted = sorted;
+    }
+    if (keys == NULL || sorted == NULL)
+    {
+        perror("malloc");
+        free(keys);
+        return -1;
+    }
+
+    /*
+     * Directories without their own accounting get the sum of their
+     * children. Children always come after their parent, so walking
+     * backwards finishes each sum before it is added upwards.
+     */
+    for (size_t i = tree->count - 1; i > 0; i--)
+    {
+        cgtree_node_t *node   = &tree->nodes[i];
+        cgtree_node_t *parent = &tree->nodes[node->parent];
+
+        if (!dirs[i].gone && !parent->accounted)
+        {
+            parent->current += node->current;
+            parent->anon += node->anon;
+            parent->file += node->file;
+            parent->swap += node->swap;
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < tree->count; i++)
+    {
+        tree->nodes[i].children = 0;
+    }
+    for (size_t i = 1; i < tree->count; i++)
+    {
+        if (dirs[i].gone)
+        {
+            continue;
+        }
+        keys[count].parent  = tree->nodes[i].parent;
+        keys[count].index   = (uint32_t)i;
+        keys[count].current = tree->nodes[i].current;
+        count++;
+    }
+
+    qsort(keys, count, sizeof(order_key_t), compare_keys);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        cgtree_node_t *parent = &tree->nodes[keys[i].parent];
+
+        if (parent->children == 0)
+        {
+            parent->first = (uint32_t)i;
+        }
+        parent->children++;
+        tree->sorted[i] = keys[i].index;
+    }
+    free(keys);
+
+    tree->row_count = 0;
+    tree->omitted   = 0;
+    add_rows(tree, 0);
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Parallel Walk
+ * ============================================================================
+ */
+
+/* Close a directory once it is listed and no child still needs it */
+static void release_dir(walk_dir_t *dir)
+{
+    if (dir->listed && dir->pending == 0 && dir->dir != NULL)
+    {
+        closedir(dir->dir);
+        dir->dir = NULL;
+    }
+}
+
+/* Double the node, walk state and job arrays together; lock held */
+static int grow_walk(walk_t *walk)
+{
+    cgtree_t *tree = walk->tree;
+    size_t    cap  = tree->cap * 2;
+    void     *p;
+
+    /* Each array that was reallocated stays valid if a later one fails */
+    if ((p = realloc(tree->nodes, cap * sizeof(cgtree_node_t))) == NULL)
+    {
+        return -1;
+    }
+    tree->nodes = p;
+
+    if ((p = realloc(walk->dirs, cap * sizeof(walk_dir_t))) == NULL)
+    {
+        return -1;
+    }
+    walk->dirs = p;
+
+    if ((p = realloc(walk->jobs, cap * sizeof(uint32_t))) == NULL)
+    {
+        return -1;
+    }
+    walk->jobs = p;
+
+    tree->cap = cap;
+    return 0;
+}
+
+/* Append nodes for a batch of children and queue them; lock held */
+static void queue_children(walk_t *walk, uint32_t parent, DIR *dir,
+                           walk_batch_t *batch)
+{
+    cgtree_t *tree = walk->tree;
+
+    walk->dirs[parent].dir = dir;
+
+    for (size_t i = 0; i < batch->count && !walk->failed; i++)
+    {
+        if (tree->count == tree->cap)
+        {
+            if (grow_walk(walk) != 0)
+            {
+                walk->failed = 1;
+                break;
+            }
+        }
+
+        uint32_t       index = (uint32_t)tree->count++;
+        cgtree_node_t *node  = &tree->nodes[index];
+
+        memset(node, 0, sizeof(*node));
+        memset(&walk->dirs[index], 0, sizeof(walk_dir_t));
+        memcpy(node->name, batch->names[i], CGTREE_NAME_LEN);
+        node->parent = parent;
+        node->depth  = tree->nodes[parent].depth + 1;
+
+        walk->jobs[walk->job_count++] = index;
+        walk->dirs[parent].pending++;
+    }
+
+    batch->count = 0;
+    pthread_cond_broadcast(&walk->wake);
+}
+
+static int is_directory(DIR *dir, const struct dirent *entry)
+{
+    struct stat st;
+
+    if (entry->d_type != DT_UNKNOWN)
+    {
+        return entry->d_type == DT_DIR;
+    }
+
+    return fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+           S_ISDIR(st.st_mode);
+}
+
+/* Open, read and list one node; called without the lock */
+static void visit(walk_t *walk, uint32_t index, int parent_fd,
+                  const char *name, uint32_t depth)
+{
+    cgtree_t     *tree = walk->tree;
+    cgtree_node_t usage;
+    walk_batch_t  batch;
+    DIR          *dir = NULL;
+
+    memset(&usage, 0, sizeof(usage));
+    batch.count = 0;
+
+    int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+    int fd    = parent_fd < 0 ? open(tree->root, flags)
+                              : openat(parent_fd, name, flags);
+
+    if (fd >= 0)
+    {
+        read_usage(fd, &usage);
+
+        /* Usage is hierarchical: below min_size, so is every child */
+        int descend = depth < tree->max_depth &&
+                      (!usage.accounted || usage.current >= tree->min_size);
+
+        dir = descend ? fdopendir(fd) : NULL;
+        if (dir == NULL)
+        {
+            close(fd);
+        }
+    }
+
+    struct dirent *entry;
+    while (dir != NULL && (entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.' || !is_directory(dir, entry) ||
+            strlen(entry->d_name) >= CGTREE_NAME_LEN)
+        {
+            continue;
+        }
+
+        memcpy(batch.names[batch.count], entry->d_name,
+               strlen(entry->d_name) + 1);
+        if (++batch.count == WALK_BATCH)
+        {
+            pthread_mutex_lock(&walk->lock);
+            queue_children(walk, index, dir, &batch);
+            pthread_mutex_unlock(&walk->lock);
+        }
+    }
+
+    pthread_mutex_lock(&walk->lock);
+
+    /* Queuing children may move nodes; no pointer is held across it */
+    cgtree_node_t *node = &tree->nodes[index];
+    uint32_t       parent = node->parent;
+
+    node->current          = usage.current;
+    node->anon             = usage.anon;
+    node->file             = usage.file;
+    node->swap             = usage.swap;
+    node->accounted        = usage.accounted;
+    walk->dirs[index].gone = fd < 0;
+
+    if (batch.count > 0)
+    {
+        queue_children(walk, index, dir, &batch);
+    }
+    walk->dirs[index].dir    = dir;
+    walk->dirs[index].listed = 1;
+    release_dir(&walk->dirs[index]);
+
+    if (index != 0)
+    {
+        walk->dirs[parent].pending--;
+        release_dir(&walk->dirs[parent]);
+    }
+
+    walk->busy--;
+    pthread_cond_broadcast(&walk->wake);
+    pthread_mutex_unlock(&walk->lock);
+}
+
+static void *walk_main(void *arg)
+{
+    walk_t *walk = arg;
+    char    name[CGTREE_NAME_LEN];
+
+    pthread_mutex_lock(&walk->lock);
+    for (;;)
+    {
+        while (walk->job_count == 0 && walk->busy > 0 && !walk->failed)
+        {
+            pthread_cond_wait(&walk->wake, &walk->lock);
+        }
+        if (walk->job_count == 0 || walk->failed)
+        {
+            break;
+        }
+
+        /* Newest first: finishing a subtree lets its directories close */
+        uint32_t       index = walk->jobs[--walk->job_count];
+        cgtree_node_t *node  = &walk->tree->nodes[index];
+        uint32_t       depth = node->depth;
+        int parent_fd = index == 0 ? -1 : dirfd(walk->dirs[node->parent].dir);
+
+        memcpy(name, node->name, CGTREE_NAME_LEN);
+        walk->busy++;
+        pthread_mutex_unlock(&walk->lock);
+
+        visit(walk, index, parent_fd, name, depth);
+
+        pthread_mutex_lock(&walk->lock);
+    }
+    pthread_mutex_unlock(&walk->lock);
+
+    return NULL;
+}
+
+/* Enough workers to keep each busy, no more than there are cores */
+static size_t worker_count(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cores < 1)
+    {
+        return 1;
+    }
+    return cores < CGTREE_MAX_WORKERS ? (size_t)cores : CGTREE_MAX_WORKERS;
+}
+
+static int walk_tree(cgtree_t *tree)
+{
+    pthread_t threads[CGTREE_MAX_WORKERS];
+    walk_t    walk;
+    size_t    started = 1;
+
+    memset(&walk, 0, sizeof(walk));
+    walk.tree = tree;
+    walk.dirs = calloc(tree->cap, sizeof(walk_dir_t));
+    walk.jobs    = malloc(tree->cap * sizeof(uint32_t));
+    if (walk.dirs == NULL || walk.jobs == NULL)
+    {
+        perror("malloc");
+        free(walk.dirs);
+        free(walk.jobs);
+        return -1;
+    }
+
+    /* The root; the header names its path */
+    tree->count = 1;
+    memset(&tree->nodes[0], 0, sizeof(cgtree_node_t));
+    tree->nodes[0].name[0] = '/';
+    walk.jobs[walk.job_count++] = 0;
+
+    pthread_mutex_init(&walk.lock, NULL);
+    pthread_cond_init(&walk.wake, NULL);
+
+    /* This thread is worker 0; start the others first */
+    for (size_t count = worker_count(); started < count; started++)
+    {
+        if (pthread_create(&threads[started], NULL, walk_main, &walk) != 0)
+        {
+            break; /* Fewer threads: the walk is just slower */
+        }
+    }
+
+    walk_main(&walk);
+
+    for (size_t i = 1; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&walk.wake);
+    pthread_mutex_destroy(&walk.lock);
+
+    /* A failed walk can leave directories open */
+    for (size_t i = 0; i < tree->count; i++)
+    {
+        if (walk.dirs[i].dir != NULL)
+        {
+            closedir(walk.dirs[i].dir);
+        }
+    }
+
+    if (walk.dirs[0].gone)
+    {
+        fprintf(stderr, "Error: Cannot open %s\n", tree->root);
+        walk.failed = 1;
+    }
+    else if (walk.failed)
+    {
+        perror("realloc");
+    }
+    else if (order_rows(tree, walk.dirs) != 0)
+    {
+        walk.failed = 1;
+    }
+
+    free(walk.dirs);
+    free(walk.jobs);
+
+    return walk.failed ? -1 : 0;
+}
+
+/*
+ * ============================================================================
+ * Tree Functions
+ * ============================================================================
+ */
+
+int cgtree_init(cgtree_t *tree, const char *root, uint32_t max_depth,
+                uint64_t min_size)
+{
+    memset(tree, 0, sizeof(cgtree_t));
+
+    if (root == NULL)
+    {
+        if (cgroup_mount(tree->root, sizeof(tree->root)) != 0)
+        {
+            fprintf(stderr, "Error: No cgroup v2 hierarchy is mounted\n");
+            return -1;
+        }
+    }
+    else if (strlen(root) < sizeof(tree->root))
+    {
+        memcpy(tree->root, root, strlen(root) + 1);
+    }
+    else
+    {
+        fprintf(stderr, "Error: Cgroup path too long: %s\n", root);
+        return -1;
+    }
+
+    tree->max_depth = max_depth;
+    tree->min_size  = min_size;
+    tree->cap       = 256;
+    tree->nodes     = malloc(tree->cap * sizeof(cgtree_node_t));
+    tree->rows      = malloc(CGTREE_MAX_ROWS * sizeof(uint32_t));
+    if (tree->nodes == NULL || tree->rows == NULL)
+    {
+        perror("malloc");
+        cgtree_cleanup(tree);
+        return -1;
+    }
+
+    return 0;
+}
+
+int cgtree_scan(cgtree_t *tree)
+{
+    uint64_t start = monotonic_ns();
+
+    if (walk_tree(tree) != 0)
+    {
+        return -1;
+    }
+
+    tree->elapsed = monotonic_ns() - start;
+    return 0;
+}
+
+void cgtree_cleanup(cgtree_t *tree)
+{
+    free(tree->nodes);
+    free(tree->sorted);
+    free(tree->rows);
+    memset(tree, 0, sizeof(cgtree_t));
+}
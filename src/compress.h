@@ -0,0 +1,92 @@
+/*
+ * compress.h - Compressed memory: stored and physical size, ratio, rates
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define COMPRESS_MAX_POOLS 16 /* zswap plus zram devices shown */
+#define COMPRESS_NAME_MAX  16 /* Row label, e.g. "zram0" */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* One compressed store: zswap, a zram device or the macOS compressor */
+typedef struct
+{
+    char     name[COMPRESS_NAME_MAX]; /* Row label */
+    int      stat_fd;                 /* zram mm_stat, or -1 */
+    int      io_fd;                   /* zram block stat, or -1 */
+    uint64_t stored;                  /* Bytes held, before compression */
+    uint64_t used;                    /* Bytes of RAM it takes */
+    uint64_t compressions;            /* Pages compressed since boot */
+    uint64_t decompressions;          /* Pages decompressed since boot */
+    double   compress_rate;           /* Compressions per second */
+    double   decompress_rate;         /* Decompressions per second */
+} compress_pool_t;
+
+/*
+ * Compressed memory state
+ *
+ * Every source stays open between samples. On Linux, zswap sizes come
+ * from debugfs when it is mounted and readable, from the memory sample
+ * otherwise; its event counters always come from the sample.
+ */
+typedef struct
+{
+    compress_pool_t pools[COMPRESS_MAX_POOLS]; /* zswap first */
+    size_t          count;                     /* Entries in pools */
+    int             stored_fd;                 /* zswap stored_pages, or -1 */
+    int             pool_fd;                   /* zswap pool_total_size */
+    uint64_t        timestamp;                 /* Time of the last sample */
+    int             has_rates;                 /* Rates span two samples */
+} compress_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Find and open every compressed store
+ *
+ * @param comp      State to initialize
+ * @return          0 on success, -1 if there is none
+ */
+int compress_init(compress_t *comp);
+
+/**
+ * Read the size and event counters of every store
+ *
+ * @param comp      Initialized state
+ * @param sys_mem   Sample taken with event counters
+ * @return          0 on success, -1 on error
+ */
+int compress_sample(compress_t *comp, const system_memory_t *sys_mem);
+
+/**
+ * Close every source
+ *
+ * @param comp      State to clean up
+ */
+void compress_cleanup(compress_t *comp);
+
+#endif /* COMPRESS_H */
@@ -0,0 +1,66 @@
+/*
+ * compress_darwin.c - Compressed memory from the macOS VM compressor
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "compress.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+/* One row: the compressor holds every compressed page on the system */
+int compress_init(compress_t *comp)
+{
+    memset(comp, 0, sizeof(compress_t));
+    comp->stored_fd = -1;
+    comp->pool_fd   = -1;
+
+    compress_pool_t *pool = &comp->pools[0];
+    snprintf(pool->name, sizeof(pool->name), "comp");
+    pool->stat_fd = -1;
+    pool->io_fd   = -1;
+    comp->count   = 1;
+
+    return 0;
+}
+
+int compress_sample(compress_t *comp, const system_memory_t *sys_mem)
+{
+    compress_pool_t *pool           = &comp->pools[0];
+    uint64_t         now            = sys_mem->timestamp;
+    uint64_t         compressions   = pool->compressions;
+    uint64_t         decompressions = pool->decompressions;
+
+    /* Pages handed to the compressor, and the pages it occupies */
+    pool->stored         = sys_mem->mem.compressed_orig;
+    pool->used           = sys_mem->mem.compressed;
+    pool->compressions   = sys_mem->counters.compressions;
+    pool->decompressions = sys_mem->counters.decompressions;
+
+    if (comp->timestamp > 0 && now > comp->timestamp)
+    {
+        double elapsed = (double)(now - comp->timestamp) / 1e9;
+
+        pool->compress_rate =
+            (double)(pool->compressions - compressions) / elapsed;
+        pool->decompress_rate =
+            (double)(pool->decompressions - decompressions) / elapsed;
+    }
+
+    comp->has_rates = comp->timestamp > 0;
+    comp->timestamp = now;
+    return 0;
+}
+
+void compress_cleanup(compress_t *comp)
+{
+    comp->count = 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * compress_linux.c - Compressed memory from zswap and zram
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "compress.h"
+
+#include "procfs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define ZSWAP_ENABLED   "/sys/module/zswap/parameters/enabled"
+#define ZSWAP_DEBUG_DIR "/sys/kernel/debug/zswap"
+#define BLOCK_DIR       "/sys/block"
+#define ZRAM_PATH_MAX   64
+#define STAT_BUF_SIZE   256
+#define SECTOR_SIZE     512
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+/* zram2 before zram10 */
+static int compare_pools(const void *a, const void *b)
+{
+    const compress_pool_t *x  = a;
+    const compress_pool_t *y  = b;
+    size_t                 lx = strlen(x->name);
+    size_t                 ly = strlen(y->name);
+
+    return lx != ly ? (lx > ly) - (lx < ly) : strcmp(x->name, y->name);
+}
+
+static int is_zram(const char *name)
+{
+    if (strncmp(name, "zram", 4) != 0 || name[4] == '\0')
+    {
+        return 0;
+    }
+
+    for (const char *p = name + 4; *p != '\0'; p++)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            return 0;
+        }
+    }
+    return strlen(name) < COMPRESS_NAME_MAX;
+}
+
+static int open_zram_file(const char *name, const char *file)
+{
+    char path[ZRAM_PATH_MAX];
+
+    int n = snprintf(path, sizeof(path), BLOCK_DIR "/%s/%s", name, file);
+    return n > 0 && (size_t)n < sizeof(path) ? open(path, O_RDONLY | O_CLOEXEC)
+                                             : -1;
+}
+
+/* zswap is built in or loaded; it may still be switched off */
+static int has_zswap(void)
+{
+    return access(ZSWAP_ENABLED, F_OK) == 0;
+}
+
+static int read_count(int fd, uint64_t *value)
+{
+    char buf[32];
+
+    ssize_t len = procfs_read(fd, buf, sizeof(buf));
+    if (len <= 0)
+    {
+        return -1;
+    }
+
+    procfs_parse_uint(buf, buf + len, value);
+    return 0;
+}
+
+/*
+ * Read up to n whitespace-separated numbers from the start of a file
+ *
+ * @return  0 on success, -1 on error
+ */
+static int read_fields(int fd, uint64_t *fields, size_t n)
+{
+    char buf[STAT_BUF_SIZE];
+
+    ssize_t len = procfs_read(fd, buf, sizeof(buf));
+    if (len <= 0)
+    {
+        return -1;
+    }
+
+    const char *p = buf;
+    for (size_t i = 0; i < n; i++)
+    {
+        fields[i] = 0;
+        p         = procfs_parse_uint(p, buf + len, &fields[i]);
+    }
+    return 0;
+}
+
+static int sample_zswap(compress_t *comp, compress_pool_t *pool,
+                        const system_memory_t *sys_mem)
+{
+    uint64_t pages;
+
+    if (comp->stored_fd >= 0)
+    {
+        /* debugfs: exact on every kernel, but needs root */
+        if (read_count(comp->stored_fd, &pages) != 0 ||
+            read_count(comp->pool_fd, &pool->used) != 0)
+        {
+            perror("read " ZSWAP_DEBUG_DIR);
+            return -1;
+        }
+        pool->stored = pages * sys_mem->page_size;
+    }
+    else
+    {
+        /* Zswap and Zswapped; the latter appeared in Linux 5.19 */
+        pool->used   = sys_mem->mem.compressed;
+        pool->stored = sys_mem->mem.compressed_orig;
+    }
+
+    /* zswpout/zswpin came with Linux 5.19; before, rates stay zero */
+    pool->compressions   = sys_mem->counters.compressions;
+    pool->decompressions = sys_mem->counters.decompressions;
+    return 0;
+}
+
+static int sample_zram(compress_pool_t *pool, size_t page_size)
+{
+    uint64_t mm[3];
+    uint64_t io[7];
+
+    /* orig_data_size compr_data_size mem_used_total ... */
+    if (read_fields(pool->stat_fd, mm, 3) != 0)
+    {
+        perror("read zram mm_stat");
+        return -1;
+    }
+    pool->stored = mm[0];
+    pool->used   = mm[2];
+
+    /*
+     * Block statistics: every page written is compressed and every page
+     * read decompressed. Sectors are 512 bytes whatever the device says.
+     */
+    if (read_fields(pool->io_fd, io, 7) == 0)
+    {
+        pool->decompressions = io[2] * SECTOR_SIZE / page_size;
+        pool->compressions   = io[6] * SECTOR_SIZE / page_size;
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+int compress_init(compress_t *comp)
+{
+    struct dirent *ent;
+
+    memset(comp, 0, sizeof(compress_t));
+    comp->stored_fd = -1;
+    comp->pool_fd   = -1;
+
+    if (has_zswap())
+    {
+        compress_pool_t *pool = &comp->pools[comp->count++];
+
+        snprintf(pool->name, sizeof(pool->name), "zswap");
+        pool->stat_fd = -1;
+        pool->io_fd   = -1;
+
+        /* Without debugfs, sizes come from the sample */
+        comp->stored_fd = open(ZSWAP_DEBUG_DIR "/stored_pages",
+                               O_RDONLY | O_CLOEXEC);
+        comp->pool_fd   = open(ZSWAP_DEBUG_DIR "/pool_total_size",
+                               O_RDONLY | O_CLOEXEC);
+        if (comp->stored_fd < 0 || comp->pool_fd < 0)
+        {
+            if (comp->stored_fd >= 0)
+            {
+                close(comp->stored_fd);
+                comp->stored_fd = -1;
+            }
+            if (comp->pool_fd >= 0)
+            {
+                close(comp->pool_fd);
+                comp->pool_fd = -1;
+            }
+        }
+    }
+
+    DIR *dir = opendir(BLOCK_DIR);
+    while (dir != NULL && (ent = readdir(dir)) != NULL &&
+           comp->count < COMPRESS_MAX_POOLS)
+    {
+        if (!is_zram(ent->d_name))
+        {
+            continue;
+        }
+
+        compress_pool_t *pool = &comp->pools[comp->count];
+
+        /* is_zram() checked that the name fits */
+        memcpy(pool->name, ent->d_name, strlen(ent->d_name) + 1);
+        pool->stat_fd = open_zram_file(ent->d_name, "mm_stat");
+        pool->io_fd   = open_zram_file(ent->d_name, "stat");
+        if (pool->stat_fd < 0 || pool->io_fd < 0)
+        {
+            /* Removed since the listing */
+            if (pool->stat_fd >= 0)
+            {
+                close(pool->stat_fd);
+            }
+            if (pool->io_fd >= 0)
+            {
+                close(pool->io_fd);
+            }
+            continue;
+        }
+
+        comp->count++;
+    }
+    if (dir != NULL)
+    {
+        closedir(dir);
+    }
+
+    if (comp->count == 0)
+    {
+        fprintf(stderr, "Error: Neither zswap nor a zram device is "
+                        "available\n");
+        return -1;
+    }
+
+    /* readdir() order is arbitrary; zswap, if present, stays first */
+    size_t first = comp->pools[0].stat_fd < 0 ? 1 : 0;
+    qsort(comp->pools + first, comp->count - first, sizeof(compress_pool_t),
+          compare_pools);
+
+    return 0;
+}
+
+int compress_sample(compress_t *comp, const system_memory_t *sys_mem)
+{
+    uint64_t now     = sys_mem->timestamp;
+    double   elapsed = (double)(now - comp->timestamp) / 1e9;
+
+    for (size_t i = 0; i < comp->count; i++)
+    {
+        compress_pool_t *pool           = &comp->pools[i];
+        uint64_t         compressions   = pool->compressions;
+        uint64_t         decompressions = pool->decompressions;
+
+        /* zswap is the only store without a device of its own */
+        int rc = pool->stat_fd < 0 ? sample_zswap(comp, pool, sys_mem)
+                                   : sample_zram(pool, sys_mem->page_size);
+        if (rc != 0)
+        {
+            return -1;
+        }
+
+        /* A zram reset zeroes its counters; show 0 rather than wrapping */
+        if (comp->timestamp > 0 && now > comp->timestamp)
+        {
+            pool->compress_rate =
+                pool->compressions >= compressions
+                    ? (double)(pool->compressions - compressions) / elapsed
+                    : 0.0;
+            pool->decompress_rate =
+                pool->decompressions >= decompressions
+                    ? (double)(pool->decompressions - decompressions) /
+                          elapsed
+                    : 0.0;
+        }
+    }
+
+    comp->has_rates = comp->timestamp > 0;
+    comp->timestamp = now;
+    return 0;
+}
+
+void compress_cleanup(compress_t *comp)
+{
+    for (size_t i = 0; i < comp->count; i++)
+    {
+        if (comp->pools[i].stat_fd >= 0)
+        {
+            close(comp->pools[i].stat_fd);
+        }
+        if (comp->pools[i].io_fd >= 0)
+        {
+            close(comp->pools[i].io_fd);
+        }
+    }
+    comp->count = 0;
+
+    int *fds[] = {&comp->stored_fd, &comp->pool_fd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        if (*fds[i] >= 0)
+        {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+}
@@ -7,8 +7,12 @@
 
 #include "display.h"
 
+#include "ticker.h"
+
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 /*
  * ============================================================================
@@ -16,26 +20,42 @@
  * ============================================================================
  */
 
-static void print_value(uint64_t bytes, const options_t *opts)
+static size_t value_width(const options_t *opts)
+{
+    return opts->unit == UNIT_HUMAN ? COL_WIDTH_HUMAN : COL_WIDTH_VALUE;
+}
+
+static void render_label(frame_t *frame, const char *label)
+{
+    frame_put_left(frame, label, COL_WIDTH_LABEL);
+}
+
+static void render_column(frame_t *frame, const char *str,
+                          const options_t *opts)
+{
+    frame_putc(frame, ' ');
+    frame_put_right(frame, str, value_width(opts));
+}
+
+static void render_value(frame_t *frame, uint64_t bytes, const options_t *opts)
 {
+    char buf[32];
+
     if (opts->unit == UNIT_HUMAN)
     {
-        char buf[32];
         format_human(bytes, buf, sizeof(buf));
-        printf(" %11s", buf);
     }
     else
     {
-        double val = convert_unit(bytes, opts->unit);
-        if (opts->unit == UNIT_BYTES)
-        {
-            printf(" %12llu", (unsigned long long)bytes);
-        }
-        else
-        {
-            printf(" %12.0f", val);
-        }
+        format_uint(scale_unit(bytes, opts->unit), buf);
     }
+
+    render_column(frame, buf, opts);
+}
+
+static void render_padding(frame_t *frame, int num_cols, const options_t *opts)
+{
+    frame_fill(frame, ' ', (size_t)num_cols * (value_width(opts) + 1));
 }
 
 /*
@@ -44,166 +64,799 @@ static void print_value(uint64_t bytes, const options_t *opts)
  * ============================================================================
  */
 
-void print_header(const options_t *opts)
+void render_header(frame_t *frame, const options_t *opts)
+{
+    static const char *narrow[] = {"total",  "used",       "free",
+                                   "shared", "buff/cache", "available"};
+    static const char *wide[]   = {"total",  "used",     "free",
+                                   "active", "inactive", "wired",
+                                   "compressed", "available",
+                                   "pressure"};
+
+    const char **cols  = opts->wide ? wide : narrow;
+    size_t       ncols = opts->wide ? sizeof(wide) / sizeof(wide[0])
+                                    : sizeof(narrow) / sizeof(narrow[0]);
+
+    render_label(frame, "");
+    for (size_t i = 0; i < ncols; i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+}
+
+/*
+ * ============================================================================
+ * Display Functions
+ * ============================================================================
+ */
+
+/*
+ * Kernel pressure as shown in the wide Mem: row: the share of the last
+ * 10 seconds some task stalled on memory (Linux), or the level (macOS)
+ */
+static void format_pressure(const pressure_info_t *pressure, char *buf,
+                            size_t bufsize)
+{
+    if (!pressure->valid)
+    {
+        snprintf(buf, bufsize, "-");
+        return;
+    }
+
+    switch (pressure->level)
+    {
+        case 0:
+            snprintf(buf, bufsize, "%.2f%%", pressure->some_avg10);
+            break;
+        case PRESSURE_LEVEL_NORMAL:
+            snprintf(buf, bufsize, "normal");
+            break;
+        case PRESSURE_LEVEL_WARN:
+            snprintf(buf, bufsize, "warn");
+            break;
+        default:
+            snprintf(buf, bufsize, "critical");
+            break;
+    }
+}
+
+/* Memory row; pressure is NULL for the watermark rows */
+static void render_mem_row(frame_t *frame, const char *label,
+                           const mem_info_t *mem,
+                           const pressure_info_t *pressure,
+                           const options_t *opts)
 {
+    render_label(frame, label);
+    render_value(frame, mem->total, opts);
+    render_value(frame, mem->used, opts);
+    render_value(frame, mem->free, opts);
+
+    if (opts->wide)
+    {
+        render_value(frame, mem->active, opts);
+        render_value(frame, mem->inactive, opts);
+        render_value(frame, mem->wired, opts);
+        render_value(frame, mem->compressed, opts);
+    }
+    else
+    {
+        /* "shared" and "buff/cache" as defined by the backend */
+        render_value(frame, mem->shared, opts);
+        render_value(frame, mem->buff_cache, opts);
+    }
+    render_value(frame, mem->available, opts);
+
+    if (opts->wide && pressure != NULL)
+    {
+        char buf[32];
+
+        format_pressure(pressure, buf, sizeof(buf));
+        render_column(frame, buf, opts);
+    }
+    frame_putc(frame, '\n');
+}
+
+/* Swap row, padded to the width of the memory row */
+static void render_swap_row(frame_t *frame, const char *label,
+                            const swap_info_t *swap, const options_t *opts)
+{
+    render_label(frame, label);
+    render_value(frame, swap->total, opts);
+    render_value(frame, swap->used, opts);
+    render_value(frame, swap->free, opts);
+    render_padding(frame, opts->wide ? 6 : 3, opts);
+    frame_putc(frame, '\n');
+}
+
+/* Local time of day for a wall-clock time in ns since the epoch */
+static void format_clock(uint64_t walltime, char *buf, size_t bufsize)
+{
+    time_t    secs = (time_t)(walltime / 1000000000ULL);
+    struct tm tm;
+
+    if (localtime_r(&secs, &tm) == NULL ||
+        strftime(buf, bufsize, "%H:%M:%S", &tm) == 0)
+    {
+        snprintf(buf, bufsize, "?");
+    }
+}
+
+/* One "name value at HH:MM:SS" item of the peaks line */
+static void render_peak(frame_t *frame, const char *name, uint64_t bytes,
+                        uint64_t walltime, const options_t *opts)
+{
+    char value[32];
+    char clock[16];
+
     if (opts->unit == UNIT_HUMAN)
     {
-        if (opts->wide)
+        format_human(bytes, value, sizeof(value));
+    }
+    else
+    {
+        format_uint(scale_unit(bytes, opts->unit), value);
+    }
+    format_clock(walltime, clock, sizeof(clock));
+
+    frame_puts(frame, "  ");
+    frame_puts(frame, name);
+    frame_putc(frame, ' ');
+    frame_puts(frame, value);
+    frame_puts(frame, " at ");
+    frame_puts(frame, clock);
+}
+
+void render_numeric(frame_t *frame, const mem_info_t *mem,
+                    const swap_info_t *swap, const pressure_info_t *pressure,
+                    const options_t *opts)
+{
+    render_mem_row(frame, "Mem:", mem, pressure, opts);
+    render_swap_row(frame, "Swap:", swap, opts);
+}
+
+void render_lohi(frame_t *frame, const mem_info_t *mem,
+                 const swap_info_t *swap, const pressure_info_t *pressure,
+                 const lohi_t *lohi, const options_t *opts)
+{
+    render_mem_row(frame, "Mem:", mem, pressure, opts);
+    render_mem_row(frame, "Low:", &lohi->mem_low, NULL, opts);
+    render_mem_row(frame, "High:", &lohi->mem_high, NULL, opts);
+    render_swap_row(frame, "Swap:", swap, opts);
+    render_swap_row(frame, "Low:", &lohi->swap_low, opts);
+    render_swap_row(frame, "High:", &lohi->swap_high, opts);
+}
+
+void render_peaks(frame_t *frame, const lohi_t *lohi, const options_t *opts)
+{
+    size_t used      = LOHI_INDEX(mem_info_t, used);
+    size_t available = LOHI_INDEX(mem_info_t, available);
+    size_t swap_used = LOHI_INDEX(swap_info_t, used);
+
+    render_label(frame, "Peaks:");
+    render_peak(frame, "used", lohi->mem_high.used, lohi->mem_high_at[used],
+                opts);
+    render_peak(frame, "available", lohi->mem_low.available,
+                lohi->mem_low_at[available], opts);
+    render_peak(frame, "swap", lohi->swap_high.used,
+                lohi->swap_high_at[swap_used], opts);
+    frame_putc(frame, '\n');
+}
+
+void render_totals(frame_t *frame, const mem_info_t *mem,
+                   const swap_info_t *swap, const options_t *opts)
+{
+    uint64_t total_mem  = mem->total + swap->total;
+    uint64_t total_used = mem->used + swap->used;
+    uint64_t total_free = mem->free + swap->free;
+
+    render_label(frame, "Total:");
+    render_value(frame, total_mem, opts);
+    render_value(frame, total_used, opts);
+    render_value(frame, total_free, opts);
+    frame_putc(frame, '\n');
+}
+
+void render_rates(frame_t *frame, const vm_rates_t *rates)
+{
+    static const char *cols[] = {"pagein/s",   "pageout/s",    "swapin/s",
+                                 "swapout/s",  "compress/s",   "decompress/s",
+                                 "fault/s",    "purge/s"};
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        frame_putc(frame, ' ');
+        frame_put_right(frame, cols[i], COL_WIDTH_VALUE);
+    }
+    frame_putc(frame, '\n');
+
+    double values[] = {0, 0, 0, 0, 0, 0, 0, 0};
+    if (rates != NULL)
+    {
+        values[0] = rates->pageins;
+        values[1] = rates->pageouts;
+        values[2] = rates->swapins;
+        values[3] = rates->swapouts;
+        values[4] = rates->compressions;
+        values[5] = rates->decompressions;
+        values[6] = rates->faults;
+        values[7] = rates->purges;
+    }
+
+    render_label(frame, "Rates:");
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        char buf[UINT_BUF_SIZE];
+
+        if (rates != NULL)
         {
-            printf("%-7s %11s %11s %11s %11s %11s %11s %11s %11s\n", "",
-                   "total", "used", "free", "active", "inactive", "wired",
-                   "compressed", "available");
+            format_uint((uint64_t)(values[i] + 0.5), buf);
         }
         else
         {
-            printf("%-7s %11s %11s %11s %11s %11s %11s\n", "", "total", "used",
-                   "free", "shared", "buff/cache", "available");
+            /* No previous sample to take a delta from yet */
+            buf[0] = '-';
+            buf[1] = '\0';
         }
+
+        frame_putc(frame, ' ');
+        frame_put_right(frame, buf, COL_WIDTH_VALUE);
+    }
+    frame_putc(frame, '\n');
+}
+
+/* Label of a pool row: the page size, e.g. "2M:" or "1G:" */
+static void format_page_size(uint64_t bytes, char *buf, size_t bufsize)
+{
+    static const char units[] = "KMGT";
+    size_t            u       = 0;
+
+    bytes /= 1024;
+    while (bytes >= 1024 && bytes % 1024 == 0 && u + 1 < sizeof(units) - 1)
+    {
+        bytes /= 1024;
+        u++;
+    }
+
+    snprintf(buf, bufsize, "%llu%c:", (unsigned long long)bytes, units[u]);
+}
+
+/* A per-second rate, or "-" before there are two samples */
+static void render_rate(frame_t *frame, double rate, int valid,
+                        const options_t *opts)
+{
+    char buf[UINT_BUF_SIZE];
+
+    if (valid)
+    {
+        format_uint((uint64_t)(rate + 0.5), buf);
     }
     else
     {
-        if (opts->wide)
+        buf[0] = '-';
+        buf[1] = '\0';
+    }
+    render_column(frame, buf, opts);
+}
+
+void render_numa(frame_t *frame, const numa_t *numa, const options_t *opts)
+{
+    static const char *cols[] = {"total", "used",   "free",
+                                 "file",  "anon",   "miss/s",
+                                 "foreign/s"};
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t i = 0; i < numa->count; i++)
+    {
+        const numa_node_t *node = &numa->nodes[i];
+        char               label[16];
+
+        snprintf(label, sizeof(label), "Node%d:", node->id);
+        render_label(frame, label);
+        render_value(frame, node->total, opts);
+        render_value(frame, node->used, opts);
+        render_value(frame, node->free, opts);
+        render_value(frame, node->file, opts);
+        render_value(frame, node->anon, opts);
+
+        render_rate(frame, node->miss_rate, numa->has_rates, opts);
+        render_rate(frame, node->foreign_rate, numa->has_rates, opts);
+        frame_putc(frame, '\n');
+    }
+}
+
+void render_hugepages(frame_t *frame, const hugepages_t *huge,
+                      const options_t *opts)
+{
+    static const char *pool_cols[] = {"total", "free", "reserved", "surplus"};
+    static const char *thp_cols[]  = {"anon", "shmem", "file", "collapse/s",
+                                      "split/s"};
+    char               label[UINT_BUF_SIZE + 2];
+
+    /* Pool sizes in bytes, so -h and the unit options apply */
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(pool_cols) / sizeof(pool_cols[0]); i++)
+    {
+        render_column(frame, pool_cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t i = 0; i < huge->count; i++)
+    {
+        const hugepage_pool_t *pool = &huge->pools[i];
+
+        format_page_size(pool->page_size, label, sizeof(label));
+        render_label(frame, label);
+        render_value(frame, pool->total * pool->page_size, opts);
+        render_value(frame, pool->free * pool->page_size, opts);
+        render_value(frame, pool->reserved * pool->page_size, opts);
+        render_value(frame, pool->surplus * pool->page_size, opts);
+        frame_putc(frame, '\n');
+    }
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(thp_cols) / sizeof(thp_cols[0]); i++)
+    {
+        render_column(frame, thp_cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    render_label(frame, "THP:");
+    render_value(frame, huge->thp_anon, opts);
+    render_value(frame, huge->thp_shmem, opts);
+    render_value(frame, huge->thp_file, opts);
+    render_rate(frame, huge->collapse_rate, huge->has_rates, opts);
+    render_rate(frame, huge->split_rate, huge->has_rates, opts);
+    frame_putc(frame, '\n');
+}
+
+void render_compress(frame_t *frame, const compress_t *comp,
+                     const options_t *opts)
+{
+    static const char *cols[] = {"stored", "used", "ratio", "comp/s",
+                                 "decomp/s"};
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t i = 0; i < comp->count; i++)
+    {
+        const compress_pool_t *pool = &comp->pools[i];
+        char                   label[COMPRESS_NAME_MAX + 1];
+        char                   ratio[16];
+
+        snprintf(label, sizeof(label), "%s:", pool->name);
+        render_label(frame, label);
+        render_value(frame, pool->stored, opts);
+        render_value(frame, pool->used, opts);
+
+        /* Stored bytes per byte of RAM; "-" while the store is empty */
+        if (pool->used > 0)
         {
-            printf("%-7s %12s %12s %12s %12s %12s %12s %12s %12s\n", "",
-                   "total", "used", "free", "active", "inactive", "wired",
-                   "compressed", "available");
+            snprintf(ratio, sizeof(ratio), "%.2f",
+                     (double)pool->stored / (double)pool->used);
         }
         else
         {
-            printf("%-7s %12s %12s %12s %12s %12s %12s\n", "", "total", "used",
-                   "free", "shared", "buff/cache", "available");
+            snprintf(ratio, sizeof(ratio), "-");
         }
+        render_column(frame, ratio, opts);
+
+        render_rate(frame, pool->compress_rate, comp->has_rates, opts);
+        render_rate(frame, pool->decompress_rate, comp->has_rates, opts);
+        frame_putc(frame, '\n');
     }
 }
 
-/*
- * ============================================================================
- * Display Functions
- * ============================================================================
- */
-
-void print_numeric(const mem_info_t *mem, const swap_info_t *swap,
-                   const options_t *opts)
+/* Signed bytes-per-second slope in the display unit */
+static void format_slope(double slope, char *buf, size_t bufsize,
+                         const options_t *opts)
 {
-    /* Print memory row */
-    printf("%-7s", "Mem:");
-    print_value(mem->total, opts);
-    print_value(mem->used, opts);
-    print_value(mem->free, opts);
+    uint64_t magnitude = (uint64_t)((slope < 0.0 ? -slope : slope) + 0.5);
+    char     digits[32];
 
-    if (opts->wide)
+    if (opts->unit == UNIT_HUMAN)
     {
-        print_value(mem->active, opts);
-        print_value(mem->inactive, opts);
-        print_value(mem->wired, opts);
-        print_value(mem->compressed, opts);
+        format_human(magnitude, digits, sizeof(digits));
     }
     else
     {
-        /* "shared" - using compressed as approximation */
-        print_value(mem->compressed, opts);
-        /* "buff/cache" */
-        print_value(mem->cached + mem->inactive, opts);
+        format_uint(scale_unit(magnitude, opts->unit), digits);
     }
-    print_value(mem->available, opts);
-    printf("\n");
 
-    /* Print swap row */
-    printf("%-7s", "Swap:");
-    print_value(swap->total, opts);
-    print_value(swap->used, opts);
-    print_value(swap->free, opts);
+    if (strcmp(digits, "0") == 0 || strcmp(digits, "0B") == 0)
+    {
+        snprintf(buf, bufsize, "0");
+    }
+    else
+    {
+        snprintf(buf, bufsize, "%c%s", slope < 0.0 ? '-' : '+', digits);
+    }
+}
 
-    if (opts->wide)
+void render_trend(frame_t *frame, const trend_t *trend, const options_t *opts)
+{
+    static const char *cols[] = {"avail/s", "swap/s", "exhaustion",
+                                 "pressure"};
+    char               buf[48];
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        frame_putc(frame, ' ');
+        frame_put_right(frame, cols[i], COL_WIDTH_VALUE);
+    }
+    frame_putc(frame, '\n');
+
+    render_label(frame, "Trend:");
+
+    format_slope(trend->available_slope, buf, sizeof(buf), opts);
+    frame_putc(frame, ' ');
+    frame_put_right(frame, buf, COL_WIDTH_VALUE);
+
+    format_slope(trend->swap_slope, buf, sizeof(buf), opts);
+    frame_putc(frame, ' ');
+    frame_put_right(frame, buf, COL_WIDTH_VALUE);
+
+    format_duration(trend->exhaustion, buf, sizeof(buf));
+    frame_putc(frame, ' ');
+    frame_put_right(frame, buf, COL_WIDTH_VALUE);
+
+    snprintf(buf, sizeof(buf), "%.0f%%", trend->pressure * 100.0);
+    frame_putc(frame, ' ');
+    frame_put_right(frame, buf, COL_WIDTH_VALUE);
+    frame_putc(frame, '\n');
+}
+
+void render_summary(frame_t *frame, const summary_t *summary,
+                    const options_t *opts)
+{
+    static const char  *cols[]        = {"p50", "p95", "p99", "max"};
+    static const double percentiles[] = {50.0, 95.0, 99.0, 100.0};
+    char                span[32];
+    char                count[UINT_BUF_SIZE];
+
+    struct
     {
-        /* Pad remaining columns for alignment */
-        int num_cols = 5;
-        for (int i = 0; i < num_cols; i++)
+        const char        *label;
+        const histogram_t *hist;
+    } rows[] = {
+        {"Used:", &summary->used},
+        {"Avail:", &summary->available},
+        {"Compr:", &summary->compressed},
+        {"Swap:", &summary->swap_used},
+    };
+
+    format_uint(summary_count(summary), count);
+    format_duration((double)(summary->last - summary->first) / 1e9, span,
+                    sizeof(span));
+
+    frame_puts(frame, "Summary of ");
+    frame_puts(frame, count);
+    frame_puts(frame, " sample(s) over ");
+    frame_puts(frame, span);
+    frame_puts(frame, ":\n");
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); r++)
+    {
+        render_label(frame, rows[r].label);
+        for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]);
+             i++)
         {
-            if (opts->unit == UNIT_HUMAN)
-            {
-                printf(" %11s", "");
-            }
-            else
-            {
-                printf(" %12s", "");
-            }
+            render_value(frame,
+                         histogram_percentile(rows[r].hist, percentiles[i]),
+                         opts);
         }
+        frame_putc(frame, '\n');
     }
-    else
+}
+
+void render_top(frame_t *frame, const procs_t *procs, const options_t *opts)
+{
+    static const char *cols[] = {"rss", "swap", "compressed"};
+    char               buf[32];
+    char               count[UINT_BUF_SIZE];
+
+    /* First two columns: what identifies a row under each grouping */
+    static const char *keys[][2] = {
+        [GROUP_NONE]    = {"pid", "command"},
+        [GROUP_UID]     = {"uid", "processes"},
+        [GROUP_COMMAND] = {"procs", "command"},
+    };
+
+    static const char *nouns[] = {
+        [GROUP_NONE]    = "process(es)",
+        [GROUP_UID]     = "user(s)",
+        [GROUP_COMMAND] = "command(s)",
+    };
+
+    snprintf(buf, sizeof(buf), "Top %zu %s", procs->top_len,
+             nouns[procs->group_by]);
+    format_uint(procs->processes, count);
+    frame_puts(frame, buf);
+    frame_puts(frame, " by footprint, of ");
+    frame_puts(frame, count);
+    frame_puts(frame, " process(es):\n");
+
+    frame_put_right(frame, keys[procs->group_by][0], TOP_WIDTH_ID);
+    frame_putc(frame, ' ');
+    frame_put_left(frame, keys[procs->group_by][1], TOP_WIDTH_NAME);
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t i = 0; i < procs->top_len; i++)
     {
-        /* Pad remaining columns */
-        int num_cols = 3;
-        for (int i = 0; i < num_cols; i++)
+        const proc_entry_t *entry = &procs->top[i];
+
+        switch (procs->group_by)
         {
-            if (opts->unit == UNIT_HUMAN)
-            {
-                printf(" %11s", "");
-            }
-            else
-            {
-                printf(" %12s", "");
-            }
+            case GROUP_UID:
+                snprintf(buf, sizeof(buf), "%u", (unsigned)entry->uid);
+                format_uint(entry->count, count);
+                break;
+            case GROUP_COMMAND:
+                format_uint(entry->count, buf);
+                break;
+            case GROUP_NONE:
+            default:
+                snprintf(buf, sizeof(buf), "%d", (int)entry->pid);
+                break;
         }
+
+        frame_put_right(frame, buf, TOP_WIDTH_ID);
+        frame_putc(frame, ' ');
+        frame_put_left(frame,
+                       procs->group_by == GROUP_UID ? count : entry->name,
+                       TOP_WIDTH_NAME);
+        render_value(frame, entry->rss, opts);
+        render_value(frame, entry->swap, opts);
+        render_value(frame, entry->compressed, opts);
+        frame_putc(frame, '\n');
     }
-    printf("\n");
 }
 
-void print_human(const mem_info_t *mem, const swap_info_t *swap,
-                 const options_t *opts)
+/* One word for where a watched process stands */
+static const char *watch_status(const watch_entry_t *entry)
 {
-    /* Human format uses same function, just with UNIT_HUMAN */
-    print_numeric(mem, swap, opts);
+    if (!entry->alive)
+    {
+        return "exited";
+    }
+    if (entry->leaking)
+    {
+        return "LEAK?";
+    }
+    if (entry->len < WATCH_MIN_POINTS)
+    {
+        return "-";
+    }
+    return entry->rising > 0 ? "growing" : "stable";
 }
 
-void print_totals(const mem_info_t *mem, const swap_info_t *swap,
-                  const options_t *opts)
+void render_watch(frame_t *frame, const watch_t *watch, const options_t *opts)
 {
-    uint64_t total_mem  = mem->total + swap->total;
-    uint64_t total_used = mem->used + swap->used;
-    uint64_t total_free = mem->free + swap->free;
+    static const char *cols[] = {"rss",      "swap",  "compressed", "pss",
+                                 "growth/h", "status"};
+    char               buf[48];
+
+    frame_put_right(frame, "pid", TOP_WIDTH_ID);
+    frame_putc(frame, ' ');
+    frame_put_left(frame, "command", TOP_WIDTH_NAME);
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t i = 0; i < watch->count; i++)
+    {
+        const watch_entry_t *entry = &watch->entries[i];
+
+        snprintf(buf, sizeof(buf), "%d", (int)entry->handle.pid);
+        frame_put_right(frame, buf, TOP_WIDTH_ID);
+        frame_putc(frame, ' ');
+        frame_put_left(frame, entry->handle.name, TOP_WIDTH_NAME);
 
-    printf("%-7s", "Total:");
-    print_value(total_mem, opts);
-    print_value(total_used, opts);
-    print_value(total_free, opts);
-    printf("\n");
+        render_value(frame, entry->usage.rss, opts);
+        render_value(frame, entry->usage.swap, opts);
+        render_value(frame, entry->usage.compressed, opts);
+
+        if (entry->usage.has_pss)
+        {
+            render_value(frame, entry->usage.pss, opts);
+        }
+        else
+        {
+            render_column(frame, "-", opts);
+        }
+
+        if (entry->len >= WATCH_MIN_POINTS)
+        {
+            format_slope(entry->slope * 3600.0, buf, sizeof(buf), opts);
+            render_column(frame, buf, opts);
+        }
+        else
+        {
+            render_column(frame, "-", opts);
+        }
+
+        render_column(frame, watch_status(entry), opts);
+        frame_putc(frame, '\n');
+    }
 }
 
-void print_separator(const options_t *opts)
+static void render_maps_row(frame_t *frame, const char *label,
+                            const maps_usage_t *usage, const options_t *opts)
 {
-    int width;
+    char count[UINT_BUF_SIZE];
+
+    format_uint(usage->mappings, count);
+
+    render_label(frame, label);
+    render_column(frame, count, opts);
+    render_value(frame, usage->size, opts);
+    render_value(frame, usage->rss, opts);
+    render_value(frame, usage->pss, opts);
+    render_value(frame, usage->swap, opts);
+    render_value(frame, usage->dirty, opts);
+    frame_putc(frame, '\n');
+}
+
+void render_maps(frame_t *frame, const maps_t *maps, const options_t *opts)
+{
+    static const char *cols[]   = {"mappings", "size", "rss",
+                                   "pss",      "swap", "dirty"};
+    static const char *labels[] = {
+        [MAPS_HEAP] = "heap:",     [MAPS_STACK] = "stack:",
+        [MAPS_ANON] = "anon:",     [MAPS_FILE] = "file:",
+        [MAPS_SHARED] = "shared:", [MAPS_HUGE] = "huge:",
+        [MAPS_OTHER] = "other:",
+    };
+    char               buf[64];
+
+    snprintf(buf, sizeof(buf), "PID %d (%s):\n", maps->pid, maps->name);
+    frame_puts(frame, buf);
+
+    render_label(frame, "");
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (int c = 0; c < MAPS_CATEGORY_COUNT; c++)
+    {
+        render_maps_row(frame, labels[c], &maps->categories[c], opts);
+    }
+    render_maps_row(frame, "Total:", &maps->total, opts);
+}
+
+void render_cgtree(frame_t *frame, const cgtree_t *tree,
+                   const options_t *opts)
+{
+    static const char *cols[] = {"current", "anon", "file", "swap"};
+    char               buf[CGTREE_WIDTH_NAME + 32];
+
+    snprintf(buf, sizeof(buf), "%zu cgroup(s) read in %.1f ms", tree->count,
+             (double)tree->elapsed / NSEC_PER_MSEC);
+    frame_puts(frame, "Cgroup tree of ");
+    frame_puts(frame, tree->root);
+    frame_puts(frame, ", ");
+    frame_puts(frame, buf);
+    frame_puts(frame, ":\n");
+
+    frame_put_left(frame, "cgroup", CGTREE_WIDTH_NAME);
+    for (size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++)
+    {
+        render_column(frame, cols[i], opts);
+    }
+    frame_putc(frame, '\n');
+
+    for (size_t i = 0; i < tree->row_count; i++)
+    {
+        const cgtree_node_t *node = &tree->nodes[tree->rows[i]];
+        size_t               indent = 2 * (size_t)node->depth;
+
+        /* Indent by depth; long names are cut to keep the columns */
+        if (indent > CGTREE_WIDTH_NAME / 2)
+        {
+            indent = CGTREE_WIDTH_NAME / 2;
+        }
+        size_t len = strlen(node->name);
+        if (len > CGTREE_WIDTH_NAME - 1 - indent)
+        {
+            len = CGTREE_WIDTH_NAME - 1 - indent;
+        }
+        memset(buf, ' ', indent);
+        memcpy(buf + indent, node->name, len);
+        buf[indent + len] = '\0';
+
+        frame_put_left(frame, buf, CGTREE_WIDTH_NAME);
+        render_value(frame, node->current, opts);
+        render_value(frame, node->anon, opts);
+        render_value(frame, node->file, opts);
+        render_value(frame, node->swap, opts);
+        frame_putc(frame, '\n');
+    }
+
+    if (tree->omitted > 0)
+    {
+        snprintf(buf, sizeof(buf), "(%zu more subtree(s) not shown)\n",
+                 tree->omitted);
+        frame_puts(frame, buf);
+    }
+}
+
+void render_separator(frame_t *frame, const options_t *opts)
+{
+    size_t width;
     if (opts->wide)
     {
-        width = opts->unit == UNIT_HUMAN ? 97 : 115;
+        width = opts->unit == UNIT_HUMAN ? 109 : 128;
     }
     else
     {
         width = opts->unit == UNIT_HUMAN ? 67 : 79;
     }
 
-    for (int i = 0; i < width; i++)
-    {
-        putchar('-');
-    }
-    putchar('\n');
+    frame_fill(frame, '-', width);
+    frame_putc(frame, '\n');
 }
 
-void print_memory_info(const system_memory_t *sys_mem, const options_t *opts)
+void render_memory_info(frame_t *frame, const system_memory_t *sys_mem,
+                        const lohi_t *lohi, const options_t *opts)
 {
-    print_header(opts);
+    render_header(frame, opts);
 
-    if (opts->unit == UNIT_HUMAN)
+    if (lohi != NULL && lohi->samples > 0)
     {
-        print_human(&sys_mem->mem, &sys_mem->swap, opts);
+        render_lohi(frame, &sys_mem->mem, &sys_mem->swap, &sys_mem->pressure,
+                    lohi, opts);
     }
     else
     {
-        print_numeric(&sys_mem->mem, &sys_mem->swap, opts);
+        render_numeric(frame, &sys_mem->mem, &sys_mem->swap,
+                       &sys_mem->pressure, opts);
     }
 
     if (opts->totals)
     {
-        print_totals(&sys_mem->mem, &sys_mem->swap, opts);
+        render_totals(frame, &sys_mem->mem, &sys_mem->swap, opts);
     }
+
+    if (lohi != NULL && lohi->samples > 0)
+    {
+        render_peaks(frame, lohi, opts);
+    }
+}
+
+int print_memory_info(const system_memory_t *sys_mem, const options_t *opts)
+{
+    static frame_t frame;
+
+    frame_reset(&frame);
+    render_memory_info(&frame, sys_mem, NULL, opts);
+
+    return frame_flush(&frame, STDOUT_FILENO);
 }
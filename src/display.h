@@ -8,8 +8,20 @@
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
+#include "cgtree.h"
+#include "compress.h"
+#include "frame.h"
+#include "hugepages.h"
+#include "lohi.h"
+#include "maps.h"
 #include "memory.h"
+#include "numa.h"
+#include "procs.h"
+#include "rates.h"
+#include "summary.h"
+#include "trend.h"
 #include "utils.h"
+#include "watch.h"
 
 /*
  * ============================================================================
@@ -18,9 +30,16 @@
  */
 
 /* Column widths for formatting */
-#define COL_WIDTH_LABEL 5
+#define COL_WIDTH_LABEL 7
 #define COL_WIDTH_VALUE 12
-#define COL_WIDTH_HUMAN 10
+#define COL_WIDTH_HUMAN 11
+
+/* Identifier and name columns of the --top table */
+#define TOP_WIDTH_ID   7
+#define TOP_WIDTH_NAME 16
+
+/* Name column of the --cgroup-tree table, including indentation */
+#define CGTREE_WIDTH_NAME 40
 
 /* ANSI color codes (optional) */
 #define COLOR_RESET  "\033[0m"
@@ -37,55 +56,187 @@
  */
 
 /**
- * Print memory information header
+ * Render memory information header
  *
+ * @param frame Frame to append to
  * @param opts  Display options
  */
-void print_header(const options_t *opts);
+void render_header(frame_t *frame, const options_t *opts);
 
 /**
- * Print memory information in numeric format
+ * Render the Mem: and Swap: rows
  *
- * @param mem   Physical memory information
- * @param swap  Swap memory information
- * @param opts  Display options
+ * Values are formatted in the unit selected by opts, including
+ * human-readable output.
+ *
+ * @param frame     Frame to append to
+ * @param mem       Physical memory information
+ * @param swap      Swap memory information
+ * @param pressure  Kernel pressure, shown in wide mode
+ * @param opts      Display options
  */
-void print_numeric(const mem_info_t *mem, const swap_info_t *swap,
-                   const options_t *opts);
+void render_numeric(frame_t *frame, const mem_info_t *mem,
+                    const swap_info_t *swap, const pressure_info_t *pressure,
+                    const options_t *opts);
 
 /**
- * Print memory information in human-readable format
+ * Render the Mem and Swap rows, each followed by Low: and High: rows
+ * holding its watermarks
  *
- * @param mem   Physical memory information
- * @param swap  Swap memory information
- * @param opts  Display options
+ * @param frame     Frame to append to
+ * @param mem       Current memory information
+ * @param swap      Current swap information
+ * @param pressure  Kernel pressure, shown in wide mode
+ * @param lohi      Watermarks (at least one sample)
+ * @param opts      Display options
  */
-void print_human(const mem_info_t *mem, const swap_info_t *swap,
-                 const options_t *opts);
+void render_lohi(frame_t *frame, const mem_info_t *mem,
+                 const swap_info_t *swap, const pressure_info_t *pressure,
+                 const lohi_t *lohi, const options_t *opts);
 
 /**
- * Print all memory information
+ * Render when used and swap used peaked and available bottomed out
  *
- * @param sys_mem   System memory information
- * @param opts      Display options
+ * @param frame     Frame to append to
+ * @param lohi      Watermarks (at least one sample)
+ * @param opts      Display options (unit)
  */
-void print_memory_info(const system_memory_t *sys_mem, const options_t *opts);
+void render_peaks(frame_t *frame, const lohi_t *lohi, const options_t *opts);
 
 /**
- * Print a separator line
+ * Render a separator line
  *
+ * @param frame Frame to append to
  * @param opts  Display options (determines width)
  */
-void print_separator(const options_t *opts);
+void render_separator(frame_t *frame, const options_t *opts);
 
 /**
- * Print totals row
+ * Render totals row
  *
+ * @param frame Frame to append to
  * @param mem   Physical memory information
  * @param swap  Swap memory information
  * @param opts  Display options
  */
-void print_totals(const mem_info_t *mem, const swap_info_t *swap,
+void render_totals(frame_t *frame, const mem_info_t *mem,
+                   const swap_info_t *swap, const options_t *opts);
+
+/**
+ * Render the paging/compression rates table
+ *
+ * @param frame Frame to append to
+ * @param rates Rates to show, or NULL before a second sample exists
+ */
+void render_rates(frame_t *frame, const vm_rates_t *rates);
+
+/**
+ * Render one row per NUMA node, in the layout of the Mem: row
+ *
+ * @param frame     Frame to append to
+ * @param numa      Sampled nodes
+ * @param opts      Display options (unit)
+ */
+void render_numa(frame_t *frame, const numa_t *numa, const options_t *opts);
+
+/**
+ * Render each hugetlb pool, then transparent huge page usage and the
+ * khugepaged collapse and split rates
+ *
+ * @param frame     Frame to append to
+ * @param huge      Sampled huge page state
+ * @param opts      Display options (unit)
+ */
+void render_hugepages(frame_t *frame, const hugepages_t *huge,
+                      const options_t *opts);
+
+/**
+ * Render one row per compressed store: bytes stored and the RAM they
+ * take, the compression ratio and the compress and decompress rates
+ *
+ * @param frame     Frame to append to
+ * @param comp      Sampled stores
+ * @param opts      Display options (unit)
+ */
+void render_compress(frame_t *frame, const compress_t *comp,
+                     const options_t *opts);
+
+/**
+ * Render the trend table: available and swap slopes per second, time
+ * until exhaustion and memory pressure
+ *
+ * @param frame Frame to append to
+ * @param trend Trend to show
+ * @param opts  Display options (unit)
+ */
+void render_trend(frame_t *frame, const trend_t *trend, const options_t *opts);
+
+/**
+ * Render p50/p95/p99/max of the summarized fields
+ *
+ * @param frame     Frame to append to
+ * @param summary   Summary to show (must not be empty)
+ * @param opts      Display options (unit)
+ */
+void render_summary(frame_t *frame, const summary_t *summary,
+                    const options_t *opts);
+
+/**
+ * Render the largest processes or groups from the latest scan
+ *
+ * @param frame     Frame to append to
+ * @param procs     Scanner holding the top entries
+ * @param opts      Display options (unit)
+ */
+void render_top(frame_t *frame, const procs_t *procs, const options_t *opts);
+
+/**
+ * Render the watched processes with their growth and leak status
+ *
+ * @param frame     Frame to append to
+ * @param watch     Sampled watch
+ * @param opts      Display options (unit)
+ */
+void render_watch(frame_t *frame, const watch_t *watch,
                   const options_t *opts);
 
+/**
+ * Render a process's address space broken down by category
+ *
+ * @param frame     Frame to append to
+ * @param maps      Breakdown to show
+ * @param opts      Display options (unit)
+ */
+void render_maps(frame_t *frame, const maps_t *maps, const options_t *opts);
+
+/**
+ * Render a cgroup tree, each level indented and largest first
+ *
+ * @param frame     Frame to append to
+ * @param tree      Scanned tree
+ * @param opts      Display options (unit)
+ */
+void render_cgtree(frame_t *frame, const cgtree_t *tree,
+                   const options_t *opts);
+
+/**
+ * Render a complete table (header, rows and optional totals)
+ *
+ * @param frame     Frame to append to
+ * @param sys_mem   System memory information
+ * @param lohi      Watermarks to show with the rows, or NULL
+ * @param opts      Display options
+ */
+void render_memory_info(frame_t *frame, const system_memory_t *sys_mem,
+                        const lohi_t *lohi, const options_t *opts);
+
+/**
+ * Print all memory information to stdout with a single write
+ *
+ * @param sys_mem   System memory information
+ * @param opts      Display options
+ * @return          0 on success, -1 if the write failed
+ */
+int print_memory_info(const system_memory_t *sys_mem, const options_t *opts);
+
 #endif /* DISPLAY_H */
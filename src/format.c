@@ -0,0 +1,382 @@
+/*
+ * format.c - Machine-readable output formats implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "format.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Field Tables
+ * ============================================================================
+ */
+
+/* A uint64_t field of a struct, with the name used in every format */
+typedef struct
+{
+    const char *name;
+    size_t      offset;
+} field_t;
+
+#define MEM_FIELD(name)     {#name, offsetof(mem_info_t, name)}
+#define SWAP_FIELD(name)    {#name, offsetof(swap_info_t, name)}
+#define COUNTER_FIELD(name) {#name, offsetof(vm_counters_t, name)}
+
+static const field_t mem_fields[] = {
+    MEM_FIELD(total),      MEM_FIELD(used),       MEM_FIELD(free),
+    MEM_FIELD(active),     MEM_FIELD(inactive),   MEM_FIELD(wired),
+    MEM_FIELD(compressed), MEM_FIELD(cached),     MEM_FIELD(app_memory),
+    MEM_FIELD(available),  MEM_FIELD(shared),     MEM_FIELD(buff_cache),
+    MEM_FIELD(hugetlb),    MEM_FIELD(compressed_orig),
+    MEM_FIELD(thp_anon),   MEM_FIELD(thp_shmem),  MEM_FIELD(thp_file),
+};
+
+static const field_t swap_fields[] = {
+    SWAP_FIELD(total),
+    SWAP_FIELD(used),
+    SWAP_FIELD(free),
+};
+
+static const field_t counter_fields[] = {
+    COUNTER_FIELD(pageins),      COUNTER_FIELD(pageouts),
+    COUNTER_FIELD(swapins),      COUNTER_FIELD(swapouts),
+    COUNTER_FIELD(compressions), COUNTER_FIELD(decompressions),
+    COUNTER_FIELD(faults),       COUNTER_FIELD(purges),
+    COUNTER_FIELD(thp_collapses), COUNTER_FIELD(thp_splits),
+};
+
+#define NFIELDS(table) (sizeof(table) / sizeof(table[0]))
+
+/* One group of fields and where it lives in system_memory_t */
+typedef struct
+{
+    const char    *name;
+    const field_t *fields;
+    size_t         nfields;
+    size_t         offset;
+} group_t;
+
+static const group_t groups[] = {
+    {"mem", mem_fields, NFIELDS(mem_fields), offsetof(system_memory_t, mem)},
+    {"swap", swap_fields, NFIELDS(swap_fields),
+     offsetof(system_memory_t, swap)},
+    {"counters", counter_fields, NFIELDS(counter_fields),
+     offsetof(system_memory_t, counters)},
+};
+
+/* Counters are only collected with --rates */
+static size_t group_count(const options_t *opts)
+{
+    return opts->rates ? NFIELDS(groups) : NFIELDS(groups) - 1;
+}
+
+static uint64_t field_value(const system_memory_t *sys_mem,
+                            const group_t *group, const field_t *field)
+{
+    const char *base = (const char *)sys_mem + group->offset;
+    uint64_t    value;
+
+    memcpy(&value, base + field->offset, sizeof(value));
+    return value;
+}
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+/* Seconds since the epoch with millisecond precision, e.g. 1700000000.123 */
+static void put_walltime(frame_t *frame, uint64_t walltime)
+{
+    uint64_t ms   = walltime / 1000000ULL;
+    uint64_t frac = ms % 1000;
+
+    frame_put_uint(frame, ms / 1000);
+    frame_putc(frame, '.');
+    frame_putc(frame, (char)('0' + frac / 100));
+    frame_putc(frame, (char)('0' + frac / 10 % 10));
+    frame_putc(frame, (char)('0' + frac % 10));
+}
+
+/* A double with a fixed number of decimals, e.g. 12.34 */
+static void put_fixed(frame_t *frame, double value, int decimals)
+{
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    frame_puts(frame, buf);
+}
+
+static const char *pressure_level_name(uint32_t level)
+{
+    switch (level)
+    {
+        case PRESSURE_LEVEL_NORMAL:
+            return "normal";
+        case PRESSURE_LEVEL_WARN:
+            return "warn";
+        default:
+            return "critical";
+    }
+}
+
+/*
+ * ============================================================================
+ * Format Selection
+ * ============================================================================
+ */
+
+int parse_format(const char *name, output_format_t *format)
+{
+    if (strcmp(name, "table") == 0)
+    {
+        *format = FORMAT_TABLE;
+    }
+    else if (strcmp(name, "json") == 0)
+    {
+        *format = FORMAT_JSON;
+    }
+    else if (strcmp(name, "csv") == 0)
+    {
+        *format = FORMAT_CSV;
+    }
+    else if (strcmp(name, "openmetrics") == 0)
+    {
+        *format = FORMAT_OPENMETRICS;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * JSON Lines
+ * ============================================================================
+ */
+
+void render_json(frame_t *frame, const system_memory_t *sys_mem,
+                 const options_t *opts)
+{
+    frame_puts(frame, "{\"time\":");
+    put_walltime(frame, sys_mem->walltime);
+    frame_puts(frame, ",\"monotonic_ns\":");
+    frame_put_uint(frame, sys_mem->timestamp);
+    frame_puts(frame, ",\"page_size\":");
+    frame_put_uint(frame, sys_mem->page_size);
+
+    for (size_t g = 0; g < group_count(opts); g++)
+    {
+        const group_t *group = &groups[g];
+
+        frame_puts(frame, ",\"");
+        frame_puts(frame, group->name);
+        frame_puts(frame, "\":{");
+
+        for (size_t i = 0; i < group->nfields; i++)
+        {
+            if (i > 0)
+            {
+                frame_putc(frame, ',');
+            }
+            frame_putc(frame, '"');
+            frame_puts(frame, group->fields[i].name);
+            frame_puts(frame, "\":");
+            frame_put_uint(frame,
+                           field_value(sys_mem, group, &group->fields[i]));
+        }
+
+        frame_putc(frame, '}');
+    }
+
+    /* Only when the kernel reported it; PSI on Linux, a level on macOS */
+    const pressure_info_t *pressure = &sys_mem->pressure;
+    if (pressure->valid && pressure->level != 0)
+    {
+        frame_puts(frame, ",\"pressure\":{\"level\":\"");
+        frame_puts(frame, pressure_level_name(pressure->level));
+        frame_puts(frame, "\"}");
+    }
+    else if (pressure->valid)
+    {
+        frame_puts(frame, ",\"pressure\":{\"some_avg10\":");
+        put_fixed(frame, pressure->some_avg10, 2);
+        frame_puts(frame, ",\"some_avg60\":");
+        put_fixed(frame, pressure->some_avg60, 2);
+        frame_puts(frame, ",\"full_avg10\":");
+        put_fixed(frame, pressure->full_avg10, 2);
+        frame_puts(frame, ",\"full_avg60\":");
+        put_fixed(frame, pressure->full_avg60, 2);
+        frame_puts(frame, ",\"some_total_us\":");
+        frame_put_uint(frame, pressure->some_total);
+        frame_puts(frame, ",\"full_total_us\":");
+        frame_put_uint(frame, pressure->full_total);
+        frame_putc(frame, '}');
+    }
+
+    frame_puts(frame, "}\n");
+}
+
+/*
+ * ============================================================================
+ * CSV
+ * ============================================================================
+ */
+
+void render_csv_header(frame_t *frame, const options_t *opts)
+{
+    frame_puts(frame, "time,monotonic_ns,page_size");
+
+    for (size_t g = 0; g < group_count(opts); g++)
+    {
+        for (size_t i = 0; i < groups[g].nfields; i++)
+        {
+            frame_putc(frame, ',');
+            frame_puts(frame, groups[g].name);
+            frame_putc(frame, '_');
+            frame_puts(frame, groups[g].fields[i].name);
+        }
+    }
+
+    frame_putc(frame, '\n');
+}
+
+void render_csv(frame_t *frame, const system_memory_t *sys_mem,
+                const options_t *opts)
+{
+    put_walltime(frame, sys_mem->walltime);
+    frame_putc(frame, ',');
+    frame_put_uint(frame, sys_mem->timestamp);
+    frame_putc(frame, ',');
+    frame_put_uint(frame, sys_mem->page_size);
+
+    for (size_t g = 0; g < group_count(opts); g++)
+    {
+        for (size_t i = 0; i < groups[g].nfields; i++)
+        {
+            frame_putc(frame, ',');
+            frame_put_uint(frame, field_value(sys_mem, &groups[g],
+                                              &groups[g].fields[i]));
+        }
+    }
+
+    frame_putc(frame, '\n');
+}
+
+/*
+ * ============================================================================
+ * OpenMetrics
+ * ============================================================================
+ */
+
+static void render_family(frame_t *frame, const system_memory_t *sys_mem,
+                          const group_t *group, const char *family,
+                          const char *type, const char *unit,
+                          const char *label)
+{
+    frame_puts(frame, "# TYPE ");
+    frame_puts(frame, family);
+    frame_putc(frame, ' ');
+    frame_puts(frame, type);
+    frame_putc(frame, '\n');
+
+    if (unit != NULL)
+    {
+        frame_puts(frame, "# UNIT ");
+        frame_puts(frame, family);
+        frame_putc(frame, ' ');
+        frame_puts(frame, unit);
+        frame_putc(frame, '\n');
+    }
+
+    for (size_t i = 0; i < group->nfields; i++)
+    {
+        frame_puts(frame, family);
+        if (strcmp(type, "counter") == 0)
+        {
+            frame_puts(frame, "_total");
+        }
+        frame_putc(frame, '{');
+        frame_puts(frame, label);
+        frame_puts(frame, "=\"");
+        frame_puts(frame, group->fields[i].name);
+        frame_puts(frame, "\"} ");
+        frame_put_uint(frame, field_value(sys_mem, group, &group->fields[i]));
+        frame_putc(frame, '\n');
+    }
+}
+
+/* Stall ratios and totals from PSI, or the macOS pressure level */
+static void render_pressure(frame_t *frame, const pressure_info_t *pressure)
+{
+    if (pressure->level != 0)
+    {
+        frame_puts(frame, "# TYPE free_pressure_level gauge\n");
+        frame_puts(frame, "free_pressure_level ");
+        frame_put_uint(frame, pressure->level);
+        frame_putc(frame, '\n');
+        return;
+    }
+
+    const struct
+    {
+        const char *labels;
+        double      avg;
+    } ratios[] = {
+        {"kind=\"some\",window=\"10s\"", pressure->some_avg10},
+        {"kind=\"some\",window=\"60s\"", pressure->some_avg60},
+        {"kind=\"full\",window=\"10s\"", pressure->full_avg10},
+        {"kind=\"full\",window=\"60s\"", pressure->full_avg60},
+    };
+
+    frame_puts(frame, "# TYPE free_pressure_stall_ratio gauge\n");
+    frame_puts(frame, "# UNIT free_pressure_stall_ratio ratio\n");
+    for (size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++)
+    {
+        frame_puts(frame, "free_pressure_stall_ratio{");
+        frame_puts(frame, ratios[i].labels);
+        frame_puts(frame, "} ");
+        put_fixed(frame, ratios[i].avg / 100.0, 4);
+        frame_putc(frame, '\n');
+    }
+
+    frame_puts(frame, "# TYPE free_pressure_stall_seconds counter\n");
+    frame_puts(frame, "# UNIT free_pressure_stall_seconds seconds\n");
+    frame_puts(frame, "free_pressure_stall_seconds_total{kind=\"some\"} ");
+    put_fixed(frame, (double)pressure->some_total / 1e6, 6);
+    frame_puts(frame, "\nfree_pressure_stall_seconds_total{kind=\"full\"} ");
+    put_fixed(frame, (double)pressure->full_total / 1e6, 6);
+    frame_putc(frame, '\n');
+}
+
+void render_openmetrics(frame_t *frame, const system_memory_t *sys_mem,
+                        const options_t *opts)
+{
+    render_family(frame, sys_mem, &groups[0], "free_memory_bytes", "gauge",
+                  "bytes", "kind");
+    render_family(frame, sys_mem, &groups[1], "free_swap_bytes", "gauge",
+                  "bytes", "kind");
+
+    if (opts->rates)
+    {
+        render_family(frame, sys_mem, &groups[2], "free_vm_events", "counter",
+                      NULL, "event");
+    }
+
+    if (sys_mem->pressure.valid)
+    {
+        render_pressure(frame, &sys_mem->pressure);
+    }
+
+    frame_puts(frame, "# EOF\n");
+}
@@ -0,0 +1,68 @@
+/*
+ * format.h - Machine-readable output formats
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include "frame.h"
+#include "memory.h"
+#include "utils.h"
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Parse an output format name
+ *
+ * @param name      "table", "json", "csv" or "openmetrics"
+ * @param format    Parsed format
+ * @return          0 on success, -1 if the name is unknown
+ */
+int parse_format(const char *name, output_format_t *format);
+
+/**
+ * Render a sample as one JSON object on a single line (JSON Lines)
+ *
+ * @param frame     Frame to append to
+ * @param sys_mem   Sample to render
+ * @param opts      Display options (counters are included with --rates)
+ */
+void render_json(frame_t *frame, const system_memory_t *sys_mem,
+                 const options_t *opts);
+
+/**
+ * Render the CSV header line
+ *
+ * @param frame     Frame to append to
+ * @param opts      Display options (counters are included with --rates)
+ */
+void render_csv_header(frame_t *frame, const options_t *opts);
+
+/**
+ * Render a sample as one CSV line
+ *
+ * @param frame     Frame to append to
+ * @param sys_mem   Sample to render
+ * @param opts      Display options (counters are included with --rates)
+ */
+void render_csv(frame_t *frame, const system_memory_t *sys_mem,
+                const options_t *opts);
+
+/**
+ * Render a sample as an OpenMetrics exposition, terminated by "# EOF"
+ *
+ * @param frame     Frame to append to
+ * @param sys_mem   Sample to render
+ * @param opts      Display options (counters are included with --rates)
+ */
+void render_openmetrics(frame_t *frame, const system_memory_t *sys_mem,
+                        const options_t *opts);
+
+#endif /* FORMAT_H */
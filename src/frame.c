@@ -0,0 +1,137 @@
+/*
+ * frame.c - Preallocated output buffer implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "frame.h"
+
+#include "utils.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Append Functions
+ * ============================================================================
+ */
+
+void frame_reset(frame_t *frame)
+{
+    frame->len       = 0;
+    frame->truncated = 0;
+}
+
+void frame_append(frame_t *frame, const char *data, size_t len)
+{
+    size_t room = sizeof(frame->buf) - frame->len;
+
+    if (len > room)
+    {
+        len              = room;
+        frame->truncated = 1;
+    }
+
+    memcpy(frame->buf + frame->len, data, len);
+    frame->len += len;
+}
+
+void frame_puts(frame_t *frame, const char *str)
+{
+    frame_append(frame, str, strlen(str));
+}
+
+void frame_putc(frame_t *frame, char c)
+{
+    if (frame->len < sizeof(frame->buf))
+    {
+        frame->buf[frame->len++] = c;
+    }
+    else
+    {
+        frame->truncated = 1;
+    }
+}
+
+void frame_fill(frame_t *frame, char c, size_t count)
+{
+    size_t room = sizeof(frame->buf) - frame->len;
+
+    if (count > room)
+    {
+        count            = room;
+        frame->truncated = 1;
+    }
+
+    memset(frame->buf + frame->len, c, count);
+    frame->len += count;
+}
+
+void frame_put_right(frame_t *frame, const char *str, size_t width)
+{
+    size_t len = strlen(str);
+
+    if (len < width)
+    {
+        frame_fill(frame, ' ', width - len);
+    }
+    frame_append(frame, str, len);
+}
+
+void frame_put_left(frame_t *frame, const char *str, size_t width)
+{
+    size_t len = strlen(str);
+
+    frame_append(frame, str, len);
+    if (len < width)
+    {
+        frame_fill(frame, ' ', width - len);
+    }
+}
+
+void frame_put_uint(frame_t *frame, uint64_t value)
+{
+    char   buf[UINT_BUF_SIZE];
+    size_t len = format_uint(value, buf);
+    frame_append(frame, buf, len);
+}
+
+/*
+ * ============================================================================
+ * Output Functions
+ * ============================================================================
+ */
+
+int frame_write(const frame_t *frame, int fd)
+{
+    const char *p      = frame->buf;
+    size_t      remain = frame->len;
+
+    while (remain > 0)
+    {
+        ssize_t n = write(fd, p, remain);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        remain -= (size_t)n;
+    }
+
+    return 0;
+}
+
+int frame_flush(frame_t *frame, int fd)
+{
+    int status = frame_write(frame, fd);
+
+    frame_reset(frame);
+    return status;
+}
@@ -0,0 +1,140 @@
+/*
+ * frame.h - Preallocated output buffer for whole frames
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/* Capacity of one frame; main.c checks it against the longest table */
+#define FRAME_BUF_SIZE 32768
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Output frame
+ *
+ * Everything printed for one refresh is appended here and emitted with a
+ * single write(), so a frame never reaches the reader half-finished and
+ * never interleaves with other writers on the same pipe. Appends past
+ * the capacity are dropped and flagged rather than reallocating.
+ */
+typedef struct
+{
+    char   buf[FRAME_BUF_SIZE]; /* Frame contents */
+    size_t len;                 /* Bytes used */
+    int    truncated;           /* Set if an append did not fit */
+} frame_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Empty a frame
+ *
+ * @param frame     Frame to reset
+ */
+void frame_reset(frame_t *frame);
+
+/**
+ * Append raw bytes
+ *
+ * @param frame     Frame to append to
+ * @param data      Bytes to append
+ * @param len       Number of bytes
+ */
+void frame_append(frame_t *frame, const char *data, size_t len);
+
+/**
+ * Append a NUL-terminated string
+ *
+ * @param frame     Frame to append to
+ * @param str       String to append
+ */
+void frame_puts(frame_t *frame, const char *str);
+
+/**
+ * Append a single character
+ *
+ * @param frame     Frame to append to
+ * @param c         Character to append
+ */
+void frame_putc(frame_t *frame, char c);
+
+/**
+ * Append a character repeated count times
+ *
+ * @param frame     Frame to append to
+ * @param c         Character to repeat
+ * @param count     Repetitions
+ */
+void frame_fill(frame_t *frame, char c, size_t count);
+
+/**
+ * Append a string right-aligned in a field (like "%*s")
+ *
+ * @param frame     Frame to append to
+ * @param str       String to append
+ * @param width     Field width
+ */
+void frame_put_right(frame_t *frame, const char *str, size_t width);
+
+/**
+ * Append a string left-aligned in a field (like "%-*s")
+ *
+ * @param frame     Frame to append to
+ * @param str       String to append
+ * @param width     Field width
+ */
+void frame_put_left(frame_t *frame, const char *str, size_t width);
+
+/**
+ * Append an unsigned integer in decimal
+ *
+ * @param frame     Frame to append to
+ * @param value     Value to append
+ */
+void frame_put_uint(frame_t *frame, uint64_t value);
+
+/**
+ * Write the frame to a file descriptor, keeping its contents
+ *
+ * Retries partial writes and EINTR so the frame goes out whole; used to
+ * send the same frame to several descriptors.
+ *
+ * @param frame     Frame to write
+ * @param fd        Destination file descriptor
+ * @return          0 on success, -1 on error
+ */
+int frame_write(const frame_t *frame, int fd);
+
+/**
+ * Write the frame to a file descriptor and reset it
+ *
+ * Retries partial writes and EINTR so the frame goes out whole.
+ *
+ * @param frame     Frame to flush
+ * @param fd        Destination file descriptor
+ * @return          0 on success, -1 on error
+ */
+int frame_flush(frame_t *frame, int fd);
+
+#endif /* FRAME_H */
@@ -0,0 +1,142 @@
+/*
+ * histogram.c - Fixed-memory log-linear (HDR-style) histograms
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "histogram.h"
+
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Bucket Mapping
+ * ============================================================================
+ */
+
+/* Position of the highest set bit; value must be non-zero */
+static unsigned highest_bit(uint64_t value)
+{
+    unsigned bit = 0;
+
+    while (value >>= 1)
+    {
+        bit++;
+    }
+
+    return bit;
+}
+
+/*
+ * Values below 2 * HISTOGRAM_HALF map to themselves. Larger values are
+ * shifted right until they fit in HISTOGRAM_SUB_BITS bits; the shift
+ * picks the group of HISTOGRAM_HALF buckets and the remaining bits the
+ * bucket within it.
+ */
+static unsigned bucket_index(uint64_t value)
+{
+    if (value < 2 * HISTOGRAM_HALF)
+    {
+        return (unsigned)value;
+    }
+
+    unsigned shift = highest_bit(value) - (HISTOGRAM_SUB_BITS - 1);
+
+    return HISTOGRAM_HALF * shift + (unsigned)(value >> shift);
+}
+
+/* Smallest value that maps to a bucket */
+static uint64_t bucket_low(unsigned index)
+{
+    if (index < 2 * HISTOGRAM_HALF)
+    {
+        return index;
+    }
+
+    unsigned shift    = index / HISTOGRAM_HALF - 1;
+    uint64_t mantissa = HISTOGRAM_HALF + index % HISTOGRAM_HALF;
+
+    return mantissa << shift;
+}
+
+/* Number of values that map to a bucket */
+static uint64_t bucket_width(unsigned index)
+{
+    if (index < 2 * HISTOGRAM_HALF)
+    {
+        return 1;
+    }
+
+    return 1ULL << (index / HISTOGRAM_HALF - 1);
+}
+
+/*
+ * ============================================================================
+ * Histogram Functions
+ * ============================================================================
+ */
+
+void histogram_reset(histogram_t *hist)
+{
+    memset(hist, 0, sizeof(histogram_t));
+}
+
+void histogram_record(histogram_t *hist, uint64_t value)
+{
+    hist->counts[bucket_index(value)]++;
+
+    if (hist->total == 0 || value < hist->min)
+    {
+        hist->min = value;
+    }
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+
+    hist->total++;
+}
+
+uint64_t histogram_percentile(const histogram_t *hist, double percentile)
+{
+    if (hist->total == 0)
+    {
+        return 0;
+    }
+
+    if (percentile >= 100.0)
+    {
+        return hist->max;
+    }
+
+    /* Rank of the value we want, 1-based, rounded up */
+    double   target = percentile / 100.0 * (double)hist->total;
+    uint64_t rank   = (uint64_t)target;
+    if ((double)rank < target || rank == 0)
+    {
+        rank++;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += hist->counts[i];
+        if (seen >= rank)
+        {
+            uint64_t value = bucket_low(i) + (bucket_width(i) - 1) / 2;
+
+            if (value < hist->min)
+            {
+                value = hist->min;
+            }
+            if (value > hist->max)
+            {
+                value = hist->max;
+            }
+            return value;
+        }
+    }
+
+    return hist->max;
+}
@@ -0,0 +1,83 @@
+/*
+ * histogram.h - Fixed-memory log-linear (HDR-style) histograms
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/*
+ * Values below 2^HISTOGRAM_SUB_BITS are counted exactly. Above that,
+ * each power of two is split into 2^(HISTOGRAM_SUB_BITS - 1) equal
+ * buckets, bounding the relative error at 2^-(HISTOGRAM_SUB_BITS - 1)
+ * (under 1%) across the whole 64-bit range.
+ */
+#define HISTOGRAM_SUB_BITS 8
+#define HISTOGRAM_HALF     (1U << (HISTOGRAM_SUB_BITS - 1))
+#define HISTOGRAM_BUCKETS  (HISTOGRAM_HALF * (64 - HISTOGRAM_SUB_BITS + 2))
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Histogram
+ *
+ * Fixed size, no allocation: recording is O(1) and memory use does not
+ * grow with the number of values recorded. The exact minimum and
+ * maximum are kept alongside the buckets.
+ */
+typedef struct
+{
+    uint64_t counts[HISTOGRAM_BUCKETS]; /* Values per bucket */
+    uint64_t total;                     /* Values recorded */
+    uint64_t min;                       /* Smallest value recorded */
+    uint64_t max;                       /* Largest value recorded */
+} histogram_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Empty a histogram
+ *
+ * @param hist      Histogram to reset
+ */
+void histogram_reset(histogram_t *hist);
+
+/**
+ * Record one value
+ *
+ * @param hist      Histogram to record into
+ * @param value     Value to record
+ */
+void histogram_record(histogram_t *hist, uint64_t value);
+
+/**
+ * Estimate a percentile
+ *
+ * Returns the midpoint of the bucket holding the value at that rank,
+ * clamped to the exact minimum and maximum.
+ *
+ * @param hist      Histogram to query
+ * @param percentile Percentile, 0.0 - 100.0
+ * @return          Estimated value, or 0 if the histogram is empty
+ */
+uint64_t histogram_percentile(const histogram_t *hist, double percentile);
+
+#endif /* HISTOGRAM_H */
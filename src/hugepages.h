@@ -0,0 +1,102 @@
+/*
+ * hugepages.h - Huge page pools and transparent huge page usage
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include "memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define HUGEPAGES_MAX_SIZES 8 /* Page sizes shown (x86 has 2M and 1G) */
+
+/* Per-size counters, in the order of hugepage_pool_t.fds */
+enum
+{
+    HUGEPAGES_NR,      /* nr_hugepages */
+    HUGEPAGES_FREE,    /* free_hugepages */
+    HUGEPAGES_RESV,    /* resv_hugepages */
+    HUGEPAGES_SURPLUS, /* surplus_hugepages */
+    HUGEPAGES_NFILES
+};
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* The hugetlb pool of one page size */
+typedef struct
+{
+    uint64_t page_size;             /* Bytes per page */
+    int      fds[HUGEPAGES_NFILES]; /* Counter files, kept open */
+    uint64_t total;                 /* Pages in the pool */
+    uint64_t free;                  /* Pages not mapped by anyone */
+    uint64_t reserved;              /* Free pages promised to mappings */
+    uint64_t surplus;               /* Pages beyond nr_hugepages */
+} hugepage_pool_t;
+
+/*
+ * Huge page state
+ *
+ * Pool counters stay open, one small file per value; transparent huge
+ * pages come from the memory sample.
+ */
+typedef struct
+{
+    hugepage_pool_t pools[HUGEPAGES_MAX_SIZES]; /* By page size */
+    size_t          count;                      /* Entries in pools */
+    uint64_t        thp_anon;                   /* AnonHugePages, bytes */
+    uint64_t        thp_shmem;                  /* ShmemHugePages, bytes */
+    uint64_t        thp_file;                   /* FileHugePages, bytes */
+    uint64_t        collapses;                  /* Collapsed by khugepaged */
+    uint64_t        splits;                     /* thp_split_page */
+    double          collapse_rate;              /* Collapses per second */
+    double          split_rate;                 /* Splits per second */
+    uint64_t        timestamp;                  /* Time of the last sample */
+    int             has_rates;                  /* Rates span two samples */
+} hugepages_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Open the pool counters of every huge page size
+ *
+ * @param huge      State to initialize
+ * @return          0 on success, -1 on error (or not Linux)
+ */
+int hugepages_init(hugepages_t *huge);
+
+/**
+ * Read every pool and take transparent huge page usage from a sample
+ *
+ * @param huge      Initialized state
+ * @param sys_mem   Sample taken with event counters
+ * @return          0 on success, -1 on error
+ */
+int hugepages_sample(hugepages_t *huge, const system_memory_t *sys_mem);
+
+/**
+ * Close every counter file
+ *
+ * @param huge      State to clean up
+ */
+void hugepages_cleanup(hugepages_t *huge);
+
+#endif /* HUGEPAGES_H */
@@ -0,0 +1,41 @@
+/*
+ * hugepages_darwin.c - Huge page pools, unavailable on macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "hugepages.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+/*
+ * macOS has no reserved pool: superpages are requested per mapping with
+ * VM_FLAGS_SUPERPAGE_* and come from the regular free list.
+ */
+int hugepages_init(hugepages_t *huge)
+{
+    memset(huge, 0, sizeof(hugepages_t));
+
+    fprintf(stderr, "Error: --hugepages is only supported on Linux\n");
+    return -1;
+}
+
+int hugepages_sample(hugepages_t *huge, const system_memory_t *sys_mem)
+{
+    (void)huge;
+    (void)sys_mem;
+    return -1;
+}
+
+void hugepages_cleanup(hugepages_t *huge)
+{
+    huge->count = 0;
+}
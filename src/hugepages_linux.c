@@ -0,0 +1,186 @@
+/*
+ * hugepages_linux.c - Huge page pools from /sys/kernel/mm/hugepages
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "hugepages.h"
+
+#include "procfs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define POOL_DIR      "/sys/kernel/mm/hugepages"
+#define POOL_PATH_MAX 128
+
+static const char *const pool_files[HUGEPAGES_NFILES] = {
+    "nr_hugepages", "free_hugepages", "resv_hugepages", "surplus_hugepages"};
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+static int compare_pools(const void *a, const void *b)
+{
+    const hugepage_pool_t *x = a;
+    const hugepage_pool_t *y = b;
+
+    return (x->page_size > y->page_size) - (x->page_size < y->page_size);
+}
+
+/* Open the counters of "hugepages-<size>kB"; 0 on success */
+static int open_pool(hugepage_pool_t *pool, const char *name)
+{
+    char  path[POOL_PATH_MAX];
+    char *end;
+
+    if (strncmp(name, "hugepages-", 10) != 0)
+    {
+        return -1;
+    }
+
+    unsigned long long kib = strtoull(name + 10, &end, 10);
+    if (kib == 0 || strcmp(end, "kB") != 0)
+    {
+        return -1;
+    }
+
+    pool->page_size = (uint64_t)kib * 1024;
+
+    for (int i = 0; i < HUGEPAGES_NFILES; i++)
+    {
+        int n = snprintf(path, sizeof(path), POOL_DIR "/%s/%s", name,
+                         pool_files[i]);
+        pool->fds[i] = n > 0 && (size_t)n < sizeof(path)
+                           ? open(path, O_RDONLY | O_CLOEXEC)
+                           : -1;
+        if (pool->fds[i] < 0)
+        {
+            while (i-- > 0)
+            {
+                close(pool->fds[i]);
+            }
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_count(int fd, uint64_t *value)
+{
+    char buf[32];
+
+    ssize_t len = procfs_read(fd, buf, sizeof(buf));
+    if (len <= 0)
+    {
+        return -1;
+    }
+
+    procfs_parse_uint(buf, buf + len, value);
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+int hugepages_init(hugepages_t *huge)
+{
+    struct dirent *ent;
+
+    memset(huge, 0, sizeof(hugepages_t));
+
+    /* No directory means a kernel without hugetlbfs: no pools to show */
+    DIR *dir = opendir(POOL_DIR);
+    while (dir != NULL && (ent = readdir(dir)) != NULL &&
+           huge->count < HUGEPAGES_MAX_SIZES)
+    {
+        if (open_pool(&huge->pools[huge->count], ent->d_name) == 0)
+        {
+            huge->count++;
+        }
+    }
+    if (dir != NULL)
+    {
+        closedir(dir);
+    }
+
+    qsort(huge->pools, huge->count, sizeof(hugepage_pool_t), compare_pools);
+
+    return 0;
+}
+
+int hugepages_sample(hugepages_t *huge, const system_memory_t *sys_mem)
+{
+    uint64_t now       = sys_mem->timestamp;
+    uint64_t collapses = huge->collapses;
+    uint64_t splits    = huge->splits;
+
+    for (size_t i = 0; i < huge->count; i++)
+    {
+        hugepage_pool_t *pool = &huge->pools[i];
+
+        if (read_count(pool->fds[HUGEPAGES_NR], &pool->total) != 0 ||
+            read_count(pool->fds[HUGEPAGES_FREE], &pool->free) != 0 ||
+            read_count(pool->fds[HUGEPAGES_RESV], &pool->reserved) != 0 ||
+            read_count(pool->fds[HUGEPAGES_SURPLUS], &pool->surplus) != 0)
+        {
+            perror("read " POOL_DIR);
+            return -1;
+        }
+    }
+
+    /* The backend read these along with the rest of the sample */
+    huge->thp_anon  = sys_mem->mem.thp_anon;
+    huge->thp_shmem = sys_mem->mem.thp_shmem;
+    huge->thp_file  = sys_mem->mem.thp_file;
+    huge->collapses = sys_mem->counters.thp_collapses;
+    huge->splits    = sys_mem->counters.thp_splits;
+
+    if (huge->timestamp > 0 && now > huge->timestamp)
+    {
+        double elapsed = (double)(now - huge->timestamp) / 1e9;
+
+        /* Counters go back after a restarted --shm daemon; show 0 then */
+        huge->collapse_rate =
+            huge->collapses >= collapses
+                ? (double)(huge->collapses - collapses) / elapsed
+                : 0.0;
+        huge->split_rate =
+            huge->splits >= splits ? (double)(huge->splits - splits) / elapsed
+                                   : 0.0;
+    }
+
+    huge->has_rates = huge->timestamp > 0;
+    huge->timestamp = now;
+    return 0;
+}
+
+void hugepages_cleanup(hugepages_t *huge)
+{
+    for (size_t i = 0; i < huge->count; i++)
+    {
+        for (int f = 0; f < HUGEPAGES_NFILES; f++)
+        {
+            close(huge->pools[i].fds[f]);
+        }
+    }
+    huge->count = 0;
+}
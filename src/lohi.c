@@ -0,0 +1,76 @@
+/*
+ * lohi.c - Session-wide low and high watermarks
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "lohi.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(mem_info_t) == LOHI_MEM_FIELDS * sizeof(uint64_t),
+               "mem_info_t must contain only uint64_t fields");
+_Static_assert(sizeof(swap_info_t) == LOHI_SWAP_FIELDS * sizeof(uint64_t),
+               "swap_info_t must contain only uint64_t fields");
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+/*
+ * Fold nfields values into the low/high structs. Ties keep the earlier
+ * time, so each time is when the watermark was first reached.
+ */
+static void track(const void *cur, void *low, void *high, uint64_t *low_at,
+                  uint64_t *high_at, size_t nfields, uint64_t now, int first)
+{
+    for (size_t i = 0; i < nfields; i++)
+    {
+        size_t   offset = i * sizeof(uint64_t);
+        uint64_t value;
+        uint64_t lo;
+        uint64_t hi;
+
+        memcpy(&value, (const char *)cur + offset, sizeof(value));
+        memcpy(&lo, (char *)low + offset, sizeof(lo));
+        memcpy(&hi, (char *)high + offset, sizeof(hi));
+
+        if (first || value < lo)
+        {
+            memcpy((char *)low + offset, &value, sizeof(value));
+            low_at[i] = now;
+        }
+        if (first || value > hi)
+        {
+            memcpy((char *)high + offset, &value, sizeof(value));
+            high_at[i] = now;
+        }
+    }
+}
+
+/*
+ * ============================================================================
+ * Watermark Functions
+ * ============================================================================
+ */
+
+void lohi_reset(lohi_t *lohi)
+{
+    memset(lohi, 0, sizeof(lohi_t));
+}
+
+void lohi_update(lohi_t *lohi, const system_memory_t *sys_mem)
+{
+    int first = lohi->samples == 0;
+
+    track(&sys_mem->mem, &lohi->mem_low, &lohi->mem_high, lohi->mem_low_at,
+          lohi->mem_high_at, LOHI_MEM_FIELDS, sys_mem->walltime, first);
+    track(&sys_mem->swap, &lohi->swap_low, &lohi->swap_high,
+          lohi->swap_low_at, lohi->swap_high_at, LOHI_SWAP_FIELDS,
+          sys_mem->walltime, first);
+
+    lohi->samples++;
+}
@@ -0,0 +1,74 @@
+/*
+ * lohi.h - Session-wide low and high watermarks
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef LOHI_H
+#define LOHI_H
+
+#include "memory.h"
+
+#include <stddef.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/* mem_info_t and swap_info_t are arrays of uint64_t in all but name */
+#define LOHI_MEM_FIELDS  (sizeof(mem_info_t) / sizeof(uint64_t))
+#define LOHI_SWAP_FIELDS (sizeof(swap_info_t) / sizeof(uint64_t))
+
+/* Index of a field in the *_at arrays, e.g. LOHI_INDEX(mem_info_t, used) */
+#define LOHI_INDEX(type, field) (offsetof(type, field) / sizeof(uint64_t))
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Watermarks
+ *
+ * The lowest and highest value seen for every memory and swap field,
+ * with the wall-clock time (ns since epoch) each was first reached.
+ */
+typedef struct
+{
+    mem_info_t  mem_low;                        /* Lowest values */
+    mem_info_t  mem_high;                       /* Highest values */
+    swap_info_t swap_low;                       /* Lowest swap values */
+    swap_info_t swap_high;                      /* Highest swap values */
+    uint64_t    mem_low_at[LOHI_MEM_FIELDS];    /* Time of each low */
+    uint64_t    mem_high_at[LOHI_MEM_FIELDS];   /* Time of each high */
+    uint64_t    swap_low_at[LOHI_SWAP_FIELDS];  /* Time of each swap low */
+    uint64_t    swap_high_at[LOHI_SWAP_FIELDS]; /* Time of each swap high */
+    uint64_t    samples;                        /* Samples seen */
+} lohi_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Forget all watermarks
+ *
+ * @param lohi      Watermarks to reset
+ */
+void lohi_reset(lohi_t *lohi);
+
+/**
+ * Update the watermarks with a sample
+ *
+ * @param lohi      Watermarks to update
+ * @param sys_mem   New sample
+ */
+void lohi_update(lohi_t *lohi, const system_memory_t *sys_mem);
+
+#endif /* LOHI_H */
@@ -5,10 +5,32 @@
  * License: MIT
  */
 
+#include "adaptive.h"
+#include "cgroup.h"
+#include "cgtree.h"
 #include "display.h"
+#include "compress.h"
+#include "format.h"
+#include "hugepages.h"
+#include "lohi.h"
+#include "maps.h"
 #include "memory.h"
+#include "numa.h"
+#include "pipeline.h"
+#include "procs.h"
+#include "record.h"
+#include "sampler.h"
+#include "server.h"
+#include "shm.h"
+#include "stats.h"
+#include "summary.h"
+#include "ticker.h"
+#include "trend.h"
 #include "utils.h"
+#include "watch.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <signal.h>
 #include <stdio.h>
@@ -16,6 +38,30 @@
 #include <string.h>
 #include <unistd.h>
 
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/*
+ * Bounds on one table frame: the rows every refresh can print, plus the
+ * most each view adds at its limit, each no wider than FRAME_ROW_MAX.
+ * A cgroup tree frame also names its root.
+ */
+#define FRAME_ROW_MAX    128
+#define FRAME_FIXED_ROWS 32
+#define FRAME_MAX_ROWS                                                         \
+    (FRAME_FIXED_ROWS + NUMA_MAX_NODES + HUGEPAGES_MAX_SIZES +                 \
+     COMPRESS_MAX_POOLS + PROCS_MAX_TOP + MAX_WATCH_PIDS)
+
+_Static_assert(FRAME_MAX_ROWS * FRAME_ROW_MAX <= FRAME_BUF_SIZE,
+               "FRAME_BUF_SIZE cannot hold every view at its limit");
+_Static_assert((FRAME_FIXED_ROWS + CGTREE_MAX_ROWS) * FRAME_ROW_MAX +
+                       CGROUP_PATH_MAX <=
+                   FRAME_BUF_SIZE,
+               "FRAME_BUF_SIZE cannot hold a full cgroup tree");
+
 /*
  * ============================================================================
  * Global Variables
@@ -24,6 +70,46 @@
 
 static volatile int g_running = 1;
 
+/* Output for one refresh, emitted with a single write() */
+static frame_t g_frame;
+
+/* Trend shown by --trend, fed by the thread that renders */
+static trend_t g_trend;
+
+/* Exhaustion forecast and alert hooks, fed by the thread that samples */
+static trend_t g_alert_trend;
+static alert_t g_alert;
+
+/* Sampler/writer hand-off for --async */
+static pipeline_t g_pipeline;
+
+/* Process table scanner for --top */
+static procs_t g_procs;
+
+/* Leak detection for --watch-pid */
+static watch_t g_watch;
+
+/* Nodes shown by --numa */
+static numa_t g_numa;
+
+/* Pools shown by --hugepages */
+static hugepages_t g_hugepages;
+
+/* Stores shown by --compression */
+static compress_t g_compress = {.stored_fd = -1, .pool_fd = -1};
+
+/* Watermarks for --lohi, over the whole session */
+static lohi_t g_lohi;
+
+/* Self-instrumentation for --stats */
+static stats_t g_stats;
+
+/* Percentiles for --summary, over the session or the current window */
+static summary_t g_summary;
+
+/* Pace of --adaptive sampling */
+static adaptive_t g_adaptive;
+
 /*
  * ============================================================================
  * Signal Handlers
@@ -53,8 +139,49 @@ static void setup_signals(void)
  * ============================================================================
  */
 
+/* Codes for options that only have a long form */
+enum
+{
+    OPT_RECORD = 256,
+    OPT_RECORD_CAPACITY,
+    OPT_REPLAY,
+    OPT_SPEED,
+    OPT_RATES,
+    OPT_FORMAT,
+    OPT_DAEMON,
+    OPT_SHM,
+    OPT_SHM_NAME,
+    OPT_SERVE,
+    OPT_TREND,
+    OPT_ALERT_CMD,
+    OPT_ALERT_FD,
+    OPT_ALERT_TTE,
+    OPT_ALERT_PRESSURE,
+    OPT_SUMMARY,
+    OPT_STATS,
+    OPT_ASYNC,
+    OPT_SINK,
+    OPT_TOP,
+    OPT_GROUP_BY,
+    OPT_WATCH_PID,
+    OPT_LEAK_RATE,
+    OPT_MAPS,
+    OPT_CGROUP,
+    OPT_CGROUP_TREE,
+    OPT_TREE_DEPTH,
+    OPT_TREE_MIN,
+    OPT_NUMA,
+    OPT_HUGEPAGES,
+    OPT_COMPRESSION,
+    OPT_ADAPTIVE,
+    OPT_ADAPT_DELTA,
+};
+
 static int parse_args(int argc, char *argv[], options_t *opts)
 {
+    char  *end;
+    double size;
+
     static struct option long_options[] = {
         {"bytes", no_argument, NULL, 'b'},
         {"kibi", no_argument, NULL, 'k'},
@@ -66,6 +193,39 @@ static int parse_args(int argc, char *argv[], options_t *opts)
         {"seconds", required_argument, NULL, 's'},
         {"count", required_argument, NULL, 'c'},
         {"lohi", no_argument, NULL, 'l'},
+        {"record", required_argument, NULL, OPT_RECORD},
+        {"record-capacity", required_argument, NULL, OPT_RECORD_CAPACITY},
+        {"replay", required_argument, NULL, OPT_REPLAY},
+        {"speed", required_argument, NULL, OPT_SPEED},
+        {"rates", no_argument, NULL, OPT_RATES},
+        {"format", required_argument, NULL, OPT_FORMAT},
+        {"daemon", no_argument, NULL, OPT_DAEMON},
+        {"shm", no_argument, NULL, OPT_SHM},
+        {"shm-name", required_argument, NULL, OPT_SHM_NAME},
+        {"serve", required_argument, NULL, OPT_SERVE},
+        {"trend", no_argument, NULL, OPT_TREND},
+        {"alert-cmd", required_argument, NULL, OPT_ALERT_CMD},
+        {"alert-fd", required_argument, NULL, OPT_ALERT_FD},
+        {"alert-tte", required_argument, NULL, OPT_ALERT_TTE},
+        {"alert-pressure", required_argument, NULL, OPT_ALERT_PRESSURE},
+        {"summary", optional_argument, NULL, OPT_SUMMARY},
+        {"stats", no_argument, NULL, OPT_STATS},
+        {"async", no_argument, NULL, OPT_ASYNC},
+        {"sink", required_argument, NULL, OPT_SINK},
+        {"top", required_argument, NULL, OPT_TOP},
+        {"group-by", required_argument, NULL, OPT_GROUP_BY},
+        {"watch-pid", required_argument, NULL, OPT_WATCH_PID},
+        {"leak-rate", required_argument, NULL, OPT_LEAK_RATE},
+        {"maps", required_argument, NULL, OPT_MAPS},
+        {"cgroup", optional_argument, NULL, OPT_CGROUP},
+        {"cgroup-tree", optional_argument, NULL, OPT_CGROUP_TREE},
+        {"tree-depth", required_argument, NULL, OPT_TREE_DEPTH},
+        {"tree-min", required_argument, NULL, OPT_TREE_MIN},
+        {"numa", no_argument, NULL, OPT_NUMA},
+        {"hugepages", no_argument, NULL, OPT_HUGEPAGES},
+        {"compression", no_argument, NULL, OPT_COMPRESSION},
+        {"adaptive", optional_argument, NULL, OPT_ADAPTIVE},
+        {"adapt-delta", required_argument, NULL, OPT_ADAPT_DELTA},
         {"help", no_argument, NULL, 'H'},
         {"version", no_argument, NULL, 'V'},
         {NULL, 0, NULL, 0}};
@@ -100,8 +260,7 @@ static int parse_args(int argc, char *argv[], options_t *opts)
                 opts->totals = 1;
                 break;
             case 's':
-                opts->seconds = atoi(optarg);
-                if (opts->seconds < 1)
+                if (parse_interval(optarg, &opts->interval) != 0)
                 {
                     fprintf(stderr, "Error: Invalid seconds value: %s\n",
                             optarg);
@@ -119,6 +278,238 @@ static int parse_args(int argc, char *argv[], options_t *opts)
             case 'l':
                 opts->lohi = 1;
                 break;
+            case OPT_RECORD:
+                opts->record = optarg;
+                break;
+            case OPT_RECORD_CAPACITY:
+                errno                 = 0;
+                opts->record_capacity = strtoull(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    opts->record_capacity == 0)
+                {
+                    fprintf(stderr, "Error: Invalid record capacity: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_REPLAY:
+                opts->replay = optarg;
+                break;
+            case OPT_SPEED:
+                errno              = 0;
+                opts->replay_speed = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    !(opts->replay_speed >= 0.0))
+                {
+                    fprintf(stderr, "Error: Invalid speed value: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_RATES:
+                opts->rates = 1;
+                break;
+            case OPT_FORMAT:
+                if (parse_format(optarg, &opts->format) != 0)
+                {
+                    fprintf(stderr, "Error: Unknown output format: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_DAEMON:
+                opts->daemon = 1;
+                break;
+            case OPT_SHM:
+                opts->shm = 1;
+                break;
+            case OPT_SHM_NAME:
+                if (optarg[0] != '/')
+                {
+                    fprintf(stderr,
+                            "Error: Shared memory name must start with '/': "
+                            "%s\n",
+                            optarg);
+                    return -1;
+                }
+                opts->shm_name = optarg;
+                break;
+            case OPT_SERVE:
+                opts->serve = optarg;
+                break;
+            case OPT_TREND:
+                opts->trend = 1;
+                break;
+            case OPT_ALERT_CMD:
+                opts->alert_cmd = optarg;
+                break;
+            case OPT_ALERT_FD:
+                errno          = 0;
+                opts->alert_fd = (int)strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    opts->alert_fd < 0 || fcntl(opts->alert_fd, F_GETFD) < 0)
+                {
+                    fprintf(stderr, "Error: Invalid alert descriptor: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_ALERT_TTE:
+                errno           = 0;
+                opts->alert_tte = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    !(opts->alert_tte > 0.0))
+                {
+                    fprintf(stderr, "Error: Invalid alert time: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_ALERT_PRESSURE:
+                errno                = 0;
+                opts->alert_pressure = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    !(opts->alert_pressure > 0.0 &&
+                      opts->alert_pressure <= 1.0))
+                {
+                    fprintf(stderr, "Error: Invalid alert pressure: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_SUMMARY:
+                opts->summary = 1;
+                if (optarg != NULL &&
+                    parse_interval(optarg, &opts->summary_interval) != 0)
+                {
+                    fprintf(stderr, "Error: Invalid summary interval: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_STATS:
+                opts->stats = 1;
+                break;
+            case OPT_ASYNC:
+                opts->async = 1;
+                break;
+            case OPT_SINK:
+                if (opts->sink_count >= MAX_SINKS)
+                {
+                    fprintf(stderr, "Error: At most %d sinks allowed\n",
+                            MAX_SINKS);
+                    return -1;
+                }
+                opts->sinks[opts->sink_count++] = optarg;
+                opts->async                     = 1;
+                break;
+            case OPT_TOP:
+                errno     = 0;
+                opts->top = (int)strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    opts->top < 1 || opts->top > PROCS_MAX_TOP)
+                {
+                    fprintf(stderr,
+                            "Error: Invalid top value: %s (1-%d)\n", optarg,
+                            PROCS_MAX_TOP);
+                    return -1;
+                }
+                break;
+            case OPT_GROUP_BY:
+                if (parse_group_by(optarg, &opts->group_by) != 0)
+                {
+                    fprintf(stderr, "Error: Unknown grouping: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_WATCH_PID:
+            {
+                int pids[MAX_WATCH_PIDS];
+                int count;
+
+                if (parse_pid_list(optarg, pids, &count) != 0)
+                {
+                    fprintf(stderr,
+                            "Error: Invalid PID list: %s (at most %d)\n",
+                            optarg, MAX_WATCH_PIDS);
+                    return -1;
+                }
+                opts->watch_pids = optarg;
+                break;
+            }
+            case OPT_LEAK_RATE:
+                if (parse_rate(optarg, &opts->leak_rate) != 0)
+                {
+                    fprintf(stderr, "Error: Invalid leak rate: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_MAPS:
+                errno          = 0;
+                opts->maps_pid = (int)strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    opts->maps_pid < 1)
+                {
+                    fprintf(stderr, "Error: Invalid PID: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_CGROUP:
+                opts->cgroup      = 1;
+                opts->cgroup_path = optarg;
+                break;
+            case OPT_CGROUP_TREE:
+                opts->cgroup_tree = 1;
+                opts->tree_root   = optarg;
+                break;
+            case OPT_TREE_DEPTH:
+                errno            = 0;
+                opts->tree_depth = (int)strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' ||
+                    opts->tree_depth < 0 ||
+                    opts->tree_depth > CGROUP_MAX_DEPTH)
+                {
+                    fprintf(stderr, "Error: --tree-depth must be between 0 "
+                                    "and %d\n",
+                            CGROUP_MAX_DEPTH);
+                    return -1;
+                }
+                break;
+            case OPT_TREE_MIN:
+                /* Same K/M/G syntax as --leak-rate */
+                if (parse_rate(optarg, &size) != 0)
+                {
+                    fprintf(stderr, "Error: Invalid size: %s\n", optarg);
+                    return -1;
+                }
+                opts->tree_min = (uint64_t)size;
+                break;
+            case OPT_NUMA:
+                opts->numa = 1;
+                break;
+            case OPT_HUGEPAGES:
+                opts->hugepages = 1;
+                break;
+            case OPT_COMPRESSION:
+                opts->compression = 1;
+                break;
+            case OPT_ADAPTIVE:
+                opts->adaptive = 1;
+                if (optarg != NULL &&
+                    parse_interval(optarg, &opts->adaptive_fast) != 0)
+                {
+                    fprintf(stderr, "Error: Invalid fast interval: %s\n",
+                            optarg);
+                    return -1;
+                }
+                break;
+            case OPT_ADAPT_DELTA:
+                if (parse_rate(optarg, &size) != 0 || size < 1.0)
+                {
+                    fprintf(stderr, "Error: Invalid size: %s\n", optarg);
+                    return -1;
+                }
+                opts->adaptive_delta = (uint64_t)size;
+                break;
             case 'H':
                 print_usage(argv[0]);
                 exit(EXIT_SUCCESS);
@@ -132,68 +523,1014 @@ static int parse_args(int argc, char *argv[], options_t *opts)
         }
     }
 
+    /* Forecasts need a series of samples */
+    if ((opts->alert_cmd != NULL || opts->alert_fd >= 0) &&
+        opts->interval == 0 && !opts->daemon)
+    {
+        fprintf(stderr, "Error: Alerts need -s or --daemon\n");
+        return -1;
+    }
+
+    /* Only the watch loop has output worth moving off its thread */
+    if (opts->async &&
+        (opts->replay != NULL || opts->daemon || opts->serve != NULL))
+    {
+        fprintf(stderr, "Error: --async and --sink cannot be combined with "
+                        "--replay, --daemon or --serve\n");
+        return -1;
+    }
+
+    /* The process table belongs to this machine, now, and to the table */
+    if ((opts->top > 0 || opts->watch_pids != NULL || opts->numa ||
+         opts->hugepages || opts->compression) &&
+        (opts->replay != NULL || opts->daemon || opts->serve != NULL ||
+         opts->format != FORMAT_TABLE))
+    {
+        fprintf(stderr, "Error: --top, --watch-pid, --numa, --hugepages and "
+                        "--compression need table output of live "
+                        "samples\n");
+        return -1;
+    }
+
+    /* --maps and --cgroup-tree replace the memory table with their own */
+    if ((opts->maps_pid > 0 || opts->cgroup_tree) &&
+        (opts->replay != NULL || opts->daemon || opts->serve != NULL ||
+         opts->async || opts->format != FORMAT_TABLE))
+    {
+        fprintf(stderr, "Error: --maps and --cgroup-tree only print their "
+                        "own table\n");
+        return -1;
+    }
+
+    /* Recorded and published samples were taken by someone else */
+    if (opts->cgroup && (opts->replay != NULL || opts->shm))
+    {
+        fprintf(stderr, "Error: --cgroup cannot be combined with --replay "
+                        "or --shm\n");
+        return -1;
+    }
+
+    /* Only loops that take their own samples can change pace */
+    if (opts->adaptive &&
+        ((opts->interval == 0 && !opts->daemon) || opts->replay != NULL ||
+         opts->shm || opts->serve != NULL))
+    {
+        fprintf(stderr, "Error: --adaptive needs -s or --daemon, and no "
+                        "--replay, --shm or --serve\n");
+        return -1;
+    }
+
+    if (opts->group_by != GROUP_NONE && opts->top == 0)
+    {
+        fprintf(stderr, "Error: --group-by needs --top\n");
+        return -1;
+    }
+
     return 0;
 }
 
+/*
+ * Optional data worth sampling: counters for --rates and the huge page
+ * and compression rates, kernel pressure wherever it is shown, recorded
+ * or fed to an alert
+ */
+static unsigned sample_flags(const options_t *opts)
+{
+    unsigned flags =
+        opts->rates || opts->hugepages || opts->compression ? SAMPLE_COUNTERS
+                                                             : 0;
+
+    if (opts->wide || opts->trend || opts->format != FORMAT_TABLE ||
+        opts->record != NULL || opts->alert_cmd != NULL || opts->alert_fd >= 0)
+    {
+        flags |= SAMPLE_PRESSURE;
+    }
+
+    return flags;
+}
+
 /*
  * ============================================================================
- * Main Function
+ * Scheduling
  * ============================================================================
  */
 
-int main(int argc, char *argv[])
+/*
+ * Sleep until the next tick, reporting any that were missed. With
+ * adaptive state the interval follows it, and a pressure trigger may end
+ * the sleep early.
+ */
+static void wait_for_tick(ticker_t *ticker, adaptive_t *adaptive)
 {
-    options_t       opts;
-    system_memory_t sys_mem;
-    int             iterations = 0;
+    int64_t missed;
 
-    /* Initialize options with defaults */
-    init_options(&opts);
+    while ((missed = adaptive != NULL ? adaptive_wait(adaptive, ticker)
+                                      : ticker_wait(ticker)) < 0 &&
+           g_running)
+    {
+        /* Interrupted by an unrelated signal; keep waiting */
+    }
 
-    /* Parse command line arguments */
-    if (parse_args(argc, argv, &opts) != 0)
+    if (missed > 0)
     {
-        return EXIT_FAILURE;
+        fprintf(stderr,
+                "Warning: missed %lld tick(s), sampling fell behind "
+                "the %.3fs interval\n",
+                (long long)missed, (double)ticker->interval / NSEC_PER_SEC);
     }
+}
 
-    /* Set up signal handlers for clean exit */
-    setup_signals();
+static void report_missed_ticks(const ticker_t *ticker)
+{
+    if (ticker->missed > 0)
+    {
+        fprintf(stderr, "Warning: %llu of %llu tick(s) missed in total\n",
+                (unsigned long long)ticker->missed,
+                (unsigned long long)(ticker->ticks + ticker->missed));
+    }
+}
 
-    /* Main display loop */
-    do
+/* Start --adaptive pacing; movement defaults to a share of total memory */
+static adaptive_t *start_adaptive(const options_t *opts,
+                                  const sampler_t *sampler)
+{
+    if (!opts->adaptive)
     {
-        /* Get current memory information */
-        if (get_system_memory(&sys_mem) != 0)
-        {
-            fprintf(stderr, "Error: Failed to retrieve memory information\n");
-            return EXIT_FAILURE;
-        }
+        return NULL;
+    }
 
-        /* Display memory information */
-        print_memory_info(&sys_mem, &opts);
+    uint64_t slow  = opts->interval > 0 ? opts->interval : NSEC_PER_SEC;
+    uint64_t delta = opts->adaptive_delta > 0
+                         ? opts->adaptive_delta
+                         : sampler->total / 100 * ADAPTIVE_DELTA_PERCENT;
 
-        iterations++;
+    adaptive_init(&g_adaptive, slow, opts->adaptive_fast, delta);
+    return &g_adaptive;
+}
 
-        /* Check if we should continue looping */
-        if (opts.seconds > 0 && g_running)
-        {
-            /* Check count limit */
-            if (opts.count > 0 && iterations >= opts.count)
+/*
+ * ============================================================================
+ * Instrumentation
+ * ============================================================================
+ */
+
+/* Start timing a stage; free when --stats is off */
+static uint64_t stage_begin(const options_t *opts)
+{
+    return opts->stats ? monotonic_ns() : 0;
+}
+
+static void stage_end(stage_t stage, uint64_t start, const options_t *opts)
+{
+    if (opts->stats)
+    {
+        stats_stage(&g_stats, stage, start);
+    }
+}
+
+/*
+ * ============================================================================
+ * Output
+ * ============================================================================
+ */
+
+/*
+ * Write g_frame out and reset it. With --async, standard output stands
+ * for the pipeline's sinks, which report their own errors; this then
+ * runs on the writer thread.
+ */
+static int output_frame(int fd, const options_t *opts)
+{
+    /* Sized for every view at its limit; a cut frame would be malformed */
+    if (g_frame.truncated)
+    {
+        fprintf(stderr, "Error: Output exceeds %d bytes; not written\n",
+                FRAME_BUF_SIZE);
+        frame_reset(&g_frame);
+        return -1;
+    }
+
+    int status = opts->async && fd == STDOUT_FILENO
+                     ? pipeline_write(&g_pipeline, &g_frame)
+                     : frame_write(&g_frame, fd);
+
+    if (status != 0 && !(opts->async && fd == STDOUT_FILENO))
+    {
+        perror("write");
+    }
+
+    frame_reset(&g_frame);
+    return status;
+}
+
+/*
+ * Render one refresh into g_frame and write it out. prev is the sample
+ * before cur (NULL for the first one) and is used for rate columns.
+ */
+static int emit_frame(const system_memory_t *cur, const system_memory_t *prev,
+                      const options_t *opts)
+{
+    uint64_t start = stage_begin(opts);
+
+    frame_reset(&g_frame);
+
+    if (opts->lohi)
+    {
+        lohi_update(&g_lohi, cur);
+    }
+
+    if (opts->trend)
+    {
+        trend_update(&g_trend, cur);
+    }
+
+    switch (opts->format)
+    {
+        case FORMAT_JSON:
+            render_json(&g_frame, cur, opts);
+            break;
+        case FORMAT_CSV:
+            if (prev == NULL)
             {
-                break;
+                render_csv_header(&g_frame, opts);
+            }
+            render_csv(&g_frame, cur, opts);
+            break;
+        case FORMAT_OPENMETRICS:
+            render_openmetrics(&g_frame, cur, opts);
+            break;
+        case FORMAT_TABLE:
+        default:
+            /* Blank line between consecutive tables */
+            if (prev != NULL)
+            {
+                frame_putc(&g_frame, '\n');
             }
 
-            /* Sleep and print separator before next iteration */
-            sleep(opts.seconds);
+            render_memory_info(&g_frame, cur, opts->lohi ? &g_lohi : NULL,
+                               opts);
 
-            if (g_running)
+            if (opts->numa)
             {
-                printf("\n");
+                if (numa_sample(&g_numa) != 0)
+                {
+                    fprintf(stderr, "Error: Failed to read NUMA nodes\n");
+                    return -1;
+                }
+                render_numa(&g_frame, &g_numa, opts);
             }
-        }
 
-    } while (opts.seconds > 0 && g_running &&
-             (opts.count == 0 || iterations < opts.count));
+            if (opts->hugepages)
+            {
+                if (hugepages_sample(&g_hugepages, cur) != 0)
+                {
+                    fprintf(stderr, "Error: Failed to read huge pages\n");
+                    return -1;
+                }
+                render_hugepages(&g_frame, &g_hugepages, opts);
+            }
 
-    return EXIT_SUCCESS;
+            if (opts->compression)
+            {
+                if (compress_sample(&g_compress, cur) != 0)
+                {
+                    fprintf(stderr,
+                            "Error: Failed to read compressed memory\n");
+                    return -1;
+                }
+                render_compress(&g_frame, &g_compress, opts);
+            }
+
+            if (opts->rates)
+            {
+                vm_rates_t rates;
+                int        have_rates =
+                    prev != NULL && compute_rates(prev, cur, &rates) == 0;
+                render_rates(&g_frame, have_rates ? &rates : NULL);
+            }
+
+            if (opts->trend)
+            {
+                render_trend(&g_frame, &g_trend, opts);
+            }
+
+            if (opts->top > 0)
+            {
+                if (procs_scan(&g_procs) != 0)
+                {
+                    fprintf(stderr, "Error: Failed to scan processes\n");
+                    return -1;
+                }
+                frame_putc(&g_frame, '\n');
+                render_top(&g_frame, &g_procs, opts);
+            }
+
+            if (opts->watch_pids != NULL)
+            {
+                watch_sample(&g_watch);
+                frame_putc(&g_frame, '\n');
+                render_watch(&g_frame, &g_watch, opts);
+            }
+            break;
+    }
+
+    stage_end(STAGE_RENDER, start, opts);
+    start = stage_begin(opts);
+
+    if (output_frame(STDOUT_FILENO, opts) != 0)
+    {
+        return -1;
+    }
+
+    stage_end(STAGE_WRITE, start, opts);
+    return 0;
+}
+
+/*
+ * Feed a live sample to the alert trend and fire any alert hooks whose
+ * thresholds it crossed. Runs where the sample is taken, so alerts keep
+ * their timing however far the output falls behind.
+ */
+static void update_alerts(const system_memory_t *sys_mem,
+                          const options_t *opts)
+{
+    if (opts->alert_cmd == NULL && opts->alert_fd < 0)
+    {
+        return;
+    }
+
+    trend_update(&g_alert_trend, sys_mem);
+    alert_check(&g_alert, &g_alert_trend, sys_mem);
+}
+
+/*
+ * Print the summary and start a new window. Table output gets it on
+ * stdout; machine-readable formats keep stdout parseable and get it on
+ * stderr instead.
+ */
+static int emit_summary(const options_t *opts)
+{
+    int fd = opts->format == FORMAT_TABLE ? STDOUT_FILENO : STDERR_FILENO;
+
+    if (summary_count(&g_summary) == 0)
+    {
+        return 0;
+    }
+
+    frame_reset(&g_frame);
+    frame_putc(&g_frame, '\n');
+    render_summary(&g_frame, &g_summary, opts);
+    summary_reset(&g_summary);
+
+    return output_frame(fd, opts);
+}
+
+/* Add a sample to the summary, printing it when a window is complete */
+static int update_summary(const system_memory_t *sys_mem,
+                          const options_t *opts)
+{
+    if (!opts->summary)
+    {
+        return 0;
+    }
+
+    summary_add(&g_summary, sys_mem);
+
+    if (opts->summary_interval > 0 &&
+        g_summary.last - g_summary.first >= opts->summary_interval)
+    {
+        return emit_summary(opts);
+    }
+
+    return 0;
+}
+
+/* Writer thread side of --async: everything after taking the sample */
+static int consume_sample(const system_memory_t *cur,
+                          const system_memory_t *prev, void *ctx)
+{
+    const options_t *opts = ctx;
+
+    if (emit_frame(cur, prev, opts) != 0 || update_summary(cur, opts) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Replay
+ * ============================================================================
+ */
+
+/*
+ * Feed recorded samples back through the renderer, spaced by their
+ * original timestamps divided by the replay speed (0 = no delay).
+ */
+static int run_replay(const options_t *opts)
+{
+    record_file_t rec;
+
+    if (record_open_read(&rec, opts->replay) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    uint64_t count = record_count(&rec);
+    if (opts->count > 0 && (uint64_t)opts->count < count)
+    {
+        count = (uint64_t)opts->count;
+    }
+
+    system_memory_t samples[2];
+    uint64_t        start   = monotonic_ns();
+    uint64_t        offset  = 0;
+    uint64_t        prev_ts = 0;
+
+    for (uint64_t i = 0; i < count && g_running; i++)
+    {
+        /* Alternate buffers so the previous sample stays for the rates */
+        system_memory_t *sys_mem = &samples[i % 2];
+        system_memory_t *prev    = i > 0 ? &samples[(i - 1) % 2] : NULL;
+
+        if (record_get(&rec, i, sys_mem) != 0)
+        {
+            fprintf(stderr,
+                    "Warning: %s: the recorder overwrote samples not yet "
+                    "replayed; stopping\n",
+                    opts->replay);
+            break;
+        }
+
+        if (opts->replay_speed > 0.0 && i > 0)
+        {
+            /* Timestamps go backwards across reboots; don't wait then */
+            if (sys_mem->timestamp > prev_ts)
+            {
+                offset += (uint64_t)((double)(sys_mem->timestamp - prev_ts) /
+                                     opts->replay_speed);
+            }
+
+            while (ticker_sleep_until(start + offset) != 0 &&
+                   errno == EINTR && g_running)
+            {
+                /* Interrupted by an unrelated signal; keep waiting */
+            }
+
+            if (!g_running)
+            {
+                break;
+            }
+        }
+        prev_ts = sys_mem->timestamp;
+
+        if (emit_frame(sys_mem, prev, opts) != 0 ||
+            update_summary(sys_mem, opts) != 0)
+        {
+            record_close(&rec);
+            return EXIT_FAILURE;
+        }
+    }
+
+    record_close(&rec);
+    return emit_summary(opts) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * ============================================================================
+ * Mappings
+ * ============================================================================
+ */
+
+/* Print one process's address space breakdown, repeated with -s */
+static int run_maps(const options_t *opts)
+{
+    maps_t   maps;
+    ticker_t ticker;
+    int      shown = 0;
+
+    ticker_init(&ticker, opts->interval);
+
+    for (;;)
+    {
+        if (maps_read((pid_t)opts->maps_pid, &maps) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+
+        frame_reset(&g_frame);
+        if (shown > 0)
+        {
+            frame_putc(&g_frame, '\n');
+        }
+        render_maps(&g_frame, &maps, opts);
+
+        if (output_frame(STDOUT_FILENO, opts) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+        shown++;
+
+        if (opts->interval == 0 || !g_running ||
+            (opts->count > 0 && shown >= opts->count))
+        {
+            break;
+        }
+
+        wait_for_tick(&ticker, NULL);
+        if (!g_running)
+        {
+            break;
+        }
+    }
+
+    report_missed_ticks(&ticker);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Print the cgroup hierarchy's memory, repeating every -s seconds. The
+ * tree is walked afresh each time, since cgroups come and go.
+ */
+static int run_cgroup_tree(const options_t *opts)
+{
+    cgtree_t tree;
+    ticker_t ticker;
+    int      shown  = 0;
+    int      status = EXIT_SUCCESS;
+
+    if (cgtree_init(&tree, opts->tree_root, (uint32_t)opts->tree_depth,
+                    opts->tree_min) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    ticker_init(&ticker, opts->interval);
+
+    for (;;)
+    {
+        if (cgtree_scan(&tree) != 0)
+        {
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        frame_reset(&g_frame);
+        if (shown > 0)
+        {
+            frame_putc(&g_frame, '\n');
+        }
+        render_cgtree(&g_frame, &tree, opts);
+
+        if (output_frame(STDOUT_FILENO, opts) != 0)
+        {
+            status = EXIT_FAILURE;
+            break;
+        }
+        shown++;
+
+        if (opts->interval == 0 || !g_running ||
+            (opts->count > 0 && shown >= opts->count))
+        {
+            break;
+        }
+
+        wait_for_tick(&ticker, NULL);
+        if (!g_running)
+        {
+            break;
+        }
+    }
+
+    cgtree_cleanup(&tree);
+    report_missed_ticks(&ticker);
+    return status;
+}
+
+/*
+ * ============================================================================
+ * Daemon
+ * ============================================================================
+ */
+
+/*
+ * Sample at the requested interval (1 second by default) and publish
+ * each sample to shared memory for --shm readers. Nothing is printed.
+ */
+static int run_daemon(const options_t *opts)
+{
+    sampler_t       sampler;
+    shm_handle_t    shm;
+    ticker_t        ticker;
+    system_memory_t sys_mem;
+    uint64_t        interval = opts->interval > 0 ? opts->interval
+                                                  : NSEC_PER_SEC;
+    int             published = 0;
+    int             status    = EXIT_SUCCESS;
+
+    /* Readers attach later and may want the pressure */
+    if (sampler_init(&sampler, (opts->rates ? SAMPLE_COUNTERS : 0) |
+                                   SAMPLE_PRESSURE) != 0)
+    {
+        fprintf(stderr, "Error: Failed to initialize memory sampling\n");
+        return EXIT_FAILURE;
+    }
+
+    if (shm_create(&shm, opts->shm_name, interval) != 0)
+    {
+        sampler_cleanup(&sampler);
+        return EXIT_FAILURE;
+    }
+
+    if (alert_open(&g_alert) != 0)
+    {
+        shm_close(&shm);
+        sampler_cleanup(&sampler);
+        return EXIT_FAILURE;
+    }
+
+    adaptive_t *adaptive = start_adaptive(opts, &sampler);
+
+    ticker_init(&ticker, interval);
+
+    while (g_running)
+    {
+        if (sampler_sample(&sampler, &sys_mem) != 0)
+        {
+            fprintf(stderr, "Error: Failed to retrieve memory information\n");
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        shm_publish(&shm, &sys_mem);
+        published++;
+
+        if (adaptive != NULL)
+        {
+            adaptive_update(adaptive, &sys_mem);
+        }
+
+        update_alerts(&sys_mem, opts);
+
+        if (opts->count > 0 && published >= opts->count)
+        {
+            break;
+        }
+
+        wait_for_tick(&ticker, adaptive);
+    }
+
+    if (adaptive != NULL)
+    {
+        adaptive_cleanup(adaptive);
+    }
+    alert_cleanup(&g_alert);
+    shm_close(&shm);
+    sampler_cleanup(&sampler);
+    report_missed_ticks(&ticker);
+
+    return status;
+}
+
+/*
+ * ============================================================================
+ * Main Function
+ * ============================================================================
+ */
+
+/* Release whichever sample source main() opened */
+static void close_source(const options_t *opts, sampler_t *sampler,
+                         shm_handle_t *shm)
+{
+    if (opts->shm)
+    {
+        shm_close(shm);
+    }
+    else
+    {
+        sampler_cleanup(sampler);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options_t       opts;
+    sampler_t       sampler;
+    ticker_t        ticker;
+    record_file_t   recording;
+    shm_handle_t    shm;
+    system_memory_t sys_mem;
+    system_memory_t prev_mem;
+    adaptive_t     *adaptive   = NULL;
+    int             iterations = 0;
+    int             status     = EXIT_SUCCESS;
+
+    /* Initialize options with defaults */
+    init_options(&opts);
+
+    /* Parse command line arguments */
+    if (parse_args(argc, argv, &opts) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* Set up signal handlers for clean exit */
+    setup_signals();
+
+    trend_init(&g_trend);
+    trend_init(&g_alert_trend);
+    alert_init(&g_alert, &opts);
+    summary_reset(&g_summary);
+
+    /* Replay renders a recording instead of sampling this machine */
+    if (opts.replay != NULL)
+    {
+        return run_replay(&opts);
+    }
+
+    /* A container's limits and usage instead of the host's */
+    if (opts.cgroup && cgroup_select(opts.cgroup_path) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* Daemon publishes samples instead of printing them */
+    if (opts.daemon)
+    {
+        return run_daemon(&opts);
+    }
+
+    /* Server answers socket requests instead of printing */
+    if (opts.serve != NULL)
+    {
+        return server_run(&opts, &g_running);
+    }
+
+    /* One process's mappings instead of the system's memory */
+    if (opts.maps_pid > 0)
+    {
+        return run_maps(&opts);
+    }
+
+    /* Every cgroup's memory instead of the system's */
+    if (opts.cgroup_tree)
+    {
+        return run_cgroup_tree(&opts);
+    }
+
+    /* Samples come from a running daemon, or from this machine */
+    if (opts.shm)
+    {
+        if (shm_attach(&shm, opts.shm_name) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    else if (sampler_init(&sampler, sample_flags(&opts)) != 0)
+    {
+        /* Static system facts are resolved once, before the loop */
+        fprintf(stderr, "Error: Failed to initialize memory sampling\n");
+        return EXIT_FAILURE;
+    }
+
+    if (opts.top > 0 &&
+        procs_init(&g_procs, (size_t)opts.top, opts.group_by) != 0)
+    {
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.watch_pids != NULL && watch_init(&g_watch, &opts) != 0)
+    {
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.numa && numa_init(&g_numa) != 0)
+    {
+        watch_cleanup(&g_watch);
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.hugepages && hugepages_init(&g_hugepages) != 0)
+    {
+        numa_cleanup(&g_numa);
+        watch_cleanup(&g_watch);
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.compression && compress_init(&g_compress) != 0)
+    {
+        hugepages_cleanup(&g_hugepages);
+        numa_cleanup(&g_numa);
+        watch_cleanup(&g_watch);
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.record != NULL &&
+        record_open(&recording, opts.record, opts.record_capacity) != 0)
+    {
+        compress_cleanup(&g_compress);
+        hugepages_cleanup(&g_hugepages);
+        numa_cleanup(&g_numa);
+        watch_cleanup(&g_watch);
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    if (alert_open(&g_alert) != 0)
+    {
+        if (opts.record != NULL)
+        {
+            record_close(&recording);
+        }
+        compress_cleanup(&g_compress);
+        hugepages_cleanup(&g_hugepages);
+        numa_cleanup(&g_numa);
+        watch_cleanup(&g_watch);
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    /* Rendering and writing move to their own thread */
+    if (opts.async &&
+        pipeline_start(&g_pipeline, &opts, consume_sample, &opts) != 0)
+    {
+        alert_cleanup(&g_alert);
+        if (opts.record != NULL)
+        {
+            record_close(&recording);
+        }
+        compress_cleanup(&g_compress);
+        hugepages_cleanup(&g_hugepages);
+        numa_cleanup(&g_numa);
+        watch_cleanup(&g_watch);
+        procs_cleanup(&g_procs);
+        close_source(&opts, &sampler, &shm);
+        return EXIT_FAILURE;
+    }
+
+    /* Deadlines are fixed from here on, independent of loop cost */
+    ticker_init(&ticker, opts.interval);
+    adaptive = start_adaptive(&opts, &sampler);
+
+    if (opts.stats)
+    {
+        stats_start(&g_stats);
+    }
+
+    /* Main display loop */
+    do
+    {
+        /* Get current memory information */
+        uint64_t stage = stage_begin(&opts);
+        if (opts.shm ? shm_read(&shm, &sys_mem) != 0
+                     : sampler_sample(&sampler, &sys_mem) != 0)
+        {
+            fprintf(stderr, "Error: Failed to retrieve memory information\n");
+            status = EXIT_FAILURE;
+            break;
+        }
+        stage_end(STAGE_SAMPLE, stage, &opts);
+
+        if (opts.stats)
+        {
+            stats_sample(&g_stats, sys_mem.timestamp);
+        }
+
+        /* A publisher that stopped leaves its last sample behind */
+        if (opts.shm && monotonic_ns() - sys_mem.timestamp >
+                            3 * shm.segment->interval + NSEC_PER_SEC)
+        {
+            fprintf(stderr, "Warning: Published sample is %.1fs old\n",
+                    (double)(monotonic_ns() - sys_mem.timestamp) /
+                        NSEC_PER_SEC);
+        }
+
+        if (opts.record != NULL)
+        {
+            record_append(&recording, &sys_mem);
+        }
+
+        if (adaptive != NULL)
+        {
+            adaptive_update(adaptive, &sys_mem);
+        }
+
+        update_alerts(&sys_mem, &opts);
+
+        if (opts.async)
+        {
+            /* A full ring drops the sample; the writer reports it */
+            pipeline_push(&g_pipeline, &sys_mem);
+
+            if (pipeline_failed(&g_pipeline))
+            {
+                status = EXIT_FAILURE;
+                break;
+            }
+        }
+        /* Render and write the whole frame */
+        else if (emit_frame(&sys_mem, iterations > 0 ? &prev_mem : NULL,
+                            &opts) != 0 ||
+                 update_summary(&sys_mem, &opts) != 0)
+        {
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        prev_mem = sys_mem;
+        iterations++;
+
+        /* Check if we should continue looping */
+        if (opts.interval > 0 && g_running)
+        {
+            /* Check count limit */
+            if (opts.count > 0 && iterations >= opts.count)
+            {
+                break;
+            }
+
+            /* Sleep until the next deadline */
+            stage = stage_begin(&opts);
+            wait_for_tick(&ticker, adaptive);
+            stage_end(STAGE_SLEEP, stage, &opts);
+
+            if (opts.stats)
+            {
+                stats_wake(&g_stats, &ticker);
+            }
+        }
+
+    } while (opts.interval > 0 && g_running &&
+             (opts.count == 0 || iterations < opts.count));
+
+    if (opts.record != NULL)
+    {
+        record_close(&recording);
+    }
+    close_source(&opts, &sampler, &shm);
+
+    /* Let the writer catch up before anything else touches the output */
+    if (opts.async)
+    {
+        pipeline_stop(&g_pipeline);
+        if (pipeline_failed(&g_pipeline))
+        {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Whatever the last window collected, including after Ctrl-C */
+    if (emit_summary(&opts) != 0)
+    {
+        status = EXIT_FAILURE;
+    }
+
+    if (opts.async)
+    {
+        pipeline_close(&g_pipeline);
+    }
+    procs_cleanup(&g_procs);
+    watch_cleanup(&g_watch);
+    numa_cleanup(&g_numa);
+    hugepages_cleanup(&g_hugepages);
+    compress_cleanup(&g_compress);
+    alert_cleanup(&g_alert);
+
+    report_missed_ticks(&ticker);
+
+    if (opts.stats)
+    {
+        /* Drift against one fixed interval means nothing when it varies */
+        stats_report(&g_stats, adaptive == NULL ? &ticker : NULL, stderr);
+        if (adaptive != NULL)
+        {
+            fprintf(stderr, "Adaptive: %.3fs/%.3fs, %llu switch(es), "
+                            "%llu pressure trigger(s)%s\n",
+                    (double)adaptive->slow / NSEC_PER_SEC,
+                    (double)adaptive->fast / NSEC_PER_SEC,
+                    (unsigned long long)adaptive->switches,
+                    (unsigned long long)adaptive->triggers,
+                    adaptive->trigger_fd < 0 ? " (none registered)" : "");
+        }
+    }
+
+    if (adaptive != NULL)
+    {
+        adaptive_cleanup(adaptive);
+    }
+
+    return status;
 }
@@ -0,0 +1,93 @@
+/*
+ * maps.h - Address space breakdown of a single process
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef MAPS_H
+#define MAPS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/* Read size for streaming smaps; no line comes close to this */
+#define MAPS_BUF_SIZE 65536
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* What a mapping is used for */
+typedef enum
+{
+    MAPS_HEAP,   /* [heap], the brk() area */
+    MAPS_STACK,  /* [stack] */
+    MAPS_ANON,   /* Private anonymous memory (malloc arenas, JIT, ...) */
+    MAPS_FILE,   /* Private file mappings (binaries, libraries, data) */
+    MAPS_SHARED, /* Shared mappings, file-backed or not (shm, memfd) */
+    MAPS_HUGE,   /* hugetlbfs pages */
+    MAPS_OTHER,  /* [vdso], [vvar] and other kernel-provided areas */
+    MAPS_CATEGORY_COUNT
+} maps_category_t;
+
+/* Totals for one category */
+typedef struct
+{
+    uint64_t mappings; /* Number of mappings */
+    uint64_t size;     /* Virtual size, bytes */
+    uint64_t rss;      /* Resident, bytes */
+    uint64_t pss;      /* Proportional set size, bytes */
+    uint64_t swap;     /* Swapped out, bytes */
+    uint64_t dirty;    /* Shared and private dirty, bytes */
+} maps_usage_t;
+
+/* Breakdown of one process */
+typedef struct
+{
+    int          pid;                             /* Process ID */
+    char         name[32];                        /* Command name */
+    maps_usage_t categories[MAPS_CATEGORY_COUNT]; /* Per category */
+    maps_usage_t total;                           /* All mappings */
+    uint64_t     lines;                           /* smaps lines parsed */
+} maps_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Break a process's address space down by category
+ *
+ * Linux only; elsewhere this reports that it is unsupported.
+ *
+ * @param pid       Process to inspect
+ * @param maps      Filled in on success
+ * @return          0 on success, -1 on error (reported on stderr)
+ */
+int maps_read(pid_t pid, maps_t *maps);
+
+/**
+ * Parse smaps content from a descriptor
+ *
+ * Streams through a fixed buffer: nothing is allocated and each line is
+ * looked at once, so even hundreds of thousands of lines take
+ * milliseconds. Linux only.
+ *
+ * @param fd        Descriptor positioned at the start of smaps
+ * @param maps      Totals to add to (zero it first)
+ * @return          0 on success, -1 on a read error
+ */
+int maps_parse(int fd, maps_t *maps);
+
+#endif /* MAPS_H */
@@ -0,0 +1,39 @@
+/*
+ * maps_darwin.c - Address space breakdown, unavailable on macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "maps.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+/*
+ * macOS has no smaps; walking another task's regions needs its task port,
+ * which is restricted to root with SIP exceptions. Use vmmap(1) there.
+ */
+int maps_parse(int fd, maps_t *maps)
+{
+    (void)fd;
+    (void)maps;
+    return -1;
+}
+
+int maps_read(pid_t pid, maps_t *maps)
+{
+    memset(maps, 0, sizeof(maps_t));
+    maps->pid = (int)pid;
+
+    fprintf(stderr, "Error: --maps is only supported on Linux; "
+                    "use vmmap %d instead\n",
+            (int)pid);
+    return -1;
+}
@@ -0,0 +1,302 @@
+/*
+ * maps_linux.c - Streaming /proc/PID/smaps parser for Linux
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "maps.h"
+
+#include "procfs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Mapping State
+ * ============================================================================
+ */
+
+/* The mapping whose field lines are being read */
+typedef struct
+{
+    int             active;    /* A header has been seen */
+    maps_category_t category;  /* From the header */
+    maps_usage_t    usage;     /* From the field lines */
+    uint64_t        page_size; /* KernelPageSize, bytes */
+    uint64_t        hugetlb;   /* Shared_ and Private_Hugetlb, bytes */
+} mapping_t;
+
+/* Add the finished mapping to its category and the total */
+static void commit(maps_t *maps, const mapping_t *m, uint64_t base_page)
+{
+    maps_category_t category = m->category;
+    maps_usage_t    usage    = m->usage;
+
+    if (!m->active)
+    {
+        return;
+    }
+
+    /* hugetlbfs pages are not counted in Rss */
+    if (m->hugetlb > 0 || m->page_size > base_page)
+    {
+        category = MAPS_HUGE;
+        usage.rss += m->hugetlb;
+    }
+
+    maps_usage_t *targets[] = {&maps->categories[category], &maps->total};
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++)
+    {
+        targets[i]->mappings++;
+        targets[i]->size += usage.size;
+        targets[i]->rss += usage.rss;
+        targets[i]->pss += usage.pss;
+        targets[i]->swap += usage.swap;
+        targets[i]->dirty += usage.dirty;
+    }
+}
+
+/* Skip one space-separated token and the spaces after it */
+static const char *skip_token(const char *p, const char *end)
+{
+    while (p < end && *p != ' ')
+    {
+        p++;
+    }
+    while (p < end && *p == ' ')
+    {
+        p++;
+    }
+    return p;
+}
+
+/*
+ * Start a new mapping from a header line:
+ * "start-end perms offset dev inode [path]"
+ */
+static void parse_header(mapping_t *m, const char *p, const char *end)
+{
+    memset(m, 0, sizeof(mapping_t));
+    m->active = 1;
+
+    p = skip_token(p, end); /* Address range */
+
+    int shared = end - p >= 4 && p[3] == 's';
+
+    p = skip_token(p, end); /* Permissions */
+    p = skip_token(p, end); /* Offset */
+    p = skip_token(p, end); /* Device */
+    p = skip_token(p, end); /* Inode */
+
+    size_t len = (size_t)(end - p);
+
+    if (len == 6 && memcmp(p, "[heap]", 6) == 0)
+    {
+        m->category = MAPS_HEAP;
+    }
+    else if (len >= 6 && memcmp(p, "[stack", 6) == 0)
+    {
+        m->category = MAPS_STACK;
+    }
+    else if (shared)
+    {
+        m->category = MAPS_SHARED;
+    }
+    else if (len > 0 && p[0] == '/')
+    {
+        m->category = MAPS_FILE;
+    }
+    else if (len == 0 || (len >= 5 && memcmp(p, "[anon", 5) == 0))
+    {
+        m->category = MAPS_ANON;
+    }
+    else
+    {
+        m->category = MAPS_OTHER;
+    }
+}
+
+#define KEY_IS(k, len, name)                                                   \
+    ((len) == sizeof(name) - 1 && memcmp((k), (name), sizeof(name) - 1) == 0)
+
+/* Add a "Key:   N kB" line to the current mapping */
+static void parse_field(mapping_t *m, const char *p, const char *end)
+{
+    const char *colon = memchr(p, ':', (size_t)(end - p));
+    uint64_t    value;
+
+    if (colon == NULL || !m->active)
+    {
+        return;
+    }
+
+    size_t len = (size_t)(colon - p);
+
+    /* Most lines are keys we skip; test the cheap byte first */
+    switch (p[0])
+    {
+        case 'S':
+        case 'R':
+        case 'P':
+        case 'K':
+            break;
+        default:
+            return;
+    }
+
+    procfs_parse_uint(colon + 1, end, &value);
+    value *= 1024; /* Everything we read is in kB */
+
+    if (KEY_IS(p, len, "Rss"))
+    {
+        m->usage.rss = value;
+    }
+    else if (KEY_IS(p, len, "Pss"))
+    {
+        m->usage.pss = value;
+    }
+    else if (KEY_IS(p, len, "Size"))
+    {
+        m->usage.size = value;
+    }
+    else if (KEY_IS(p, len, "Swap"))
+    {
+        m->usage.swap = value;
+    }
+    else if (KEY_IS(p, len, "Shared_Dirty") || KEY_IS(p, len, "Private_Dirty"))
+    {
+        m->usage.dirty += value;
+    }
+    else if (KEY_IS(p, len, "Shared_Hugetlb") ||
+             KEY_IS(p, len, "Private_Hugetlb"))
+    {
+        m->hugetlb += value;
+    }
+    else if (KEY_IS(p, len, "KernelPageSize"))
+    {
+        m->page_size = value;
+    }
+}
+
+/*
+ * Header lines start with the lowercase hex start address; field lines
+ * with a capitalized key.
+ */
+static void parse_line(maps_t *maps, mapping_t *m, uint64_t base_page,
+                       const char *p, const char *end)
+{
+    if (p == end)
+    {
+        return;
+    }
+
+    maps->lines++;
+
+    if ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f'))
+    {
+        commit(maps, m, base_page);
+        parse_header(m, p, end);
+    }
+    else
+    {
+        parse_field(m, p, end);
+    }
+}
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+int maps_parse(int fd, maps_t *maps)
+{
+    char      buf[MAPS_BUF_SIZE];
+    size_t    have      = 0;
+    mapping_t mapping   = {0};
+    uint64_t  base_page = (uint64_t)sysconf(_SC_PAGESIZE);
+
+    for (;;)
+    {
+        ssize_t n = read(fd, buf + have, sizeof(buf) - have);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        have += (size_t)n;
+
+        /* Parse every complete line; keep the partial one for later */
+        const char *p   = buf;
+        const char *end = buf + have;
+        const char *nl;
+
+        while ((nl = memchr(p, '\n', (size_t)(end - p))) != NULL)
+        {
+            parse_line(maps, &mapping, base_page, p, nl);
+            p = nl + 1;
+        }
+
+        have = (size_t)(end - p);
+        if (have == sizeof(buf))
+        {
+            /* Longer than any real line; drop it rather than stall */
+            have = 0;
+        }
+        memmove(buf, p, have);
+    }
+
+    parse_line(maps, &mapping, base_page, buf, buf + have);
+    commit(maps, &mapping, base_page);
+
+    return 0;
+}
+
+int maps_read(pid_t pid, maps_t *maps)
+{
+    char path[48];
+
+    memset(maps, 0, sizeof(maps_t));
+    maps->pid = (int)pid;
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        ssize_t len = read(fd, maps->name, sizeof(maps->name) - 1);
+        if (len > 0)
+        {
+            maps->name[strcspn(maps->name, "\n")] = '\0';
+        }
+        close(fd);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/smaps", (int)pid);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int status = maps_parse(fd, maps);
+    if (status != 0)
+    {
+        fprintf(stderr, "Error: Cannot read %s: %s\n", path, strerror(errno));
+    }
+
+    close(fd);
+    return status;
+}
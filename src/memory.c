@@ -7,60 +7,94 @@
 
 #include "memory.h"
 
-#include <mach/mach_host.h>
+#include "utils.h"
+
 #include <stdio.h>
 #include <string.h>
-#include <sys/sysctl.h>
 
 /*
  * ============================================================================
- * System Information Functions
+ * Backend Selection
  * ============================================================================
  */
 
-vm_size_t get_page_size(void)
+#if defined(__APPLE__)
+    #define DEFAULT_BACKEND (&memory_backend_darwin)
+#elif defined(__linux__)
+    #define DEFAULT_BACKEND (&memory_backend_linux)
+#else
+    #error "Unsupported platform: no memory backend available"
+#endif
+
+static const memory_backend_t *g_backend     = DEFAULT_BACKEND;
+static int                     g_initialized = 0;
+
+const memory_backend_t *memory_get_backend(void)
 {
-    vm_size_t page_size;
-    host_page_size(mach_host_self(), &page_size);
-    return page_size;
+    return g_backend;
 }
 
-uint64_t get_total_memory(void)
+void memory_set_backend(const memory_backend_t *backend)
 {
-    int      mib[2]       = {CTL_HW, HW_MEMSIZE};
-    uint64_t total_memory = 0;
-    size_t   length       = sizeof(total_memory);
+    memory_cleanup();
+    g_backend = backend != NULL ? backend : DEFAULT_BACKEND;
+}
 
-    if (sysctl(mib, 2, &total_memory, &length, NULL, 0) != 0)
+int memory_init(void)
+{
+    if (g_initialized)
     {
-        perror("sysctl HW_MEMSIZE");
         return 0;
     }
 
-    return total_memory;
+    if (g_backend->init != NULL && g_backend->init() != 0)
+    {
+        return -1;
+    }
+
+    g_initialized = 1;
+    return 0;
 }
 
-int get_vm_stats(vm_statistics64_data_t *vm_stats)
+void memory_cleanup(void)
 {
-    if (vm_stats == NULL)
+    if (!g_initialized)
     {
-        return -1;
+        return;
     }
 
-    mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
-    kern_return_t          kr;
+    if (g_backend->cleanup != NULL)
+    {
+        g_backend->cleanup();
+    }
+
+    g_initialized = 0;
+}
+
+/*
+ * ============================================================================
+ * System Information Functions
+ * ============================================================================
+ */
 
-    kr = host_statistics64(mach_host_self(), HOST_VM_INFO64,
-                           (host_info64_t)vm_stats, &count);
+size_t get_page_size(void)
+{
+    if (memory_init() != 0)
+    {
+        return 0;
+    }
+
+    return g_backend->page_size();
+}
 
-    if (kr != KERN_SUCCESS)
+uint64_t get_total_memory(void)
+{
+    if (memory_init() != 0)
     {
-        fprintf(stderr, "host_statistics64 failed: %s\n",
-                mach_error_string(kr));
-        return -1;
+        return 0;
     }
 
-    return 0;
+    return g_backend->total_memory();
 }
 
 /*
@@ -71,85 +105,61 @@ int get_vm_stats(vm_statistics64_data_t *vm_stats)
 
 int get_memory_info(mem_info_t *mem)
 {
-    if (mem == NULL)
+    if (mem == NULL || memory_init() != 0)
     {
         return -1;
     }
 
     memset(mem, 0, sizeof(mem_info_t));
 
-    /* Get total physical memory */
-    mem->total = get_total_memory();
-    if (mem->total == 0)
-    {
-        return -1;
-    }
+    return g_backend->memory_info(mem);
+}
 
-    /* Get VM statistics */
-    vm_statistics64_data_t vm_stats;
-    if (get_vm_stats(&vm_stats) != 0)
+int get_swap_info(swap_info_t *swap)
+{
+    if (swap == NULL || memory_init() != 0)
     {
         return -1;
     }
 
-    vm_size_t page_size = get_page_size();
+    memset(swap, 0, sizeof(swap_info_t));
 
-    /* Calculate memory values in bytes */
-    mem->free       = (uint64_t)vm_stats.free_count * page_size;
-    mem->active     = (uint64_t)vm_stats.active_count * page_size;
-    mem->inactive   = (uint64_t)vm_stats.inactive_count * page_size;
-    mem->wired      = (uint64_t)vm_stats.wire_count * page_size;
-    mem->compressed = (uint64_t)vm_stats.compressor_page_count * page_size;
+    return g_backend->swap_info(swap);
+}
 
-    /* Purgeable memory (cached) */
-    mem->cached = (uint64_t)vm_stats.purgeable_count * page_size;
+int get_vm_counters(vm_counters_t *counters)
+{
+    if (counters == NULL || memory_init() != 0)
+    {
+        return -1;
+    }
 
-    /*
-     * Calculate used memory
-     * Used = Active + Wired + Compressed
-     * (Inactive and cached are considered "available")
-     */
-    mem->used = mem->active + mem->wired + mem->compressed;
+    memset(counters, 0, sizeof(vm_counters_t));
 
-    /*
-     * Calculate available memory
-     * Available = Free + Inactive + Cached
-     * This represents memory that can be reclaimed if needed
-     */
-    mem->available = mem->free + mem->inactive + mem->cached;
-
-    /*
-     * App memory is roughly the active memory minus cached files
-     * This is an approximation since macOS doesn't expose this directly
-     */
-    mem->app_memory = mem->active;
+    if (g_backend->vm_counters == NULL)
+    {
+        return -1;
+    }
 
-    return 0;
+    return g_backend->vm_counters(counters);
 }
 
-int get_swap_info(swap_info_t *swap)
+int get_pressure_info(pressure_info_t *pressure)
 {
-    if (swap == NULL)
+    if (pressure == NULL || memory_init() != 0)
     {
         return -1;
     }
 
-    memset(swap, 0, sizeof(swap_info_t));
-
-    struct xsw_usage swap_usage;
-    size_t           length = sizeof(swap_usage);
-    int              mib[2] = {CTL_VM, VM_SWAPUSAGE};
+    memset(pressure, 0, sizeof(pressure_info_t));
 
-    if (sysctl(mib, 2, &swap_usage, &length, NULL, 0) != 0)
+    if (g_backend->pressure_info == NULL ||
+        g_backend->pressure_info(pressure) != 0)
     {
-        perror("sysctl VM_SWAPUSAGE");
         return -1;
     }
 
-    swap->total = swap_usage.xsu_total;
-    swap->used  = swap_usage.xsu_used;
-    swap->free  = swap_usage.xsu_avail;
-
+    pressure->valid = 1;
     return 0;
 }
 
@@ -162,6 +172,8 @@ int get_system_memory(system_memory_t *sys_mem)
 
     memset(sys_mem, 0, sizeof(system_memory_t));
 
+    sys_mem->timestamp = monotonic_ns();
+    sys_mem->walltime  = realtime_ns();
     sys_mem->page_size = get_page_size();
 
     if (get_memory_info(&sys_mem->mem) != 0)
@@ -178,15 +190,34 @@ int get_system_memory(system_memory_t *sys_mem)
     return 0;
 }
 
-double calculate_memory_pressure(const mem_info_t *mem)
+double calculate_memory_pressure(const system_memory_t *sys_mem)
 {
-    if (mem == NULL || mem->total == 0)
+    const pressure_info_t *kernel = &sys_mem->pressure;
+    const mem_info_t      *mem    = &sys_mem->mem;
+
+    /* What the kernel measured beats any estimate from the counters */
+    if (kernel->valid)
+    {
+        switch (kernel->level)
+        {
+            case 0:
+                return kernel->some_avg10 / 100.0;
+            case PRESSURE_LEVEL_NORMAL:
+                return 0.0;
+            case PRESSURE_LEVEL_WARN:
+                return 0.5;
+            default:
+                return 1.0;
+        }
+    }
+
+    if (mem->total == 0)
     {
         return 0.0;
     }
 
     /*
-     * Memory pressure calculation:
+     * Fallback when the kernel reports nothing:
      * Based on how much memory is under pressure (used vs available)
      */
     double used_ratio       = (double)mem->used / (double)mem->total;
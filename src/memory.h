@@ -1,5 +1,5 @@
 /*
- * memory.h - Memory information retrieval for macOS
+ * memory.h - Memory information retrieval
  *
  * Part of mac-free: A 'free' command replacement for macOS
  * License: MIT
@@ -8,9 +8,13 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
-#include <mach/mach.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#ifdef __APPLE__
+    #include <mach/mach.h>
+#endif
+
 /*
  * ============================================================================
  * Type Definitions
@@ -20,16 +24,23 @@
 /* Physical memory information */
 typedef struct
 {
-    uint64_t total;      /* Total physical memory */
-    uint64_t used;       /* Used memory (active + wired + compressed) */
-    uint64_t free;       /* Free memory */
-    uint64_t active;     /* Active pages */
-    uint64_t inactive;   /* Inactive pages */
-    uint64_t wired;      /* Wired (non-pageable) pages */
-    uint64_t compressed; /* Compressed pages */
-    uint64_t cached;     /* Cached/purgeable pages */
-    uint64_t app_memory; /* Memory used by applications */
-    uint64_t available;  /* Available memory (free + inactive + cached) */
+    uint64_t total;           /* Total physical memory */
+    uint64_t used;            /* Used memory (active + wired + compressed) */
+    uint64_t free;            /* Free memory */
+    uint64_t active;          /* Active pages */
+    uint64_t inactive;        /* Inactive pages */
+    uint64_t wired;           /* Wired (non-pageable) pages */
+    uint64_t compressed;      /* Compressed pages */
+    uint64_t cached;          /* Cached/purgeable pages */
+    uint64_t app_memory;      /* Memory used by applications */
+    uint64_t available;       /* Available memory (free + inactive + cached) */
+    uint64_t shared;          /* Value shown in the "shared" column */
+    uint64_t buff_cache;      /* Value shown in the "buff/cache" column */
+    uint64_t hugetlb;         /* hugetlb pool, mapped or not; not in used */
+    uint64_t compressed_orig; /* What compressed holds, before compression */
+    uint64_t thp_anon;        /* Anonymous memory in transparent huge pages */
+    uint64_t thp_shmem;       /* Shared memory in transparent huge pages */
+    uint64_t thp_file;        /* Page cache in transparent huge pages */
 } mem_info_t;
 
 /* Swap/virtual memory information */
@@ -40,26 +51,128 @@ typedef struct
     uint64_t free;  /* Free swap space */
 } swap_info_t;
 
+/* Cumulative paging and compression events since boot */
+typedef struct
+{
+    uint64_t pageins;        /* Pages read in from backing store */
+    uint64_t pageouts;       /* Pages written out to backing store */
+    uint64_t swapins;        /* Pages read in from swap */
+    uint64_t swapouts;       /* Pages written out to swap */
+    uint64_t compressions;   /* Pages compressed */
+    uint64_t decompressions; /* Pages decompressed */
+    uint64_t faults;         /* Page faults */
+    uint64_t purges;         /* Purgeable pages reclaimed */
+    uint64_t thp_collapses;  /* Huge pages assembled by khugepaged */
+    uint64_t thp_splits;     /* Huge pages split back into small pages */
+} vm_counters_t;
+
+/* macOS memory pressure levels (kern.memorystatus_vm_pressure_level) */
+#define PRESSURE_LEVEL_NORMAL   1
+#define PRESSURE_LEVEL_WARN     2
+#define PRESSURE_LEVEL_CRITICAL 4
+
+/*
+ * Memory pressure as the kernel reports it. Linux gives pressure stall
+ * information: the share of time in which some, or all non-idle, tasks
+ * were waiting on memory. macOS gives a level instead.
+ */
+typedef struct
+{
+    double   some_avg10; /* % of time some tasks stalled, last 10 s */
+    double   some_avg60; /* % of time some tasks stalled, last 60 s */
+    double   full_avg10; /* % of time all tasks stalled, last 10 s */
+    double   full_avg60; /* % of time all tasks stalled, last 60 s */
+    uint64_t some_total; /* Time some tasks stalled since boot, us */
+    uint64_t full_total; /* Time all tasks stalled since boot, us */
+    uint32_t level;      /* PRESSURE_LEVEL_* (macOS), 0 on Linux */
+    uint32_t valid;      /* Filled in; 0 when not sampled or unsupported */
+} pressure_info_t;
+
 /* Combined system memory information */
 typedef struct
 {
-    mem_info_t  mem;       /* Physical memory */
-    swap_info_t swap;      /* Swap memory */
-    vm_size_t   page_size; /* System page size */
+    mem_info_t      mem;       /* Physical memory */
+    swap_info_t     swap;      /* Swap memory */
+    vm_counters_t   counters;  /* Event counters (if requested) */
+    pressure_info_t pressure;  /* Kernel pressure (if requested) */
+    size_t          page_size; /* System page size */
+    uint64_t        timestamp; /* Monotonic sample time in nanoseconds */
+    uint64_t        walltime;  /* Wall-clock sample time, ns since epoch */
 } system_memory_t;
 
+/*
+ * Memory backend
+ *
+ * Each supported platform provides one of these. The generic functions
+ * below dispatch through the active backend, so callers never touch
+ * platform APIs directly. Backends may keep handles (file descriptors,
+ * host ports) open between init() and cleanup().
+ */
+typedef struct
+{
+    const char *name;                      /* Short backend name */
+    int (*init)(void);                     /* Acquire handles, 0 on success */
+    void (*cleanup)(void);                 /* Release handles */
+    size_t (*page_size)(void);             /* Page size in bytes */
+    uint64_t (*total_memory)(void);        /* Total memory, 0 on error */
+    int (*memory_info)(mem_info_t *mem);   /* Fill mem, 0 on success */
+    int (*swap_info)(swap_info_t *swap);   /* Fill swap, 0 on success */
+    int (*vm_counters)(vm_counters_t *counters); /* Fill event counters */
+    int (*pressure_info)(pressure_info_t *pressure); /* Fill pressure */
+} memory_backend_t;
+
+#ifdef __APPLE__
+extern const memory_backend_t memory_backend_darwin;
+#endif
+
+#ifdef __linux__
+extern const memory_backend_t memory_backend_linux;
+#endif
+
 /*
  * ============================================================================
  * Function Prototypes
  * ============================================================================
  */
 
+/**
+ * Get the active memory backend
+ *
+ * @return  Backend used by the functions below
+ */
+const memory_backend_t *memory_get_backend(void);
+
+/**
+ * Replace the active memory backend
+ *
+ * The previous backend is cleaned up if it had been initialized. The new
+ * backend is initialized lazily on first use.
+ *
+ * @param backend   Backend to use, or NULL for the platform default
+ */
+void memory_set_backend(const memory_backend_t *backend);
+
+/**
+ * Initialize the active memory backend
+ *
+ * Called implicitly by the functions below; calling it up front lets
+ * callers report setup errors before sampling starts.
+ *
+ * @return  0 on success, -1 on error
+ */
+int memory_init(void);
+
+/**
+ * Release resources held by the active memory backend
+ */
+void memory_cleanup(void);
+
 /**
  * Get system page size
  *
  * @return  Page size in bytes
  */
-vm_size_t get_page_size(void);
+size_t get_page_size(void);
 
 /**
  * Get total physical memory
@@ -68,6 +181,7 @@ vm_size_t get_page_size(void);
  */
 uint64_t get_total_memory(void);
 
+#ifdef __APPLE__
 /**
  * Get VM statistics from Mach kernel
  *
@@ -75,6 +189,7 @@ uint64_t get_total_memory(void);
  * @return          0 on success, -1 on error
  */
 int get_vm_stats(vm_statistics64_data_t *vm_stats);
+#endif
 
 /**
  * Get physical memory information
@@ -92,6 +207,22 @@ int get_memory_info(mem_info_t *mem);
  */
 int get_swap_info(swap_info_t *swap);
 
+/**
+ * Get cumulative paging and compression counters
+ *
+ * @param counters  Pointer to vm_counters_t structure to fill
+ * @return          0 on success, -1 on error
+ */
+int get_vm_counters(vm_counters_t *counters);
+
+/**
+ * Get the kernel's memory pressure information
+ *
+ * @param pressure  Pointer to pressure_info_t structure to fill
+ * @return          0 on success, -1 if the kernel does not provide it
+ */
+int get_pressure_info(pressure_info_t *pressure);
+
 /**
  * Get all system memory information
  *
@@ -103,9 +234,15 @@ int get_system_memory(system_memory_t *sys_mem);
 /**
  * Calculate memory pressure (0.0 - 1.0)
  *
- * @param mem   Pointer to mem_info_t structure
- * @return      Memory pressure as a ratio (0.0 = no pressure, 1.0 = critical)
+ * Uses the kernel's own figure when the sample carries one: on Linux the
+ * share of the last 10 seconds in which some task stalled on memory, on
+ * macOS 0.0, 0.5 or 1.0 for the normal, warning and critical levels.
+ * Otherwise it is estimated from used and compressed memory, which runs
+ * high on healthy systems with large caches.
+ *
+ * @param sys_mem   Sample, with sys_mem->pressure if it was collected
+ * @return          Memory pressure as a ratio (0.0 = none, 1.0 = critical)
  */
-double calculate_memory_pressure(const mem_info_t *mem);
+double calculate_memory_pressure(const system_memory_t *sys_mem);
 
 #endif /* MEMORY_H */
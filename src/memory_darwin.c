@@ -0,0 +1,264 @@
+/*
+ * memory_darwin.c - Mach/sysctl memory backend for macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "memory.h"
+
+#include <mach/mach_host.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/sysctl.h>
+
+/*
+ * ============================================================================
+ * Backend State
+ * ============================================================================
+ */
+
+/*
+ * Resolved once in darwin_init(): the host port, the page size and the
+ * installed memory never change while the process runs, so each sample
+ * only needs host_statistics64() and sysctl(VM_SWAPUSAGE).
+ */
+static mach_port_t g_host       = MACH_PORT_NULL;
+static uint64_t    g_page_size  = 0;
+static uint64_t    g_total      = 0;
+static int         g_swap_mib[] = {CTL_VM, VM_SWAPUSAGE};
+
+/*
+ * host_statistics64() returns the event counters along with the page
+ * counts; keep them from the last memory_info() call for vm_counters().
+ */
+static vm_statistics64_data_t g_last_stats;
+static int                    g_stats_pending = 0;
+
+/*
+ * ============================================================================
+ * System Information Functions
+ * ============================================================================
+ */
+
+static int darwin_init(void)
+{
+    int       mib[2] = {CTL_HW, HW_MEMSIZE};
+    size_t    length = sizeof(g_total);
+    vm_size_t page_size;
+
+    g_host = mach_host_self();
+
+    if (host_page_size(g_host, &page_size) != KERN_SUCCESS)
+    {
+        page_size = vm_page_size;
+    }
+    g_page_size = (uint64_t)page_size;
+
+    if (sysctl(mib, 2, &g_total, &length, NULL, 0) != 0)
+    {
+        perror("sysctl HW_MEMSIZE");
+        mach_port_deallocate(mach_task_self(), g_host);
+        g_host = MACH_PORT_NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void darwin_cleanup(void)
+{
+    if (g_host != MACH_PORT_NULL)
+    {
+        mach_port_deallocate(mach_task_self(), g_host);
+        g_host = MACH_PORT_NULL;
+    }
+    g_stats_pending = 0;
+}
+
+static size_t darwin_page_size(void)
+{
+    return (size_t)g_page_size;
+}
+
+static uint64_t darwin_total_memory(void)
+{
+    return g_total;
+}
+
+int get_vm_stats(vm_statistics64_data_t *vm_stats)
+{
+    if (vm_stats == NULL)
+    {
+        return -1;
+    }
+
+    if (g_host == MACH_PORT_NULL && memory_init() != 0)
+    {
+        return -1;
+    }
+
+    mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+    kern_return_t          kr;
+
+    kr = host_statistics64(g_host, HOST_VM_INFO64,
+                           (host_info64_t)vm_stats, &count);
+
+    if (kr != KERN_SUCCESS)
+    {
+        fprintf(stderr, "host_statistics64 failed: %s\n",
+                mach_error_string(kr));
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Memory Information Functions
+ * ============================================================================
+ */
+
+static int darwin_memory_info(mem_info_t *mem)
+{
+    mem->total = g_total;
+
+    /* Get VM statistics */
+    vm_statistics64_data_t vm_stats;
+    if (get_vm_stats(&vm_stats) != 0)
+    {
+        return -1;
+    }
+
+    g_last_stats    = vm_stats;
+    g_stats_pending = 1;
+
+    uint64_t page_size = g_page_size;
+
+    /* Calculate memory values in bytes */
+    mem->free       = (uint64_t)vm_stats.free_count * page_size;
+    mem->active     = (uint64_t)vm_stats.active_count * page_size;
+    mem->inactive   = (uint64_t)vm_stats.inactive_count * page_size;
+    mem->wired      = (uint64_t)vm_stats.wire_count * page_size;
+    mem->compressed = (uint64_t)vm_stats.compressor_page_count * page_size;
+
+    /* What the compressor holds, at its size before compression */
+    mem->compressed_orig =
+        vm_stats.total_uncompressed_pages_in_compressor * page_size;
+
+    /* Purgeable memory (cached) */
+    mem->cached = (uint64_t)vm_stats.purgeable_count * page_size;
+
+    /*
+     * Calculate used memory
+     * Used = Active + Wired + Compressed
+     * (Inactive and cached are considered "available")
+     */
+    mem->used = mem->active + mem->wired + mem->compressed;
+
+    /*
+     * Calculate available memory
+     * Available = Free + Inactive + Cached
+     * This represents memory that can be reclaimed if needed
+     */
+    mem->available = mem->free + mem->inactive + mem->cached;
+
+    /*
+     * App memory is roughly the active memory minus cached files
+     * This is an approximation since macOS doesn't expose this directly
+     */
+    mem->app_memory = mem->active;
+
+    /*
+     * macOS has no direct equivalent of Linux shared memory or buffers,
+     * so "shared" shows compressed memory as an approximation and
+     * "buff/cache" shows purgeable plus inactive pages.
+     */
+    mem->shared     = mem->compressed;
+    mem->buff_cache = mem->cached + mem->inactive;
+
+    /*
+     * Superpages come from the regular free list; nothing is set aside.
+     * There are no transparent huge pages either.
+     */
+    mem->hugetlb = 0;
+
+    return 0;
+}
+
+static int darwin_swap_info(swap_info_t *swap)
+{
+    struct xsw_usage swap_usage;
+    size_t           length = sizeof(swap_usage);
+
+    if (sysctl(g_swap_mib, 2, &swap_usage, &length, NULL, 0) != 0)
+    {
+        perror("sysctl VM_SWAPUSAGE");
+        return -1;
+    }
+
+    swap->total = swap_usage.xsu_total;
+    swap->used  = swap_usage.xsu_used;
+    swap->free  = swap_usage.xsu_avail;
+
+    return 0;
+}
+
+static int darwin_vm_counters(vm_counters_t *counters)
+{
+    /* Reuse the statistics from a preceding memory_info() call if fresh */
+    if (!g_stats_pending && get_vm_stats(&g_last_stats) != 0)
+    {
+        return -1;
+    }
+    g_stats_pending = 0;
+
+    counters->pageins        = g_last_stats.pageins;
+    counters->pageouts       = g_last_stats.pageouts;
+    counters->swapins        = g_last_stats.swapins;
+    counters->swapouts       = g_last_stats.swapouts;
+    counters->compressions   = g_last_stats.compressions;
+    counters->decompressions = g_last_stats.decompressions;
+    counters->faults         = g_last_stats.faults;
+    counters->purges         = g_last_stats.purges;
+    counters->thp_collapses  = 0; /* No transparent huge pages */
+    counters->thp_splits     = 0;
+
+    return 0;
+}
+
+static int darwin_pressure_info(pressure_info_t *pressure)
+{
+    int    level  = 0;
+    size_t length = sizeof(level);
+
+    /* The level Activity Monitor colours its memory pressure graph by */
+    if (sysctlbyname("kern.memorystatus_vm_pressure_level", &level, &length,
+                     NULL, 0) != 0 ||
+        level <= 0)
+    {
+        return -1;
+    }
+
+    pressure->level = (uint32_t)level;
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Backend Definition
+ * ============================================================================
+ */
+
+const memory_backend_t memory_backend_darwin = {
+    .name          = "darwin",
+    .init          = darwin_init,
+    .cleanup       = darwin_cleanup,
+    .page_size     = darwin_page_size,
+    .total_memory  = darwin_total_memory,
+    .memory_info   = darwin_memory_info,
+    .swap_info     = darwin_swap_info,
+    .vm_counters   = darwin_vm_counters,
+    .pressure_info = darwin_pressure_info,
+};
@@ -0,0 +1,424 @@
+/*
+ * memory_linux.c - /proc/meminfo memory backend for Linux
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "memory.h"
+#include "procfs.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define MEMINFO_PATH      "/proc/meminfo"
+#define VMSTAT_PATH       "/proc/vmstat"
+#define PRESSURE_PATH     "/proc/pressure/memory"
+#define MEMINFO_BUF_SIZE  8192
+#define VMSTAT_BUF_SIZE   16384
+#define PRESSURE_BUF_SIZE 256
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Raw /proc/meminfo values we care about, in bytes */
+typedef struct
+{
+    uint64_t mem_total;
+    uint64_t mem_free;
+    uint64_t mem_available;
+    uint64_t buffers;
+    uint64_t cached;
+    uint64_t active;
+    uint64_t inactive;
+    uint64_t unevictable;
+    uint64_t anon_pages;
+    uint64_t shmem;
+    uint64_t s_reclaimable;
+    uint64_t s_unreclaim;
+    uint64_t kernel_stack;
+    uint64_t page_tables;
+    uint64_t zswap;
+    uint64_t zswapped;       /* Linux 5.19+ */
+    uint64_t swap_total;
+    uint64_t swap_free;
+    uint64_t hugetlb;        /* All hugetlb pools (Linux 4.16+) */
+    uint64_t hugepages;      /* Default-size pool, pages */
+    uint64_t hugepage_size;  /* Default huge page size */
+    uint64_t anon_huge;      /* AnonHugePages */
+    uint64_t shmem_huge;     /* ShmemHugePages */
+    uint64_t file_huge;      /* FileHugePages (Linux 5.4+) */
+    int      has_available;  /* MemAvailable present (Linux 3.14+) */
+} meminfo_t;
+
+/* Raw /proc/vmstat event counters we care about */
+typedef struct
+{
+    uint64_t pgpgin;  /* KiB paged in */
+    uint64_t pgpgout; /* KiB paged out */
+    uint64_t pswpin;
+    uint64_t pswpout;
+    uint64_t zswpin;
+    uint64_t zswpout;
+    uint64_t pgfault;
+    uint64_t thp_collapse_alloc;
+    uint64_t thp_split_page;
+} vmstat_t;
+
+#define MEMINFO_KEY(name, field) PROCFS_KEY(name, meminfo_t, field)
+#define VMSTAT_KEY(name)         PROCFS_KEY(#name, vmstat_t, name)
+
+/* Positions in meminfo_keys, for the bits procfs_parse() returns */
+enum
+{
+    MEMINFO_MEM_TOTAL,
+    MEMINFO_MEM_FREE,
+    MEMINFO_MEM_AVAILABLE,
+    MEMINFO_BUFFERS,
+    MEMINFO_CACHED,
+    MEMINFO_ACTIVE,
+    MEMINFO_INACTIVE,
+    MEMINFO_UNEVICTABLE,
+    MEMINFO_ANON_PAGES,
+    MEMINFO_SHMEM,
+    MEMINFO_S_RECLAIMABLE,
+    MEMINFO_S_UNRECLAIM,
+    MEMINFO_KERNEL_STACK,
+    MEMINFO_PAGE_TABLES,
+    MEMINFO_ZSWAP,
+    MEMINFO_ZSWAPPED,
+    MEMINFO_SWAP_TOTAL,
+    MEMINFO_SWAP_FREE,
+    MEMINFO_HUGETLB,
+    MEMINFO_HUGEPAGES,
+    MEMINFO_HUGEPAGE_SIZE,
+    MEMINFO_ANON_HUGE,
+    MEMINFO_SHMEM_HUGE,
+    MEMINFO_FILE_HUGE,
+    MEMINFO_NKEYS
+};
+
+static const procfs_key_t meminfo_keys[MEMINFO_NKEYS] = {
+    [MEMINFO_MEM_TOTAL]     = MEMINFO_KEY("MemTotal", mem_total),
+    [MEMINFO_MEM_FREE]      = MEMINFO_KEY("MemFree", mem_free),
+    [MEMINFO_MEM_AVAILABLE] = MEMINFO_KEY("MemAvailable", mem_available),
+    [MEMINFO_BUFFERS]       = MEMINFO_KEY("Buffers", buffers),
+    [MEMINFO_CACHED]        = MEMINFO_KEY("Cached", cached),
+    [MEMINFO_ACTIVE]        = MEMINFO_KEY("Active", active),
+    [MEMINFO_INACTIVE]      = MEMINFO_KEY("Inactive", inactive),
+    [MEMINFO_UNEVICTABLE]   = MEMINFO_KEY("Unevictable", unevictable),
+    [MEMINFO_ANON_PAGES]    = MEMINFO_KEY("AnonPages", anon_pages),
+    [MEMINFO_SHMEM]         = MEMINFO_KEY("Shmem", shmem),
+    [MEMINFO_S_RECLAIMABLE] = MEMINFO_KEY("SReclaimable", s_reclaimable),
+    [MEMINFO_S_UNRECLAIM]   = MEMINFO_KEY("SUnreclaim", s_unreclaim),
+    [MEMINFO_KERNEL_STACK]  = MEMINFO_KEY("KernelStack", kernel_stack),
+    [MEMINFO_PAGE_TABLES]   = MEMINFO_KEY("PageTables", page_tables),
+    [MEMINFO_ZSWAP]         = MEMINFO_KEY("Zswap", zswap),
+    [MEMINFO_ZSWAPPED]      = MEMINFO_KEY("Zswapped", zswapped),
+    [MEMINFO_SWAP_TOTAL]    = MEMINFO_KEY("SwapTotal", swap_total),
+    [MEMINFO_SWAP_FREE]     = MEMINFO_KEY("SwapFree", swap_free),
+    [MEMINFO_HUGETLB]       = MEMINFO_KEY("Hugetlb", hugetlb),
+    [MEMINFO_HUGEPAGES]     = MEMINFO_KEY("HugePages_Total", hugepages),
+    [MEMINFO_HUGEPAGE_SIZE] = MEMINFO_KEY("Hugepagesize", hugepage_size),
+    [MEMINFO_ANON_HUGE]     = MEMINFO_KEY("AnonHugePages", anon_huge),
+    [MEMINFO_SHMEM_HUGE]    = MEMINFO_KEY("ShmemHugePages", shmem_huge),
+    [MEMINFO_FILE_HUGE]     = MEMINFO_KEY("FileHugePages", file_huge),
+};
+
+static const procfs_key_t vmstat_keys[] = {
+    VMSTAT_KEY(pgpgin), VMSTAT_KEY(pgpgout), VMSTAT_KEY(pswpin),
+    VMSTAT_KEY(pswpout), VMSTAT_KEY(zswpin), VMSTAT_KEY(zswpout),
+    VMSTAT_KEY(pgfault), VMSTAT_KEY(thp_collapse_alloc),
+    VMSTAT_KEY(thp_split_page),
+};
+
+#define VMSTAT_NKEYS (sizeof(vmstat_keys) / sizeof(vmstat_keys[0]))
+
+/*
+ * ============================================================================
+ * Backend State
+ * ============================================================================
+ */
+
+static int    g_meminfo_fd  = -1;
+static int    g_vmstat_fd   = -1;
+static int    g_pressure_fd = -1;
+static char   g_buf[MEMINFO_BUF_SIZE];
+static char   g_vmstat_buf[VMSTAT_BUF_SIZE];
+static size_t g_page_size = 0;
+
+/* Swap values parsed alongside the last memory_info() call */
+static swap_info_t g_swap;
+static int         g_swap_pending = 0;
+
+/*
+ * ============================================================================
+ * /proc/meminfo Parsing
+ * ============================================================================
+ */
+
+static int sample_meminfo(meminfo_t *info)
+{
+    ssize_t len = procfs_read(g_meminfo_fd, g_buf, sizeof(g_buf));
+    if (len <= 0)
+    {
+        perror("read " MEMINFO_PATH);
+        return -1;
+    }
+
+    memset(info, 0, sizeof(meminfo_t));
+    uint64_t found =
+        procfs_parse(g_buf, (size_t)len, meminfo_keys, MEMINFO_NKEYS, info);
+    info->has_available = (found & PROCFS_FOUND(MEMINFO_MEM_AVAILABLE)) != 0;
+
+    if (info->mem_total == 0)
+    {
+        fprintf(stderr, "Error: MemTotal missing from " MEMINFO_PATH "\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void fill_swap(const meminfo_t *info, swap_info_t *swap)
+{
+    swap->total = info->swap_total;
+    swap->free  = info->swap_free;
+    swap->used =
+        info->swap_total > info->swap_free ? info->swap_total - info->swap_free
+                                           : 0;
+}
+
+/*
+ * ============================================================================
+ * Backend Operations
+ * ============================================================================
+ */
+
+static int linux_init(void)
+{
+    g_meminfo_fd = open(MEMINFO_PATH, O_RDONLY | O_CLOEXEC);
+    if (g_meminfo_fd < 0)
+    {
+        perror("open " MEMINFO_PATH);
+        return -1;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    g_page_size    = page_size > 0 ? (size_t)page_size : 4096;
+
+    return 0;
+}
+
+static void linux_cleanup(void)
+{
+    if (g_meminfo_fd >= 0)
+    {
+        close(g_meminfo_fd);
+        g_meminfo_fd = -1;
+    }
+    if (g_vmstat_fd >= 0)
+    {
+        close(g_vmstat_fd);
+        g_vmstat_fd = -1;
+    }
+    if (g_pressure_fd >= 0)
+    {
+        close(g_pressure_fd);
+        g_pressure_fd = -1;
+    }
+    g_swap_pending = 0;
+}
+
+static size_t linux_page_size(void)
+{
+    return g_page_size;
+}
+
+static uint64_t linux_total_memory(void)
+{
+    meminfo_t info;
+    if (sample_meminfo(&info) != 0)
+    {
+        return 0;
+    }
+
+    return info.mem_total;
+}
+
+static int linux_memory_info(mem_info_t *mem)
+{
+    meminfo_t info;
+    if (sample_meminfo(&info) != 0)
+    {
+        return -1;
+    }
+
+    mem->total      = info.mem_total;
+    mem->free       = info.mem_free;
+    mem->active     = info.active;
+    mem->inactive   = info.inactive;
+    mem->compressed = info.zswap;
+    mem->app_memory = info.anon_pages;
+    mem->shared     = info.shmem;
+
+    /* Page cache plus reclaimable slab, as procps counts it */
+    mem->cached     = info.cached + info.s_reclaimable;
+    mem->buff_cache = info.buffers + mem->cached;
+
+    /* Memory the kernel cannot page out */
+    mem->wired = info.unevictable + info.s_unreclaim + info.kernel_stack +
+                 info.page_tables;
+
+    /* Zswapped (Linux 5.19+) is what the Zswap pool holds, uncompressed */
+    mem->compressed_orig = info.zswapped;
+
+    /* Without THP support these lines are absent and stay zero */
+    mem->thp_anon  = info.anon_huge;
+    mem->thp_shmem = info.shmem_huge;
+    mem->thp_file  = info.file_huge;
+
+    /* Before 4.16 only the default-size pool is reported */
+    mem->hugetlb = info.hugetlb > 0 ? info.hugetlb
+                                    : info.hugepages * info.hugepage_size;
+
+    /*
+     * Used = Total - Free - Buffers - Cache, as procps free counts it,
+     * minus the hugetlb pool: it is set aside whether or not anyone maps
+     * it, and is reported on its own. Clamp in case the counters moved
+     * between lines of the file.
+     */
+    uint64_t unused = mem->free + mem->buff_cache + mem->hugetlb;
+    mem->used       = mem->total > unused ? mem->total - unused : 0;
+
+    /* Kernels before 3.14 lack MemAvailable; estimate it like procps */
+    if (info.has_available)
+    {
+        mem->available = info.mem_available;
+    }
+    else
+    {
+        mem->available = mem->free + mem->buff_cache;
+    }
+
+    /* The same read carries the swap counters; keep them for swap_info() */
+    fill_swap(&info, &g_swap);
+    g_swap_pending = 1;
+
+    return 0;
+}
+
+static int linux_swap_info(swap_info_t *swap)
+{
+    /* Reuse the counters from a preceding memory_info() call if fresh */
+    if (g_swap_pending)
+    {
+        *swap          = g_swap;
+        g_swap_pending = 0;
+        return 0;
+    }
+
+    meminfo_t info;
+    if (sample_meminfo(&info) != 0)
+    {
+        return -1;
+    }
+
+    fill_swap(&info, swap);
+    return 0;
+}
+
+static int linux_vm_counters(vm_counters_t *counters)
+{
+    /* Opened on first use: most runs never ask for event counters */
+    if (g_vmstat_fd < 0)
+    {
+        g_vmstat_fd = open(VMSTAT_PATH, O_RDONLY | O_CLOEXEC);
+        if (g_vmstat_fd < 0)
+        {
+            perror("open " VMSTAT_PATH);
+            return -1;
+        }
+    }
+
+    ssize_t len = procfs_read(g_vmstat_fd, g_vmstat_buf, sizeof(g_vmstat_buf));
+    if (len <= 0)
+    {
+        perror("read " VMSTAT_PATH);
+        return -1;
+    }
+
+    vmstat_t stat;
+    memset(&stat, 0, sizeof(stat));
+    procfs_parse(g_vmstat_buf, (size_t)len, vmstat_keys, VMSTAT_NKEYS, &stat);
+
+    /* pgpgin/pgpgout count KiB; report pages like the Mach counters */
+    counters->pageins        = stat.pgpgin * 1024 / g_page_size;
+    counters->pageouts       = stat.pgpgout * 1024 / g_page_size;
+    counters->swapins        = stat.pswpin;
+    counters->swapouts       = stat.pswpout;
+    counters->compressions   = stat.zswpout;
+    counters->decompressions = stat.zswpin;
+    counters->faults         = stat.pgfault;
+    counters->purges         = 0; /* No Linux equivalent */
+    counters->thp_collapses  = stat.thp_collapse_alloc;
+    counters->thp_splits     = stat.thp_split_page;
+
+    return 0;
+}
+
+static int linux_pressure_info(pressure_info_t *pressure)
+{
+    char buf[PRESSURE_BUF_SIZE];
+
+    /*
+     * Opened on first use. Kernels before 4.20, or booted with psi=0,
+     * have no such file or fail the read; the caller then estimates.
+     */
+    if (g_pressure_fd < 0)
+    {
+        g_pressure_fd = open(PRESSURE_PATH, O_RDONLY | O_CLOEXEC);
+        if (g_pressure_fd < 0)
+        {
+            return -1;
+        }
+    }
+
+    ssize_t len = procfs_read(g_pressure_fd, buf, sizeof(buf));
+    if (len <= 0)
+    {
+        return -1;
+    }
+
+    return procfs_parse_psi(buf, (size_t)len, pressure);
+}
+
+/*
+ * ============================================================================
+ * Backend Definition
+ * ============================================================================
+ */
+
+const memory_backend_t memory_backend_linux = {
+    .name          = "linux",
+    .init          = linux_init,
+    .cleanup       = linux_cleanup,
+    .page_size     = linux_page_size,
+    .total_memory  = linux_total_memory,
+    .memory_info   = linux_memory_info,
+    .swap_info     = linux_swap_info,
+    .vm_counters   = linux_vm_counters,
+    .pressure_info = linux_pressure_info,
+};
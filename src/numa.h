@@ -0,0 +1,88 @@
+/*
+ * numa.h - Per-node memory on NUMA machines
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define NUMA_MAX_NODES 64 /* Nodes shown; larger machines are cut off */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Memory of one node */
+typedef struct
+{
+    int      id;           /* Node number */
+    int      meminfo_fd;   /* node<id>/meminfo */
+    int      numastat_fd;  /* node<id>/numastat */
+    uint64_t total;        /* MemTotal, bytes */
+    uint64_t used;         /* Not free, file-backed or reclaimable, bytes */
+    uint64_t free;         /* MemFree, bytes */
+    uint64_t file;         /* FilePages, bytes */
+    uint64_t anon;         /* AnonPages, bytes */
+    uint64_t numa_miss;    /* Pages placed here though meant elsewhere */
+    uint64_t numa_foreign; /* Pages meant for here but placed elsewhere */
+    double   miss_rate;    /* numa_miss per second */
+    double   foreign_rate; /* numa_foreign per second */
+} numa_node_t;
+
+/*
+ * All nodes
+ *
+ * Every node's meminfo and numastat stay open, so a sample is one
+ * pread() per file and nothing is looked up again.
+ */
+typedef struct
+{
+    numa_node_t nodes[NUMA_MAX_NODES]; /* Nodes by number */
+    size_t      count;                 /* Entries in nodes */
+    uint64_t    timestamp;             /* Monotonic time of the last sample */
+    int         has_rates;             /* Rates cover a previous sample */
+} numa_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Open every memory node's files
+ *
+ * @param numa      Nodes to initialize
+ * @return          0 on success, -1 if there are none (or not Linux)
+ */
+int numa_init(numa_t *numa);
+
+/**
+ * Read every node and update the miss and foreign rates
+ *
+ * @param numa      Initialized nodes
+ * @return          0 on success, -1 on error
+ */
+int numa_sample(numa_t *numa);
+
+/**
+ * Close every node's files
+ *
+ * @param numa      Nodes to clean up
+ */
+void numa_cleanup(numa_t *numa);
+
+#endif /* NUMA_H */
@@ -0,0 +1,37 @@
+/*
+ * numa_darwin.c - Per-node memory, unavailable on macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "numa.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+/* Macs have a single memory node; Apple silicon memory is unified */
+int numa_init(numa_t *numa)
+{
+    memset(numa, 0, sizeof(numa_t));
+
+    fprintf(stderr, "Error: --numa is only supported on Linux\n");
+    return -1;
+}
+
+int numa_sample(numa_t *numa)
+{
+    (void)numa;
+    return -1;
+}
+
+void numa_cleanup(numa_t *numa)
+{
+    numa->count = 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * numa_linux.c - Per-node memory from /sys/devices/system/node
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "numa.h"
+
+#include "procfs.h"
+#include "utils.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define NODE_DIR          "/sys/devices/system/node"
+#define NODE_PATH_MAX     96
+#define MEMINFO_BUF_SIZE  4096
+#define NUMASTAT_BUF_SIZE 512
+
+/*
+ * ============================================================================
+ * Key Tables
+ * ============================================================================
+ */
+
+/* Fields of node<N>/meminfo ("Node N Key: value kB") */
+typedef struct
+{
+    uint64_t total;
+    uint64_t free;
+    uint64_t file;
+    uint64_t anon;
+    uint64_t slab_reclaimable;
+} node_meminfo_t;
+
+static const procfs_key_t meminfo_keys[] = {
+    PROCFS_KEY("MemTotal", node_meminfo_t, total),
+    PROCFS_KEY("MemFree", node_meminfo_t, free),
+    PROCFS_KEY("FilePages", node_meminfo_t, file),
+    PROCFS_KEY("AnonPages", node_meminfo_t, anon),
+    PROCFS_KEY("SReclaimable", node_meminfo_t, slab_reclaimable),
+};
+
+#define MEMINFO_NKEYS (sizeof(meminfo_keys) / sizeof(meminfo_keys[0]))
+
+static const procfs_key_t numastat_keys[] = {
+    PROCFS_KEY("numa_miss", numa_node_t, numa_miss),
+    PROCFS_KEY("numa_foreign", numa_node_t, numa_foreign),
+};
+
+#define NUMASTAT_NKEYS (sizeof(numastat_keys) / sizeof(numastat_keys[0]))
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+/* "node12" -> 12; -1 for anything else in the directory */
+static int node_id(const char *name)
+{
+    char *end;
+
+    if (strncmp(name, "node", 4) != 0 || name[4] < '0' || name[4] > '9')
+    {
+        return -1;
+    }
+
+    long id = strtol(name + 4, &end, 10);
+    return *end == '\0' && id < 1000000 ? (int)id : -1;
+}
+
+static int compare_nodes(const void *a, const void *b)
+{
+    const numa_node_t *x = a;
+    const numa_node_t *y = b;
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static int open_node_file(int id, const char *name)
+{
+    char path[NODE_PATH_MAX];
+
+    snprintf(path, sizeof(path), NODE_DIR "/node%d/%s", id, name);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+/*
+ * ============================================================================
+ * Public Functions
+ * ============================================================================
+ */
+
+int numa_init(numa_t *numa)
+{
+    struct dirent *ent;
+
+    memset(numa, 0, sizeof(numa_t));
+
+    DIR *dir = opendir(NODE_DIR);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Error: No NUMA information in " NODE_DIR "\n");
+        return -1;
+    }
+
+    while ((ent = readdir(dir)) != NULL && numa->count < NUMA_MAX_NODES)
+    {
+        int id = node_id(ent->d_name);
+        if (id < 0)
+        {
+            continue;
+        }
+
+        numa_node_t *node = &numa->nodes[numa->count];
+        node->id          = id;
+        node->meminfo_fd  = open_node_file(id, "meminfo");
+        node->numastat_fd = open_node_file(id, "numastat");
+
+        if (node->meminfo_fd < 0)
+        {
+            /* Offline, or gone since the listing */
+            if (node->numastat_fd >= 0)
+            {
+                close(node->numastat_fd);
+            }
+            continue;
+        }
+
+        numa->count++;
+    }
+    closedir(dir);
+
+    if (numa->count == 0)
+    {
+        fprintf(stderr, "Error: No NUMA nodes found in " NODE_DIR "\n");
+        return -1;
+    }
+
+    /* readdir() order is arbitrary; show node0 first */
+    qsort(numa->nodes, numa->count, sizeof(numa_node_t), compare_nodes);
+
+    return 0;
+}
+
+int numa_sample(numa_t *numa)
+{
+    char     meminfo[MEMINFO_BUF_SIZE];
+    char     numastat[NUMASTAT_BUF_SIZE];
+    uint64_t now     = monotonic_ns();
+    double   elapsed = (double)(now - numa->timestamp) / 1e9;
+
+    for (size_t i = 0; i < numa->count; i++)
+    {
+        numa_node_t   *node = &numa->nodes[i];
+        node_meminfo_t info = {0};
+
+        ssize_t len = procfs_read(node->meminfo_fd, meminfo, sizeof(meminfo));
+        if (len <= 0)
+        {
+            perror("read node meminfo");
+            return -1;
+        }
+        procfs_parse(meminfo, (size_t)len, meminfo_keys, MEMINFO_NKEYS,
+                     &info);
+
+        /* Same split as the Mem row: cache and reclaimable slab are free */
+        uint64_t reclaimable = info.free + info.file + info.slab_reclaimable;
+
+        node->total = info.total;
+        node->free  = info.free;
+        node->file  = info.file;
+        node->anon  = info.anon;
+        node->used  = info.total > reclaimable ? info.total - reclaimable : 0;
+
+        /* numastat is optional; without it the rates stay zero */
+        if (node->numastat_fd < 0)
+        {
+            continue;
+        }
+
+        uint64_t miss    = node->numa_miss;
+        uint64_t foreign = node->numa_foreign;
+
+        len = procfs_read(node->numastat_fd, numastat, sizeof(numastat));
+        if (len > 0)
+        {
+            procfs_parse(numastat, (size_t)len, numastat_keys, NUMASTAT_NKEYS,
+                         node);
+        }
+
+        if (numa->timestamp > 0 && elapsed > 0.0)
+        {
+            node->miss_rate    = (double)(node->numa_miss - miss) / elapsed;
+            node->foreign_rate =
+                (double)(node->numa_foreign - foreign) / elapsed;
+        }
+    }
+
+    numa->has_rates = numa->timestamp > 0;
+    numa->timestamp = now;
+    return 0;
+}
+
+void numa_cleanup(numa_t *numa)
+{
+    for (size_t i = 0; i < numa->count; i++)
+    {
+        close(numa->nodes[i].meminfo_fd);
+        if (numa->nodes[i].numastat_fd >= 0)
+        {
+            close(numa->nodes[i].numastat_fd);
+        }
+    }
+    numa->count = 0;
+}
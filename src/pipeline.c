@@ -0,0 +1,487 @@
+/*
+ * pipeline.c - Sampler/writer pipeline decoupling output from sampling
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "pipeline.h"
+
+#include "ticker.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Sinks
+ * ============================================================================
+ */
+
+#define SINK_UNIX_PREFIX "unix:"
+
+/* Connect to a Unix stream socket */
+static int open_socket(const char *path)
+{
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "Error: Cannot connect to %s: %s\n", path,
+                strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int open_sink(pipeline_sink_t *sink, const char *spec)
+{
+    size_t prefix = strlen(SINK_UNIX_PREFIX);
+
+    sink->spec  = spec;
+    sink->owned = 1;
+
+    if (strcmp(spec, "-") == 0)
+    {
+        sink->fd    = STDOUT_FILENO;
+        sink->owned = 0;
+    }
+    else if (strncmp(spec, SINK_UNIX_PREFIX, prefix) == 0)
+    {
+        sink->fd = open_socket(spec + prefix);
+    }
+    else
+    {
+        sink->fd = open(spec, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (sink->fd < 0)
+        {
+            fprintf(stderr, "Error: Cannot open %s: %s\n", spec,
+                    strerror(errno));
+        }
+    }
+
+    if (sink->fd < 0)
+    {
+        return -1;
+    }
+
+    /*
+     * Pipes and sockets can stall on their reader; files and terminals
+     * are left blocking. The flags of a shared descriptor (stdout) are
+     * restored on close.
+     */
+    struct stat st;
+    sink->flags = fcntl(sink->fd, F_GETFL);
+    if (sink->flags >= 0 && fstat(sink->fd, &st) == 0 &&
+        (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode)))
+    {
+        fcntl(sink->fd, F_SETFL, sink->flags | O_NONBLOCK);
+    }
+
+    return 0;
+}
+
+/* Write what the sink takes without blocking; bytes written, -1 on error */
+static ssize_t write_some(int fd, const char *buf, size_t len)
+{
+    size_t done = 0;
+
+    while (done < len)
+    {
+        ssize_t n = write(fd, buf + done, len - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+
+    return (ssize_t)done;
+}
+
+static int flush_backlog(pipeline_sink_t *sink)
+{
+    ssize_t n = write_some(sink->fd, sink->backlog, sink->pending);
+    if (n < 0)
+    {
+        return -1;
+    }
+
+    sink->pending -= (size_t)n;
+    memmove(sink->backlog, sink->backlog + n, sink->pending);
+    return 0;
+}
+
+/*
+ * Write a frame, or queue what the reader does not take at once
+ *
+ * Frames are queued or dropped whole, so the reader never sees a torn
+ * one. The remainder of a partly written frame always fits, since it is
+ * only written directly into an empty backlog.
+ */
+static int sink_write(pipeline_sink_t *sink, const frame_t *frame)
+{
+    const char *p   = frame->buf;
+    size_t      len = frame->len;
+
+    if (sink->pending > 0 && flush_backlog(sink) != 0)
+    {
+        return -1;
+    }
+
+    if (sink->pending == 0)
+    {
+        ssize_t n = write_some(sink->fd, p, len);
+        if (n < 0)
+        {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        sink->lagging = 0;
+    }
+
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    if (sink->pending + len > sizeof(sink->backlog))
+    {
+        if (!sink->lagging)
+        {
+            fprintf(stderr, "Warning: %s fell behind, dropping frames\n",
+                    sink->spec);
+        }
+        sink->lagging = 1;
+        sink->dropped++;
+        return 0;
+    }
+
+    memcpy(sink->backlog + sink->pending, p, len);
+    sink->pending += len;
+    return 0;
+}
+
+/* Wait up to PIPELINE_DRAIN_MS for a slow reader to take the backlog */
+static void drain_sink(pipeline_sink_t *sink)
+{
+    uint64_t deadline = monotonic_ns() +
+                        (uint64_t)PIPELINE_DRAIN_MS * NSEC_PER_MSEC;
+
+    while (sink->pending > 0 && flush_backlog(sink) == 0 &&
+           sink->pending > 0)
+    {
+        uint64_t now = monotonic_ns();
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        struct pollfd pfd     = {.fd = sink->fd, .events = POLLOUT};
+        int           timeout = (int)((deadline - now) / NSEC_PER_MSEC) + 1;
+        if (poll(&pfd, 1, timeout) <= 0)
+        {
+            break;
+        }
+    }
+
+    if (sink->pending > 0)
+    {
+        fprintf(stderr, "Warning: %s: %zu byte(s) never delivered\n",
+                sink->spec, sink->pending);
+    }
+}
+
+static void close_sinks(pipeline_t *pipeline)
+{
+    for (size_t i = 0; i < pipeline->sink_count; i++)
+    {
+        pipeline_sink_t *sink = &pipeline->sinks[i];
+
+        if (sink->fd >= 0 && sink->owned)
+        {
+            close(sink->fd);
+        }
+        else if (sink->fd >= 0 && sink->flags >= 0)
+        {
+            fcntl(sink->fd, F_SETFL, sink->flags);
+        }
+        sink->fd = -1;
+    }
+}
+
+int pipeline_write(pipeline_t *pipeline, const frame_t *frame)
+{
+    for (size_t i = 0; i < pipeline->sink_count; i++)
+    {
+        pipeline_sink_t *sink = &pipeline->sinks[i];
+
+        if (sink->fd < 0 || sink_write(sink, frame) == 0)
+        {
+            continue;
+        }
+
+        fprintf(stderr, "Warning: Dropping output %s: %s\n", sink->spec,
+                strerror(errno));
+        if (sink->owned)
+        {
+            close(sink->fd);
+        }
+        sink->fd = -1;
+        pipeline->sink_live--;
+    }
+
+    if (pipeline->sink_live == 0)
+    {
+        atomic_store(&pipeline->failed, 1);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Writer Thread
+ * ============================================================================
+ */
+
+/* Warn once per burst of overruns, from the thread that fell behind */
+static void report_overruns(pipeline_t *pipeline)
+{
+    uint64_t overruns = atomic_load_explicit(&pipeline->overruns,
+                                             memory_order_relaxed);
+
+    if (overruns > pipeline->reported)
+    {
+        fprintf(stderr,
+                "Warning: output fell behind, %llu sample(s) dropped\n",
+                (unsigned long long)(overruns - pipeline->reported));
+        pipeline->reported = overruns;
+    }
+}
+
+static void *writer_main(void *arg)
+{
+    pipeline_t     *pipeline = arg;
+    system_memory_t prev;
+    int             have_prev = 0;
+
+    for (;;)
+    {
+        uint64_t tail = atomic_load_explicit(&pipeline->tail,
+                                             memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&pipeline->head,
+                                             memory_order_acquire);
+
+        if (tail == head)
+        {
+            /* Re-check under the lock so a push cannot slip past us */
+            pthread_mutex_lock(&pipeline->lock);
+            while (atomic_load(&pipeline->head) == tail &&
+                   !atomic_load(&pipeline->done))
+            {
+                pthread_cond_wait(&pipeline->wake, &pipeline->lock);
+            }
+            pthread_mutex_unlock(&pipeline->lock);
+
+            if (atomic_load(&pipeline->head) == tail)
+            {
+                break; /* Done and drained */
+            }
+            continue;
+        }
+
+        /* Copy out so the slot can be reused while we render */
+        system_memory_t cur = pipeline->ring[tail & (PIPELINE_RING_SIZE - 1)];
+        atomic_store_explicit(&pipeline->tail, tail + 1, memory_order_release);
+
+        report_overruns(pipeline);
+
+        if (pipeline->consume(&cur, have_prev ? &prev : NULL,
+                              pipeline->ctx) != 0)
+        {
+            atomic_store(&pipeline->failed, 1);
+            break;
+        }
+
+        prev      = cur;
+        have_prev = 1;
+    }
+
+    report_overruns(pipeline);
+    return NULL;
+}
+
+/*
+ * ============================================================================
+ * Pipeline Functions
+ * ============================================================================
+ */
+
+int pipeline_start(pipeline_t *pipeline, const options_t *opts,
+                   pipeline_consume_t consume, void *ctx)
+{
+    sigset_t all;
+    sigset_t saved;
+
+    memset(pipeline, 0, sizeof(pipeline_t));
+    pipeline->consume = consume;
+    pipeline->ctx     = ctx;
+
+    int count = opts->sink_count > 0 ? opts->sink_count : 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        const char *spec = opts->sink_count > 0 ? opts->sinks[i] : "-";
+
+        if (open_sink(&pipeline->sinks[i], spec) != 0)
+        {
+            close_sinks(pipeline);
+            return -1;
+        }
+        pipeline->sink_count++;
+    }
+    pipeline->sink_live = pipeline->sink_count;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (pthread_mutex_init(&pipeline->lock, NULL) != 0 ||
+        pthread_cond_init(&pipeline->wake, NULL) != 0)
+    {
+        fprintf(stderr, "Error: Cannot initialize the output pipeline\n");
+        close_sinks(pipeline);
+        return -1;
+    }
+
+    /*
+     * The writer inherits a fully blocked signal mask, so SIGINT and
+     * SIGTERM always interrupt the sampler's sleep instead.
+     */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    int err = pthread_create(&pipeline->thread, NULL, writer_main, pipeline);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (err != 0)
+    {
+        fprintf(stderr, "Error: Cannot start the output thread: %s\n",
+                strerror(err));
+        pthread_cond_destroy(&pipeline->wake);
+        pthread_mutex_destroy(&pipeline->lock);
+        close_sinks(pipeline);
+        return -1;
+    }
+
+    return 0;
+}
+
+int pipeline_push(pipeline_t *pipeline, const system_memory_t *sys_mem)
+{
+    uint64_t head = atomic_load_explicit(&pipeline->head,
+                                         memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&pipeline->tail,
+                                         memory_order_acquire);
+
+    pipeline->pushed++;
+
+    if (head - tail >= PIPELINE_RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&pipeline->overruns, 1,
+                                  memory_order_relaxed);
+        return -1;
+    }
+
+    pipeline->ring[head & (PIPELINE_RING_SIZE - 1)] = *sys_mem;
+    atomic_store_explicit(&pipeline->head, head + 1, memory_order_release);
+
+    /* Only wakes an idle writer; never waits on one that is writing */
+    pthread_mutex_lock(&pipeline->lock);
+    pthread_cond_signal(&pipeline->wake);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    return 0;
+}
+
+int pipeline_failed(pipeline_t *pipeline)
+{
+    return atomic_load(&pipeline->failed);
+}
+
+void pipeline_stop(pipeline_t *pipeline)
+{
+    pthread_mutex_lock(&pipeline->lock);
+    atomic_store(&pipeline->done, 1);
+    pthread_cond_signal(&pipeline->wake);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    pthread_join(pipeline->thread, NULL);
+
+    pthread_cond_destroy(&pipeline->wake);
+    pthread_mutex_destroy(&pipeline->lock);
+}
+
+void pipeline_close(pipeline_t *pipeline)
+{
+    uint64_t overruns = atomic_load(&pipeline->overruns);
+
+    for (size_t i = 0; i < pipeline->sink_count; i++)
+    {
+        pipeline_sink_t *sink = &pipeline->sinks[i];
+
+        if (sink->fd >= 0)
+        {
+            drain_sink(sink);
+        }
+        if (sink->dropped > 0)
+        {
+            fprintf(stderr, "Warning: %llu frame(s) dropped for %s\n",
+                    (unsigned long long)sink->dropped, sink->spec);
+        }
+    }
+
+    close_sinks(pipeline);
+
+    if (overruns > 0)
+    {
+        fprintf(stderr, "Warning: %llu of %llu sample(s) dropped in total\n",
+                (unsigned long long)overruns,
+                (unsigned long long)pipeline->pushed);
+    }
+}
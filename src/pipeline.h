@@ -0,0 +1,168 @@
+/*
+ * pipeline.h - Sampler/writer pipeline decoupling output from sampling
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "frame.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/* Samples buffered between the threads; must be a power of two */
+#define PIPELINE_RING_SIZE 256
+
+/* Output held per sink while its reader is slow: at least two frames */
+#define PIPELINE_BACKLOG_SIZE (2 * FRAME_BUF_SIZE)
+
+/* How long closing waits for a sink to take its backlog */
+#define PIPELINE_DRAIN_MS 500
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Called on the writer thread for each sample taken off the ring. prev
+ * is the sample consumed before cur, or NULL for the first one. Return
+ * non-zero to stop the pipeline.
+ */
+typedef int (*pipeline_consume_t)(const system_memory_t *cur,
+                                  const system_memory_t *prev, void *ctx);
+
+/*
+ * One output destination
+ *
+ * Pipes and sockets are written without blocking. What the reader does
+ * not take at once waits in the backlog; a frame that does not fit is
+ * dropped whole for this sink only, so one stalled reader never holds
+ * up the others.
+ */
+typedef struct
+{
+    const char *spec;                           /* As given to --sink */
+    int         fd;                             /* Descriptor, -1 if failed */
+    int         owned;                          /* Close fd on close */
+    int         flags;                          /* File flags to restore */
+    int         lagging;                        /* Dropping frames now */
+    uint64_t    dropped;                        /* Frames dropped */
+    size_t      pending;                        /* Bytes in backlog */
+    char        backlog[PIPELINE_BACKLOG_SIZE]; /* Not yet written */
+} pipeline_sink_t;
+
+/*
+ * Pipeline
+ *
+ * The sampler thread pushes samples into a single-producer,
+ * single-consumer ring; the writer thread pops them, renders them and
+ * writes them to every sink. Head and tail are only ever written by one
+ * side each, so neither side waits for the other on the ring itself. When
+ * the ring is full the newest sample is dropped and counted as an
+ * overrun: sampling keeps its schedule however slow the output is. The
+ * mutex and condition variable only put an idle writer to sleep.
+ */
+typedef struct
+{
+    system_memory_t    ring[PIPELINE_RING_SIZE]; /* Buffered samples */
+    _Atomic uint64_t   head;                     /* Samples pushed (producer) */
+    _Atomic uint64_t   tail;                     /* Samples popped (consumer) */
+    _Atomic uint64_t   overruns;                 /* Dropped on a full ring */
+    _Atomic int        done;                     /* Producer finished, drain */
+    _Atomic int        failed;                   /* Writer gave up, stop */
+    uint64_t           pushed;                   /* Samples offered */
+    uint64_t           reported;                 /* Overruns warned about */
+    pthread_mutex_t    lock;                     /* Guards sleep and wake */
+    pthread_cond_t     wake;                     /* Signalled after each push */
+    pthread_t          thread;                   /* Writer thread */
+    pipeline_consume_t consume;                  /* Per-sample callback */
+    void              *ctx;                      /* Passed to consume */
+    pipeline_sink_t    sinks[MAX_SINKS];         /* Output destinations */
+    size_t             sink_count;               /* Entries in sinks */
+    size_t             sink_live;                /* Sinks not yet failed */
+} pipeline_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Open the sinks and start the writer thread
+ *
+ * Sinks come from opts->sinks: "-" is standard output, "unix:PATH" a
+ * Unix stream socket to connect to, anything else a file to append to.
+ * Without any, standard output is used. SIGPIPE is ignored so a reader
+ * going away surfaces as a write error on that sink alone.
+ *
+ * @param pipeline  Pipeline to start
+ * @param opts      Options (sinks, sink_count)
+ * @param consume   Callback run on the writer thread for each sample
+ * @param ctx       Passed to consume
+ * @return          0 on success, -1 on error
+ */
+int pipeline_start(pipeline_t *pipeline, const options_t *opts,
+                   pipeline_consume_t consume, void *ctx);
+
+/**
+ * Hand a sample to the writer thread without blocking
+ *
+ * @param pipeline  Running pipeline
+ * @param sys_mem   Sample to push (copied)
+ * @return          0 if queued, -1 if the ring was full and it was dropped
+ */
+int pipeline_push(pipeline_t *pipeline, const system_memory_t *sys_mem);
+
+/**
+ * Write a frame to every live sink
+ *
+ * Never blocks on a pipe or socket: a sink whose reader is behind gets
+ * the frame queued, or dropped once its backlog is full. A sink that
+ * fails is reported and closed; the others keep going. Once none are
+ * left the pipeline is marked failed.
+ *
+ * @param pipeline  Pipeline whose sinks to write to
+ * @param frame     Frame to write
+ * @return          0 if at least one sink remains, -1 otherwise
+ */
+int pipeline_write(pipeline_t *pipeline, const frame_t *frame);
+
+/**
+ * Check whether the writer has given up
+ *
+ * @param pipeline  Running pipeline
+ * @return          Non-zero if the producer should stop
+ */
+int pipeline_failed(pipeline_t *pipeline);
+
+/**
+ * Let the writer drain the ring, then wait for it to exit
+ *
+ * @param pipeline  Running pipeline
+ */
+void pipeline_stop(pipeline_t *pipeline);
+
+/**
+ * Give each sink a moment to take its backlog, close the sinks and
+ * report overruns and dropped frames on stderr
+ *
+ * @param pipeline  Stopped pipeline
+ */
+void pipeline_close(pipeline_t *pipeline);
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,98 @@
+/*
+ * procfs.h - Allocation-free readers for Linux /proc and /sys files
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#include "memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Maps a "key value" line to a uint64_t field of a caller's struct */
+typedef struct
+{
+    const char *key;    /* Key as it appears in the file */
+    size_t      len;    /* strlen(key) */
+    size_t      offset; /* offsetof() the destination field */
+} procfs_key_t;
+
+#define PROCFS_KEY(name, type, field)                                          \
+    {name, sizeof(name) - 1, offsetof(type, field)}
+
+/* Bit procfs_parse() sets when keys[index] was found */
+#define PROCFS_FOUND(index) (1ULL << (index))
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Read a whole procfs/sysfs file through a persistent descriptor
+ *
+ * Uses pread() from offset 0, so the descriptor can be kept open and
+ * re-read on every sample without lseek() or reopening.
+ *
+ * @param fd    Open file descriptor
+ * @param buf   Buffer; the content is NUL-terminated
+ * @param size  Size of buf
+ * @return      Bytes read, or -1 on error
+ */
+ssize_t procfs_read(int fd, char *buf, size_t size);
+
+/**
+ * Parse "Key: value [kB]" or "key value" lines into a struct
+ *
+ * Values followed by "kB" are converted to bytes. A "Node <n> " prefix
+ * (node<n>/meminfo) is skipped. Unknown keys are skipped; fields for
+ * missing keys are left untouched.
+ *
+ * @param buf   File content
+ * @param len   Length of buf
+ * @param keys  Key table (at most 64 entries)
+ * @param nkeys Number of entries in keys
+ * @param out   Struct the key offsets refer to
+ * @return      Bitmask of the keys that were found, PROCFS_FOUND(i) for
+ *              keys[i]
+ */
+uint64_t procfs_parse(const char *buf, size_t len, const procfs_key_t *keys,
+                      size_t nkeys, void *out);
+
+/**
+ * Parse a decimal number
+ *
+ * @param p     Start of the digits (leading blanks are skipped)
+ * @param end   End of the buffer
+ * @param value Parsed value
+ * @return      Pointer just past the last digit
+ */
+const char *procfs_parse_uint(const char *p, const char *end, uint64_t *value);
+
+/**
+ * Parse pressure stall information (/proc/pressure/memory or a cgroup's
+ * memory.pressure)
+ *
+ * Reads the avg10, avg60 and total fields of the "some" and "full"
+ * lines; the "full" line is absent on some kernels and left zero.
+ *
+ * @param buf       File content
+ * @param len       Length of buf
+ * @param pressure  Filled in; level is left untouched
+ * @return          0 on success, -1 if there was no "some" line
+ */
+int procfs_parse_psi(const char *buf, size_t len, pressure_info_t *pressure);
+
+#endif /* PROCFS_H */
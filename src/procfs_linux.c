@@ -0,0 +1,214 @@
+/*
+ * procfs_linux.c - Allocation-free readers for Linux /proc and /sys files
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "procfs.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Reading
+ * ============================================================================
+ */
+
+ssize_t procfs_read(int fd, char *buf, size_t size)
+{
+    size_t total = 0;
+
+    if (size == 0)
+    {
+        return -1;
+    }
+
+    while (total < size - 1)
+    {
+        ssize_t n = pread(fd, buf + total, size - 1 - total, (off_t)total);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        total += (size_t)n;
+    }
+
+    buf[total] = '\0';
+    return (ssize_t)total;
+}
+
+/*
+ * ============================================================================
+ * Parsing
+ * ============================================================================
+ */
+
+const char *procfs_parse_uint(const char *p, const char *end, uint64_t *value)
+{
+    uint64_t v = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        v = v * 10 + (uint64_t)(*p - '0');
+        p++;
+    }
+
+    *value = v;
+    return p;
+}
+
+uint64_t procfs_parse(const char *buf, size_t len, const procfs_key_t *keys,
+                      size_t nkeys, void *out)
+{
+    const char *p     = buf;
+    const char *end   = buf + len;
+    uint64_t    found = 0;
+
+    while (p < end)
+    {
+        /* Per-node meminfo starts every line with "Node <n> " */
+        if (end - p > 5 && memcmp(p, "Node ", 5) == 0)
+        {
+            for (p += 5; p < end && *p >= '0' && *p <= '9'; p++)
+            {
+            }
+            while (p < end && *p == ' ')
+            {
+                p++;
+            }
+        }
+
+        /* The key ends at ':' (meminfo style) or ' ' (vmstat style) */
+        const char *k = p;
+        while (p < end && *p != ':' && *p != ' ' && *p != '\n')
+        {
+            p++;
+        }
+
+        size_t key_len = (size_t)(p - k);
+
+        if (p < end && *p == ':')
+        {
+            p++;
+        }
+
+        uint64_t value;
+        p = procfs_parse_uint(p, end, &value);
+
+        if (p + 3 <= end && p[0] == ' ' && p[1] == 'k' && p[2] == 'B')
+        {
+            value *= 1024;
+        }
+
+        for (size_t i = 0; i < nkeys; i++)
+        {
+            if (keys[i].len == key_len && memcmp(keys[i].key, k, key_len) == 0)
+            {
+                *(uint64_t *)((char *)out + keys[i].offset) = value;
+                found |= PROCFS_FOUND(i);
+                break;
+            }
+        }
+
+        /* Advance to the next line */
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL)
+        {
+            break;
+        }
+        p = nl + 1;
+    }
+
+    return found;
+}
+
+/* Parse "12.34" as a double; PSI averages always have two decimals */
+static const char *parse_decimal(const char *p, const char *end,
+                                 double *value)
+{
+    uint64_t whole;
+    uint64_t frac  = 0;
+    uint64_t scale = 1;
+
+    p = procfs_parse_uint(p, end, &whole);
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            frac = frac * 10 + (uint64_t)(*p - '0');
+            scale *= 10;
+        }
+    }
+
+    *value = (double)whole + (double)frac / (double)scale;
+    return p;
+}
+
+int procfs_parse_psi(const char *buf, size_t len, pressure_info_t *pressure)
+{
+    const char *p    = buf;
+    const char *end  = buf + len;
+    int         some = 0;
+
+    while (p < end)
+    {
+        const char *nl  = memchr(p, '\n', (size_t)(end - p));
+        const char *eol = nl != NULL ? nl : end;
+        int         full;
+
+        /* "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" */
+        if (eol - p > 5 && memcmp(p, "some ", 5) == 0)
+        {
+            full = 0;
+            some = 1;
+        }
+        else if (eol - p > 5 && memcmp(p, "full ", 5) == 0)
+        {
+            full = 1;
+        }
+        else
+        {
+            p = eol + 1;
+            continue;
+        }
+
+        for (p += 5; p < eol; p++)
+        {
+            if (eol - p > 6 && memcmp(p, "avg10=", 6) == 0)
+            {
+                p = parse_decimal(p + 6, eol, full ? &pressure->full_avg10
+                                                   : &pressure->some_avg10);
+            }
+            else if (eol - p > 6 && memcmp(p, "avg60=", 6) == 0)
+            {
+                p = parse_decimal(p + 6, eol, full ? &pressure->full_avg60
+                                                   : &pressure->some_avg60);
+            }
+            else if (eol - p > 6 && memcmp(p, "total=", 6) == 0)
+            {
+                p = procfs_parse_uint(p + 6, eol, full ? &pressure->full_total
+                                                       : &pressure->some_total);
+            }
+        }
+
+        p = eol + 1;
+    }
+
+    return some ? 0 : -1;
+}
@@ -0,0 +1,505 @@
+/*
+ * procs.c - Per-process memory usage and the largest consumers
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "procs.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Ranking
+ * ============================================================================
+ */
+
+uint64_t proc_footprint(const proc_entry_t *entry)
+{
+    return entry->rss + entry->swap + entry->compressed;
+}
+
+/* Strict ordering: larger footprint first, ties broken by identity */
+static int entry_before(const proc_entry_t *a, const proc_entry_t *b)
+{
+    uint64_t fa = proc_footprint(a);
+    uint64_t fb = proc_footprint(b);
+
+    if (fa != fb)
+    {
+        return fa > fb;
+    }
+    if (a->pid != b->pid)
+    {
+        return a->pid < b->pid;
+    }
+    if (a->uid != b->uid)
+    {
+        return a->uid < b->uid;
+    }
+    return strcmp(a->name, b->name) < 0;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    const proc_entry_t *ea = a;
+    const proc_entry_t *eb = b;
+
+    return entry_before(ea, eb) ? -1 : entry_before(eb, ea) ? 1 : 0;
+}
+
+static void swap_entries(proc_entry_t *a, proc_entry_t *b)
+{
+    proc_entry_t tmp = *a;
+    *a               = *b;
+    *b               = tmp;
+}
+
+/*
+ * Offer an entry to a heap that keeps the limit largest. The root is the
+ * smallest kept entry, so most processes are rejected with one compare.
+ */
+static void heap_offer(proc_entry_t *heap, size_t *len, size_t limit,
+                       const proc_entry_t *entry)
+{
+    size_t i;
+
+    if (*len < limit)
+    {
+        /* Sift up */
+        i       = (*len)++;
+        heap[i] = *entry;
+        while (i > 0 && entry_before(&heap[(i - 1) / 2], &heap[i]))
+        {
+            swap_entries(&heap[(i - 1) / 2], &heap[i]);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+
+    if (!entry_before(entry, &heap[0]))
+    {
+        return;
+    }
+
+    /* Replace the root and sift down */
+    heap[0] = *entry;
+    i       = 0;
+    for (;;)
+    {
+        size_t smallest = i;
+        size_t left     = 2 * i + 1;
+        size_t right    = left + 1;
+
+        if (left < *len && entry_before(&heap[smallest], &heap[left]))
+        {
+            smallest = left;
+        }
+        if (right < *len && entry_before(&heap[smallest], &heap[right]))
+        {
+            smallest = right;
+        }
+        if (smallest == i)
+        {
+            break;
+        }
+        swap_entries(&heap[i], &heap[smallest]);
+        i = smallest;
+    }
+}
+
+/*
+ * ============================================================================
+ * Grouping
+ * ============================================================================
+ */
+
+/* Open-addressing table of group sums; a slot with count 0 is empty */
+typedef struct
+{
+    proc_entry_t *slots; /* Power-of-two sized */
+    size_t        mask;  /* Slots - 1 */
+    size_t        used;  /* Occupied slots */
+} group_table_t;
+
+static int table_init(group_table_t *table, size_t entries)
+{
+    size_t size = 16;
+
+    /* Keep the load factor at or below one half */
+    while (size < 2 * entries)
+    {
+        size *= 2;
+    }
+
+    table->slots = calloc(size, sizeof(proc_entry_t));
+    table->mask  = size - 1;
+    table->used  = 0;
+
+    return table->slots != NULL ? 0 : -1;
+}
+
+static uint64_t group_hash(const proc_entry_t *entry, group_by_t group_by)
+{
+    if (group_by == GROUP_UID)
+    {
+        return (uint64_t)entry->uid * 0x9E3779B97F4A7C15ULL;
+    }
+
+    /* FNV-1a */
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const char *p = entry->name; *p != '\0'; p++)
+    {
+        hash = (hash ^ (unsigned char)*p) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static int group_equal(const proc_entry_t *a, const proc_entry_t *b,
+                       group_by_t group_by)
+{
+    return group_by == GROUP_UID ? a->uid == b->uid
+                                 : strcmp(a->name, b->name) == 0;
+}
+
+/* Add an entry's usage to its group; the table never fills up */
+static void table_add(group_table_t *table, const proc_entry_t *entry,
+                      group_by_t group_by)
+{
+    size_t i = (size_t)group_hash(entry, group_by) & table->mask;
+
+    while (table->slots[i].count > 0 &&
+           !group_equal(&table->slots[i], entry, group_by))
+    {
+        i = (i + 1) & table->mask;
+    }
+
+    proc_entry_t *slot = &table->slots[i];
+    if (slot->count == 0)
+    {
+        *slot     = *entry;
+        slot->pid = 0;
+        table->used++;
+        return;
+    }
+
+    slot->rss += entry->rss;
+    slot->swap += entry->swap;
+    slot->compressed += entry->compressed;
+    slot->count += entry->count;
+}
+
+/*
+ * ============================================================================
+ * Parallel Scan
+ * ============================================================================
+ */
+
+typedef struct
+{
+    const procs_t *procs;    /* Scanner, for the pid list and settings */
+    size_t         begin;    /* First pid index to read */
+    size_t         end;      /* One past the last */
+    proc_entry_t  *heap;     /* Top entries (ungrouped), procs->limit */
+    size_t         heap_len; /* Entries in heap */
+    group_table_t  table;    /* Group sums (grouped) */
+    uint64_t       read;     /* Processes read successfully */
+    pthread_t      thread;   /* Worker thread (all but the first) */
+} worker_t;
+
+static void *worker_main(void *arg)
+{
+    worker_t      *worker = arg;
+    const procs_t *procs  = worker->procs;
+    proc_entry_t   entry;
+
+    for (size_t i = worker->begin; i < worker->end; i++)
+    {
+        if (procs_read(procs->pids[i], &entry) != 0)
+        {
+            continue;
+        }
+
+        /* Kernel threads and zombies hold no memory of their own */
+        if (proc_footprint(&entry) == 0)
+        {
+            continue;
+        }
+
+        worker->read++;
+
+        if (procs->group_by == GROUP_NONE)
+        {
+            heap_offer(worker->heap, &worker->heap_len, procs->limit,
+                       &entry);
+        }
+        else
+        {
+            table_add(&worker->table, &entry, procs->group_by);
+        }
+    }
+
+    return NULL;
+}
+
+/* Enough workers to keep each busy, no more than there are cores */
+static size_t worker_count(size_t pids)
+{
+    long   cores   = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = (pids + PROCS_PER_WORKER - 1) / PROCS_PER_WORKER;
+
+    if (cores > 0 && workers > (size_t)cores)
+    {
+        workers = (size_t)cores;
+    }
+    if (workers > PROCS_MAX_WORKERS)
+    {
+        workers = PROCS_MAX_WORKERS;
+    }
+
+    return workers > 0 ? workers : 1;
+}
+
+/* Fill procs->pids, growing it until the whole table fits */
+static int list_pids(procs_t *procs)
+{
+    for (;;)
+    {
+        ssize_t n = procs_list(procs->pids, procs->pid_cap);
+        if (n < 0)
+        {
+            return -1;
+        }
+
+        if ((size_t)n <= procs->pid_cap)
+        {
+            procs->pid_count = (size_t)n;
+            return 0;
+        }
+
+        /* Headroom for processes started while we resize */
+        size_t cap  = (size_t)n + (size_t)n / 4 + 64;
+        pid_t *pids = realloc(procs->pids, cap * sizeof(pid_t));
+        if (pids == NULL)
+        {
+            perror("realloc");
+            return -1;
+        }
+        procs->pids    = pids;
+        procs->pid_cap = cap;
+    }
+}
+
+/* Combine the workers' results into procs->top */
+static int merge_workers(procs_t *procs, worker_t *workers, size_t count)
+{
+    procs->top_len = 0;
+
+    if (procs->group_by == GROUP_NONE)
+    {
+        for (size_t w = 0; w < count; w++)
+        {
+            for (size_t i = 0; i < workers[w].heap_len; i++)
+            {
+                heap_offer(procs->top, &procs->top_len, procs->limit,
+                           &workers[w].heap[i]);
+            }
+        }
+    }
+    else
+    {
+        group_table_t merged;
+        size_t        groups = 0;
+
+        for (size_t w = 0; w < count; w++)
+        {
+            groups += workers[w].table.used;
+        }
+
+        if (table_init(&merged, groups) != 0)
+        {
+            perror("calloc");
+            return -1;
+        }
+
+        for (size_t w = 0; w < count; w++)
+        {
+            const group_table_t *table = &workers[w].table;
+
+            for (size_t i = 0; i <= table->mask; i++)
+            {
+                if (table->slots[i].count > 0)
+                {
+                    table_add(&merged, &table->slots[i], procs->group_by);
+                }
+            }
+        }
+
+        for (size_t i = 0; i <= merged.mask; i++)
+        {
+            if (merged.slots[i].count > 0)
+            {
+                heap_offer(procs->top, &procs->top_len, procs->limit,
+                           &merged.slots[i]);
+            }
+        }
+
+        free(merged.slots);
+    }
+
+    qsort(procs->top, procs->top_len, sizeof(proc_entry_t), compare_entries);
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Scanner Functions
+ * ============================================================================
+ */
+
+int parse_group_by(const char *name, group_by_t *group_by)
+{
+    if (strcmp(name, "uid") == 0 || strcmp(name, "user") == 0)
+    {
+        *group_by = GROUP_UID;
+        return 0;
+    }
+    if (strcmp(name, "command") == 0 || strcmp(name, "comm") == 0)
+    {
+        *group_by = GROUP_COMMAND;
+        return 0;
+    }
+
+    return -1;
+}
+
+int procs_init(procs_t *procs, size_t limit, group_by_t group_by)
+{
+    memset(procs, 0, sizeof(procs_t));
+
+    if (limit == 0 || limit > PROCS_MAX_TOP)
+    {
+        fprintf(stderr, "Error: --top must be between 1 and %d\n",
+                PROCS_MAX_TOP);
+        return -1;
+    }
+
+    procs->limit    = limit;
+    procs->group_by = group_by;
+    procs->top      = calloc(limit, sizeof(proc_entry_t));
+    if (procs->top == NULL)
+    {
+        perror("calloc");
+        return -1;
+    }
+
+    return 0;
+}
+
+int procs_scan(procs_t *procs)
+{
+    worker_t      workers[PROCS_MAX_WORKERS];
+    proc_entry_t *heaps  = NULL;
+    int           status = 0;
+
+    if (list_pids(procs) != 0)
+    {
+        return -1;
+    }
+
+    size_t count = worker_count(procs->pid_count);
+    size_t chunk = (procs->pid_count + count - 1) / count;
+
+    memset(workers, 0, sizeof(workers));
+
+    if (procs->group_by == GROUP_NONE)
+    {
+        heaps = calloc(count * procs->limit, sizeof(proc_entry_t));
+        if (heaps == NULL)
+        {
+            perror("calloc");
+            return -1;
+        }
+    }
+
+    for (size_t w = 0; w < count; w++)
+    {
+        worker_t *worker = &workers[w];
+
+        worker->procs = procs;
+        worker->begin = w * chunk < procs->pid_count ? w * chunk
+                                                     : procs->pid_count;
+        worker->end   = worker->begin + chunk < procs->pid_count
+                            ? worker->begin + chunk
+                            : procs->pid_count;
+
+        if (heaps != NULL)
+        {
+            worker->heap = heaps + w * procs->limit;
+        }
+        else if (table_init(&worker->table, worker->end - worker->begin) != 0)
+        {
+            perror("calloc");
+            count  = w;
+            status = -1;
+            break;
+        }
+    }
+
+    /* Worker 0 runs on this thread; start the others first */
+    size_t started = 1;
+    for (; status == 0 && started < count; started++)
+    {
+        if (pthread_create(&workers[started].thread, NULL, worker_main,
+                           &workers[started]) != 0)
+        {
+            /* Fewer threads: this one reads the rest afterwards */
+            break;
+        }
+    }
+
+    if (status == 0)
+    {
+        worker_main(&workers[0]);
+
+        for (size_t w = started; w < count; w++)
+        {
+            worker_main(&workers[w]);
+        }
+    }
+
+    for (size_t w = 1; w < started && w < count; w++)
+    {
+        pthread_join(workers[w].thread, NULL);
+    }
+
+    if (status == 0)
+    {
+        procs->processes = 0;
+        for (size_t w = 0; w < count; w++)
+        {
+            procs->processes += workers[w].read;
+        }
+        status = merge_workers(procs, workers, count);
+    }
+
+    for (size_t w = 0; w < count; w++)
+    {
+        free(workers[w].table.slots);
+    }
+    free(heaps);
+
+    return status;
+}
+
+void procs_cleanup(procs_t *procs)
+{
+    free(procs->pids);
+    free(procs->top);
+    memset(procs, 0, sizeof(procs_t));
+}
@@ -0,0 +1,192 @@
+/*
+ * procs.h - Per-process memory usage and the largest consumers
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef PROCS_H
+#define PROCS_H
+
+#include "utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define PROCS_NAME_LEN    32   /* Command name, including NUL */
+#define PROCS_MAX_TOP     100  /* Largest --top accepted */
+#define PROCS_MAX_WORKERS 16   /* Threads used for one scan */
+#define PROCS_PER_WORKER  1024 /* Processes per worker before adding more */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Memory held by one process, or by a group of them */
+typedef struct
+{
+    pid_t    pid;                  /* Process ID (ungrouped only) */
+    uid_t    uid;                  /* Real user ID */
+    char     name[PROCS_NAME_LEN]; /* Command name */
+    uint64_t rss;                  /* Resident, bytes */
+    uint64_t swap;                 /* Swapped out, bytes */
+    uint64_t compressed;           /* Held in the compressor, bytes */
+    uint64_t count;                /* Processes summed into this entry */
+} proc_entry_t;
+
+/* Memory of one watched process */
+typedef struct
+{
+    uint64_t rss;        /* Resident, bytes */
+    uint64_t swap;       /* Swapped out, bytes */
+    uint64_t compressed; /* Held in the compressor, bytes */
+    uint64_t pss;        /* Proportional set size, bytes */
+    int      has_pss;    /* pss is known (Linux, own processes or root) */
+} proc_usage_t;
+
+/*
+ * A process read repeatedly. On Linux the /proc file stays open between
+ * samples; it keeps referring to the same process even after its PID is
+ * reused, and reading it is a single pread().
+ */
+typedef struct
+{
+    pid_t pid;                  /* Process ID */
+    char  name[PROCS_NAME_LEN]; /* Command name at open time */
+    int   fd;                   /* Open /proc file (Linux), or -1 */
+    int   rollup;               /* fd is smaps_rollup rather than status */
+} proc_handle_t;
+
+/*
+ * Process table scanner
+ *
+ * Lists every process, then splits the list between up to
+ * PROCS_MAX_WORKERS threads. Each worker keeps only its own top entries
+ * in a bounded heap (or, when grouping, its own group sums), so the
+ * merge at the end touches a few hundred entries however many processes
+ * there are. The process list is kept between scans.
+ */
+typedef struct
+{
+    size_t        limit;     /* Entries to keep */
+    group_by_t    group_by;  /* How processes are combined */
+    pid_t        *pids;      /* Process list of the latest scan */
+    size_t        pid_cap;   /* Capacity of pids */
+    size_t        pid_count; /* Entries in pids */
+    proc_entry_t *top;       /* Largest entries, largest first */
+    size_t        top_len;   /* Entries in top */
+    uint64_t      processes; /* Processes read in the latest scan */
+} procs_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Parse a --group-by name ("uid" or "command")
+ *
+ * @param name      Name from the command line
+ * @param group_by  Parsed grouping
+ * @return          0 on success, -1 if the name is unknown
+ */
+int parse_group_by(const char *name, group_by_t *group_by);
+
+/**
+ * Prepare a scanner
+ *
+ * @param procs     Scanner to initialize
+ * @param limit     Entries to keep, 1 - PROCS_MAX_TOP
+ * @param group_by  How processes are combined
+ * @return          0 on success, -1 on error
+ */
+int procs_init(procs_t *procs, size_t limit, group_by_t group_by);
+
+/**
+ * Scan the process table and keep the largest entries
+ *
+ * Entries are ranked by footprint: resident plus swapped plus
+ * compressed. Processes that exit during the scan, or that may not be
+ * inspected, are skipped.
+ *
+ * @param procs     Initialized scanner
+ * @return          0 on success, -1 on error
+ */
+int procs_scan(procs_t *procs);
+
+/**
+ * Release a scanner's buffers
+ *
+ * @param procs     Scanner to clean up
+ */
+void procs_cleanup(procs_t *procs);
+
+/**
+ * Footprint used for ranking
+ *
+ * @param entry     Process or group
+ * @return          rss + swap + compressed, bytes
+ */
+uint64_t proc_footprint(const proc_entry_t *entry);
+
+/*
+ * ============================================================================
+ * Platform Interface (procs_linux.c / procs_darwin.c)
+ * ============================================================================
+ */
+
+/**
+ * List the process IDs on the system
+ *
+ * @param pids      Buffer for the IDs
+ * @param cap       Capacity of pids
+ * @return          Number of processes, which may exceed cap (only cap
+ *                  were stored; call again with a larger buffer), or -1
+ */
+ssize_t procs_list(pid_t *pids, size_t cap);
+
+/**
+ * Read one process's memory usage; safe to call from several threads
+ *
+ * @param pid       Process to read
+ * @param entry     Filled in with count = 1
+ * @return          0 on success, -1 if it is gone or not accessible
+ */
+int procs_read(pid_t pid, proc_entry_t *entry);
+
+/**
+ * Start watching one process
+ *
+ * @param handle    Handle to initialize
+ * @param pid       Process to watch
+ * @return          0 on success, -1 if it does not exist or is not ours
+ */
+int proc_open(proc_handle_t *handle, pid_t pid);
+
+/**
+ * Read a watched process's current memory usage
+ *
+ * @param handle    Open handle
+ * @param usage     Filled in on success
+ * @return          0 on success, -1 once the process has exited
+ */
+int proc_sample(proc_handle_t *handle, proc_usage_t *usage);
+
+/**
+ * Stop watching a process
+ *
+ * @param handle    Handle to close
+ */
+void proc_close(proc_handle_t *handle);
+
+#endif /* PROCS_H */
@@ -0,0 +1,247 @@
+/*
+ * procs_linux.c - Per-process memory usage from /proc on Linux
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "procs.h"
+
+#include "procfs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Process List
+ * ============================================================================
+ */
+
+ssize_t procs_list(pid_t *pids, size_t cap)
+{
+    DIR *dir = opendir("/proc");
+    if (dir == NULL)
+    {
+        perror("/proc");
+        return -1;
+    }
+
+    size_t         count = 0;
+    struct dirent *ent;
+
+    while ((ent = readdir(dir)) != NULL)
+    {
+        /* Process directories are the all-digit names */
+        const char *p   = ent->d_name;
+        pid_t       pid = 0;
+
+        while (*p >= '0' && *p <= '9')
+        {
+            pid = pid * 10 + (*p - '0');
+            p++;
+        }
+        if (*p != '\0' || p == ent->d_name)
+        {
+            continue;
+        }
+
+        if (count < cap)
+        {
+            pids[count] = pid;
+        }
+        count++;
+    }
+
+    closedir(dir);
+    return (ssize_t)count;
+}
+
+/*
+ * ============================================================================
+ * Process Usage
+ * ============================================================================
+ */
+
+typedef struct
+{
+    uint64_t uid;     /* Real user ID, first of the Uid: line */
+    uint64_t vm_rss;  /* VmRSS, bytes */
+    uint64_t vm_swap; /* VmSwap, bytes */
+} status_t;
+
+static const procfs_key_t status_keys[] = {
+    PROCFS_KEY("Uid", status_t, uid),
+    PROCFS_KEY("VmRSS", status_t, vm_rss),
+    PROCFS_KEY("VmSwap", status_t, vm_swap),
+};
+
+/*
+ * status has the name, owner, resident and swapped sizes in one file, so
+ * a process costs a single open/read/close. statm would save the kernel
+ * some formatting but has neither swap nor the owner. The fields we need
+ * all sit in the first page, so one read() is enough.
+ */
+int procs_read(pid_t pid, proc_entry_t *entry)
+{
+    char     path[32];
+    char     buf[4096];
+    status_t status = {0, 0, 0};
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+    {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    procfs_parse(buf, (size_t)len, status_keys,
+                 sizeof(status_keys) / sizeof(status_keys[0]), &status);
+
+    memset(entry, 0, sizeof(proc_entry_t));
+    entry->pid   = pid;
+    entry->uid   = (uid_t)status.uid;
+    entry->rss   = status.vm_rss;
+    entry->swap  = status.vm_swap;
+    entry->count = 1;
+
+    /* The first line is "Name:\t<comm>" */
+    if (strncmp(buf, "Name:\t", 6) == 0)
+    {
+        const char *name = buf + 6;
+        size_t      n    = strcspn(name, "\n");
+
+        if (n >= sizeof(entry->name))
+        {
+            n = sizeof(entry->name) - 1;
+        }
+        memcpy(entry->name, name, n);
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Watched Processes
+ * ============================================================================
+ */
+
+/* Positions in rollup_keys, for the bits procfs_parse() returns */
+enum
+{
+    ROLLUP_RSS,
+    ROLLUP_PSS,
+    ROLLUP_SWAP,
+    ROLLUP_NKEYS
+};
+
+static const procfs_key_t rollup_keys[ROLLUP_NKEYS] = {
+    [ROLLUP_RSS]  = PROCFS_KEY("Rss", proc_usage_t, rss),
+    [ROLLUP_PSS]  = PROCFS_KEY("Pss", proc_usage_t, pss),
+    [ROLLUP_SWAP] = PROCFS_KEY("Swap", proc_usage_t, swap),
+};
+
+/* Positions in usage_status_keys */
+enum
+{
+    USAGE_VM_RSS,
+    USAGE_VM_SWAP,
+    USAGE_NKEYS
+};
+
+static const procfs_key_t usage_status_keys[USAGE_NKEYS] = {
+    [USAGE_VM_RSS]  = PROCFS_KEY("VmRSS", proc_usage_t, rss),
+    [USAGE_VM_SWAP] = PROCFS_KEY("VmSwap", proc_usage_t, swap),
+};
+
+int proc_open(proc_handle_t *handle, pid_t pid)
+{
+    char path[48];
+
+    memset(handle, 0, sizeof(proc_handle_t));
+    handle->pid = pid;
+    handle->fd  = -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    ssize_t len = read(fd, handle->name, sizeof(handle->name) - 1);
+    close(fd);
+    if (len > 0)
+    {
+        handle->name[strcspn(handle->name, "\n")] = '\0';
+    }
+
+    /*
+     * smaps_rollup has PSS but needs the same access as ptrace; fall back
+     * to status, which anyone may read, for other users' processes.
+     */
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+    handle->fd     = open(path, O_RDONLY | O_CLOEXEC);
+    handle->rollup = handle->fd >= 0;
+
+    if (handle->fd < 0)
+    {
+        snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+        handle->fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+
+    return handle->fd >= 0 ? 0 : -1;
+}
+
+int proc_sample(proc_handle_t *handle, proc_usage_t *usage)
+{
+    char buf[4096];
+
+    if (handle->fd < 0)
+    {
+        return -1;
+    }
+
+    ssize_t len = procfs_read(handle->fd, buf, sizeof(buf));
+    if (len <= 0)
+    {
+        /* ESRCH: the process we opened is gone */
+        return -1;
+    }
+
+    memset(usage, 0, sizeof(proc_usage_t));
+
+    if (handle->rollup)
+    {
+        uint64_t found = procfs_parse(buf, (size_t)len, rollup_keys,
+                                      ROLLUP_NKEYS, usage);
+        usage->has_pss = (found & PROCFS_FOUND(ROLLUP_PSS)) != 0;
+        return (found & PROCFS_FOUND(ROLLUP_RSS)) ? 0 : -1;
+    }
+
+    /* A zombie's status has no Vm lines */
+    uint64_t found = procfs_parse(buf, (size_t)len, usage_status_keys,
+                                  USAGE_NKEYS, usage);
+    return (found & PROCFS_FOUND(USAGE_VM_RSS)) ? 0 : -1;
+}
+
+void proc_close(proc_handle_t *handle)
+{
+    if (handle->fd >= 0)
+    {
+        close(handle->fd);
+        handle->fd = -1;
+    }
+}
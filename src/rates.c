@@ -0,0 +1,50 @@
+/*
+ * rates.c - Per-second rates implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "rates.h"
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+static double rate(uint64_t prev, uint64_t cur, double seconds)
+{
+    return cur >= prev ? (double)(cur - prev) / seconds : 0.0;
+}
+
+/*
+ * ============================================================================
+ * Rate Functions
+ * ============================================================================
+ */
+
+int compute_rates(const system_memory_t *prev, const system_memory_t *cur,
+                  vm_rates_t *rates)
+{
+    if (cur->timestamp <= prev->timestamp)
+    {
+        return -1;
+    }
+
+    const vm_counters_t *a       = &prev->counters;
+    const vm_counters_t *b       = &cur->counters;
+    double               seconds = (double)(cur->timestamp - prev->timestamp) /
+                     1000000000.0;
+
+    rates->pageins        = rate(a->pageins, b->pageins, seconds);
+    rates->pageouts       = rate(a->pageouts, b->pageouts, seconds);
+    rates->swapins        = rate(a->swapins, b->swapins, seconds);
+    rates->swapouts       = rate(a->swapouts, b->swapouts, seconds);
+    rates->compressions   = rate(a->compressions, b->compressions, seconds);
+    rates->decompressions = rate(a->decompressions, b->decompressions, seconds);
+    rates->faults         = rate(a->faults, b->faults, seconds);
+    rates->purges         = rate(a->purges, b->purges, seconds);
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * rates.h - Per-second rates from cumulative event counters
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef RATES_H
+#define RATES_H
+
+#include "memory.h"
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Events per second between two samples, one field per vm_counters_t */
+typedef struct
+{
+    double pageins;
+    double pageouts;
+    double swapins;
+    double swapouts;
+    double compressions;
+    double decompressions;
+    double faults;
+    double purges;
+} vm_rates_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Compute per-second rates between two samples
+ *
+ * Counters that went backwards (reset or wrapped) yield a rate of 0.
+ *
+ * @param prev  Earlier sample
+ * @param cur   Later sample
+ * @param rates Rates to fill
+ * @return      0 on success, -1 if the samples are not in time order
+ */
+int compute_rates(const system_memory_t *prev, const system_memory_t *cur,
+                  vm_rates_t *rates);
+
+#endif /* RATES_H */
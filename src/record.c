@@ -0,0 +1,376 @@
+/*
+ * record.c - Binary sample recording implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "record.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The on-disk layouts must not pick up padding */
+_Static_assert(sizeof(record_header_t) == 64, "record header is 64 bytes");
+_Static_assert(sizeof(record_sample_t) ==
+                   12 * sizeof(uint64_t) + 17 * sizeof(uint32_t) +
+                       6 * sizeof(uint16_t),
+               "record_sample_t has padding");
+
+/* Largest PSI average stored: 100.00 % */
+#define PERCENT_MAX 10000
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+static size_t file_size_for(uint64_t capacity)
+{
+    return sizeof(record_header_t) + (size_t)capacity * sizeof(record_sample_t);
+}
+
+static uint32_t to_pages(uint64_t bytes, uint64_t page)
+{
+    uint64_t pages = bytes / page;
+    return pages < UINT32_MAX ? (uint32_t)pages : UINT32_MAX;
+}
+
+static uint16_t to_hundredths(double percent)
+{
+    double value = percent * 100.0 + 0.5;
+
+    if (!(value > 0.0))
+    {
+        return 0;
+    }
+    return value < PERCENT_MAX ? (uint16_t)value : PERCENT_MAX;
+}
+
+static void encode_sample(record_sample_t *out, const system_memory_t *in)
+{
+    uint64_t page = in->page_size > 0 ? in->page_size : 1;
+
+    out->timestamp      = in->timestamp;
+    out->walltime       = in->walltime;
+    out->pageins        = in->counters.pageins;
+    out->pageouts       = in->counters.pageouts;
+    out->swapins        = in->counters.swapins;
+    out->swapouts       = in->counters.swapouts;
+    out->compressions   = in->counters.compressions;
+    out->decompressions = in->counters.decompressions;
+    out->faults         = in->counters.faults;
+    out->purges         = in->counters.purges;
+    out->some_total     = in->pressure.some_total;
+    out->full_total     = in->pressure.full_total;
+    out->page_size      = (uint32_t)page;
+    out->mem_total      = to_pages(in->mem.total, page);
+    out->mem_used       = to_pages(in->mem.used, page);
+    out->mem_free       = to_pages(in->mem.free, page);
+    out->mem_active     = to_pages(in->mem.active, page);
+    out->mem_inactive   = to_pages(in->mem.inactive, page);
+    out->mem_wired      = to_pages(in->mem.wired, page);
+    out->mem_compressed = to_pages(in->mem.compressed, page);
+    out->mem_cached     = to_pages(in->mem.cached, page);
+    out->mem_app        = to_pages(in->mem.app_memory, page);
+    out->mem_available  = to_pages(in->mem.available, page);
+    out->mem_shared     = to_pages(in->mem.shared, page);
+    out->mem_buff_cache = to_pages(in->mem.buff_cache, page);
+    out->mem_hugetlb    = to_pages(in->mem.hugetlb, page);
+    out->swap_total     = to_pages(in->swap.total, page);
+    out->swap_used      = to_pages(in->swap.used, page);
+    out->swap_free      = to_pages(in->swap.free, page);
+    out->some_avg10     = to_hundredths(in->pressure.some_avg10);
+    out->some_avg60     = to_hundredths(in->pressure.some_avg60);
+    out->full_avg10     = to_hundredths(in->pressure.full_avg10);
+    out->full_avg60     = to_hundredths(in->pressure.full_avg60);
+    out->level          = (uint16_t)in->pressure.level;
+    out->valid          = in->pressure.valid != 0;
+}
+
+static void decode_sample(system_memory_t *out, const record_sample_t *in)
+{
+    uint64_t page = in->page_size;
+
+    memset(out, 0, sizeof(record_sample_t));
+    out->timestamp               = in->timestamp;
+    out->walltime                = in->walltime;
+    out->counters.pageins        = in->pageins;
+    out->counters.pageouts       = in->pageouts;
+    out->counters.swapins        = in->swapins;
+    out->counters.swapouts       = in->swapouts;
+    out->counters.compressions   = in->compressions;
+    out->counters.decompressions = in->decompressions;
+    out->counters.faults         = in->faults;
+    out->counters.purges         = in->purges;
+    out->pressure.some_total     = in->some_total;
+    out->pressure.full_total     = in->full_total;
+    out->page_size               = (size_t)page;
+    out->mem.total               = in->mem_total * page;
+    out->mem.used                = in->mem_used * page;
+    out->mem.free                = in->mem_free * page;
+    out->mem.active              = in->mem_active * page;
+    out->mem.inactive            = in->mem_inactive * page;
+    out->mem.wired               = in->mem_wired * page;
+    out->mem.compressed          = in->mem_compressed * page;
+    out->mem.cached              = in->mem_cached * page;
+    out->mem.app_memory          = in->mem_app * page;
+    out->mem.available           = in->mem_available * page;
+    out->mem.shared              = in->mem_shared * page;
+    out->mem.buff_cache          = in->mem_buff_cache * page;
+    out->mem.hugetlb             = in->mem_hugetlb * page;
+    out->swap.total              = in->swap_total * page;
+    out->swap.used               = in->swap_used * page;
+    out->swap.free               = in->swap_free * page;
+    out->pressure.some_avg10     = in->some_avg10 / 100.0;
+    out->pressure.some_avg60     = in->some_avg60 / 100.0;
+    out->pressure.full_avg10     = in->full_avg10 / 100.0;
+    out->pressure.full_avg60     = in->full_avg60 / 100.0;
+    out->pressure.level          = in->level;
+    out->pressure.valid          = in->valid;
+}
+
+static int header_valid(const record_header_t *header, size_t file_size,
+                        const char *path)
+{
+    if (memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0)
+    {
+        fprintf(stderr, "Error: %s is not a recording\n", path);
+        return 0;
+    }
+
+    if (header->version != RECORD_VERSION ||
+        header->record_size != sizeof(record_sample_t))
+    {
+        fprintf(stderr,
+                "Error: %s was recorded by an incompatible version "
+                "(format %u, record size %u)\n",
+                path, header->version, header->record_size);
+        return 0;
+    }
+
+    if (header->capacity == 0 ||
+        header->capacity > (SIZE_MAX - sizeof(record_header_t)) /
+                               sizeof(record_sample_t) ||
+        file_size < file_size_for(header->capacity))
+    {
+        fprintf(stderr, "Error: %s is truncated or corrupt\n", path);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int map_file(record_file_t *rec, size_t size, int prot)
+{
+    rec->map = mmap(NULL, size, prot, MAP_SHARED, rec->fd, 0);
+    if (rec->map == MAP_FAILED)
+    {
+        perror("mmap");
+        rec->map = NULL;
+        return -1;
+    }
+
+    rec->map_size = size;
+    rec->header   = (record_header_t *)rec->map;
+    rec->slots =
+        (record_sample_t *)((char *)rec->map + sizeof(record_header_t));
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Ring File Functions
+ * ============================================================================
+ */
+
+int record_open(record_file_t *rec, const char *path, uint64_t capacity)
+{
+    struct stat st;
+
+    memset(rec, 0, sizeof(record_file_t));
+
+    rec->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (rec->fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(rec->fd, &st) != 0)
+    {
+        perror("fstat");
+        record_close(rec);
+        return -1;
+    }
+
+    if (st.st_size == 0)
+    {
+        /* New file: size it up front, the slots stay sparse until used */
+        if (capacity == 0)
+        {
+            capacity = RECORD_DEFAULT_CAPACITY;
+        }
+
+        size_t size = file_size_for(capacity);
+        if (ftruncate(rec->fd, (off_t)size) != 0)
+        {
+            perror("ftruncate");
+            record_close(rec);
+            return -1;
+        }
+
+        if (map_file(rec, size, PROT_READ | PROT_WRITE) != 0)
+        {
+            record_close(rec);
+            return -1;
+        }
+
+        memcpy(rec->header->magic, RECORD_MAGIC, sizeof(rec->header->magic));
+        rec->header->version     = RECORD_VERSION;
+        rec->header->record_size = (uint32_t)sizeof(record_sample_t);
+        rec->header->capacity    = capacity;
+        atomic_store_explicit(&rec->header->head, 0, memory_order_release);
+        return 0;
+    }
+
+    /* Existing file: keep appending with its own capacity */
+    if ((size_t)st.st_size < sizeof(record_header_t))
+    {
+        fprintf(stderr, "Error: %s is not a recording\n", path);
+        record_close(rec);
+        return -1;
+    }
+
+    if (map_file(rec, (size_t)st.st_size, PROT_READ | PROT_WRITE) != 0)
+    {
+        record_close(rec);
+        return -1;
+    }
+
+    if (!header_valid(rec->header, (size_t)st.st_size, path))
+    {
+        record_close(rec);
+        return -1;
+    }
+
+    return 0;
+}
+
+int record_open_read(record_file_t *rec, const char *path)
+{
+    struct stat st;
+
+    memset(rec, 0, sizeof(record_file_t));
+
+    rec->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (rec->fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(rec->fd, &st) != 0)
+    {
+        perror("fstat");
+        record_close(rec);
+        return -1;
+    }
+
+    if ((size_t)st.st_size < sizeof(record_header_t))
+    {
+        fprintf(stderr, "Error: %s is not a recording\n", path);
+        record_close(rec);
+        return -1;
+    }
+
+    if (map_file(rec, (size_t)st.st_size, PROT_READ) != 0)
+    {
+        record_close(rec);
+        return -1;
+    }
+
+    if (!header_valid(rec->header, (size_t)st.st_size, path))
+    {
+        record_close(rec);
+        return -1;
+    }
+
+    /*
+     * Replay what is held now; a live recorder keeps moving head. Once
+     * the ring is full, the oldest slot is the one it writes next, so it
+     * is left out.
+     */
+    uint64_t head =
+        atomic_load_explicit(&rec->header->head, memory_order_acquire);
+
+    rec->count =
+        head < rec->header->capacity ? head : rec->header->capacity - 1;
+    rec->first = head - rec->count;
+    return 0;
+}
+
+void record_append(record_file_t *rec, const system_memory_t *sys_mem)
+{
+    uint64_t head =
+        atomic_load_explicit(&rec->header->head, memory_order_relaxed);
+
+    /* Readers check head after copying; keep the slot stores after it */
+    atomic_thread_fence(memory_order_release);
+    encode_sample(&rec->slots[head % rec->header->capacity], sys_mem);
+
+    /* Publish the slot only after it has been written */
+    atomic_store_explicit(&rec->header->head, head + 1, memory_order_release);
+}
+
+uint64_t record_count(const record_file_t *rec)
+{
+    return rec->count;
+}
+
+int record_get(const record_file_t *rec, uint64_t index,
+               system_memory_t *sys_mem)
+{
+    uint64_t        seq      = rec->first + index;
+    uint64_t        capacity = rec->header->capacity;
+    record_sample_t sample   = rec->slots[seq % capacity];
+
+    /*
+     * The recorder starts reusing this slot once head reaches seq +
+     * capacity. Checked after the copy, so a torn copy is never used.
+     */
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t head =
+        atomic_load_explicit(&rec->header->head, memory_order_relaxed);
+    if (head - seq >= capacity)
+    {
+        return -1;
+    }
+
+    decode_sample(sys_mem, &sample);
+    return 0;
+}
+
+void record_close(record_file_t *rec)
+{
+    if (rec->map != NULL)
+    {
+        munmap(rec->map, rec->map_size);
+        rec->map = NULL;
+    }
+
+    if (rec->fd >= 0)
+    {
+        close(rec->fd);
+    }
+
+    memset(rec, 0, sizeof(record_file_t));
+    rec->fd = -1;
+}
@@ -0,0 +1,174 @@
+/*
+ * record.h - Binary sample recording to a memory-mapped ring file
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "memory.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define RECORD_MAGIC   "MFREEREC"
+#define RECORD_VERSION 2 /* Bump whenever record_sample_t changes */
+
+/* Default ring size: one day of samples at a 1 second interval */
+#define RECORD_DEFAULT_CAPACITY 86400
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * On-disk header, followed by capacity record_sample_t slots. head is
+ * published by the recorder after each slot is written.
+ */
+typedef struct
+{
+    char             magic[8];    /* RECORD_MAGIC, not NUL-terminated */
+    uint32_t         version;     /* RECORD_VERSION */
+    uint32_t         record_size; /* sizeof(record_sample_t) */
+    uint64_t         capacity;    /* Number of slots in the ring */
+    _Atomic uint64_t head;        /* Records ever written; next is head % cap */
+    uint64_t         reserved[4]; /* Zero; pads the header to 64 bytes */
+} record_header_t;
+
+/*
+ * On-disk sample: fixed-width fields in host byte order, widest first so
+ * there is no padding. Memory and swap sizes are in pages, rounded down
+ * and capped at UINT32_MAX (16 TiB with 4 KiB pages). PSI averages are
+ * in hundredths of a percent.
+ */
+typedef struct
+{
+    uint64_t timestamp;      /* Monotonic sample time in nanoseconds */
+    uint64_t walltime;       /* Wall-clock sample time, ns since epoch */
+    uint64_t pageins;        /* vm_counters_t, as sampled */
+    uint64_t pageouts;
+    uint64_t swapins;
+    uint64_t swapouts;
+    uint64_t compressions;
+    uint64_t decompressions;
+    uint64_t faults;
+    uint64_t purges;
+    uint64_t some_total;     /* PSI stall totals, us */
+    uint64_t full_total;
+    uint32_t page_size;      /* Unit of the page counts below, in bytes */
+    uint32_t mem_total;      /* mem_info_t, in pages */
+    uint32_t mem_used;
+    uint32_t mem_free;
+    uint32_t mem_active;
+    uint32_t mem_inactive;
+    uint32_t mem_wired;
+    uint32_t mem_compressed;
+    uint32_t mem_cached;
+    uint32_t mem_app;
+    uint32_t mem_available;
+    uint32_t mem_shared;
+    uint32_t mem_buff_cache;
+    uint32_t mem_hugetlb;
+    uint32_t swap_total;     /* swap_info_t, in pages */
+    uint32_t swap_used;
+    uint32_t swap_free;
+    uint16_t some_avg10;     /* PSI averages, 1/100 % */
+    uint16_t some_avg60;
+    uint16_t full_avg10;
+    uint16_t full_avg60;
+    uint16_t level;          /* PRESSURE_LEVEL_* (macOS), 0 on Linux */
+    uint16_t valid;          /* Pressure was sampled */
+} record_sample_t;
+
+/* An open ring file */
+typedef struct
+{
+    int              fd;       /* File descriptor */
+    void            *map;      /* Mapping of the whole file */
+    size_t           map_size; /* Size of the mapping */
+    record_header_t *header;   /* Header at the start of the mapping */
+    record_sample_t *slots;    /* Ring slots following the header */
+    uint64_t         first;    /* Replay: oldest record held at open */
+    uint64_t         count;    /* Replay: records held at open */
+} record_file_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Open a ring file for recording, creating it if needed
+ *
+ * An existing ring file is appended to and keeps its own capacity.
+ * Files that are not ring files are refused rather than overwritten.
+ *
+ * @param rec       Ring file to initialize
+ * @param path      File path
+ * @param capacity  Slots to allocate when creating a new file
+ * @return          0 on success, -1 on error
+ */
+int record_open(record_file_t *rec, const char *path, uint64_t capacity);
+
+/**
+ * Open an existing ring file read-only for replay
+ *
+ * The samples held at this point are the ones replayed; records appended
+ * later by a running recorder are not picked up.
+ *
+ * @param rec       Ring file to initialize
+ * @param path      File path
+ * @return          0 on success, -1 on error
+ */
+int record_open_read(record_file_t *rec, const char *path);
+
+/**
+ * Append a sample, overwriting the oldest one once the ring is full
+ *
+ * @param rec       Ring file opened with record_open()
+ * @param sys_mem   Sample to store
+ */
+void record_append(record_file_t *rec, const system_memory_t *sys_mem);
+
+/**
+ * Number of samples held in the ring when it was opened for replay
+ *
+ * @param rec       Ring file opened with record_open_read()
+ * @return          Sample count
+ */
+uint64_t record_count(const record_file_t *rec);
+
+/**
+ * Get a held sample, oldest first
+ *
+ * Indices refer to the ring as it was when opened, so a recorder still
+ * appending does not shift them. It can, however, overwrite them.
+ *
+ * @param rec       Ring file opened with record_open_read()
+ * @param index     0 .. record_count() - 1
+ * @param sys_mem   Receives the sample
+ * @return          0 on success, -1 if the recorder has overwritten it
+ */
+int record_get(const record_file_t *rec, uint64_t index,
+               system_memory_t *sys_mem);
+
+/**
+ * Unmap and close a ring file
+ *
+ * @param rec       Ring file to close
+ */
+void record_close(record_file_t *rec);
+
+#endif /* RECORD_H */
@@ -0,0 +1,152 @@
+/*
+ * sampler.c - Stateful memory sampler implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "sampler.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+/*
+ * The kernel updates the counters while we read them, so a sample can
+ * briefly account for more pages than exist. Such samples are re-read.
+ */
+static int sample_consistent(const system_memory_t *sys_mem)
+{
+    const mem_info_t  *mem  = &sys_mem->mem;
+    const swap_info_t *swap = &sys_mem->swap;
+
+    uint64_t accounted = mem->free + mem->active + mem->inactive + mem->wired;
+
+    if (accounted > mem->total || mem->used > mem->total ||
+        mem->available > mem->total)
+    {
+        return 0;
+    }
+
+    if (swap->used > swap->total)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * ============================================================================
+ * Sampler Functions
+ * ============================================================================
+ */
+
+int sampler_init(sampler_t *sampler, unsigned flags)
+{
+    if (sampler == NULL)
+    {
+        return -1;
+    }
+
+    memset(sampler, 0, sizeof(sampler_t));
+
+    if (memory_init() != 0)
+    {
+        return -1;
+    }
+
+    sampler->flags     = flags;
+    sampler->backend   = memory_get_backend();
+    sampler->page_size = sampler->backend->page_size();
+    sampler->total     = sampler->backend->total_memory();
+
+    if (sampler->total == 0)
+    {
+        memory_cleanup();
+        return -1;
+    }
+
+    return 0;
+}
+
+int sampler_sample(sampler_t *sampler, system_memory_t *sys_mem)
+{
+    if (sampler == NULL || sys_mem == NULL || sampler->backend == NULL)
+    {
+        return -1;
+    }
+
+    for (int attempt = 0;; attempt++)
+    {
+        memset(sys_mem, 0, sizeof(system_memory_t));
+
+        sys_mem->timestamp = monotonic_ns();
+        sys_mem->walltime  = realtime_ns();
+        sys_mem->page_size = sampler->page_size;
+
+        if (sampler->backend->memory_info(&sys_mem->mem) != 0)
+        {
+            return -1;
+        }
+
+        if (sampler->backend->swap_info(&sys_mem->swap) != 0)
+        {
+            /* Swap info failure is non-fatal */
+            fprintf(stderr, "Warning: Could not retrieve swap information\n");
+        }
+
+        if (sample_consistent(sys_mem) || attempt >= SAMPLER_MAX_RETRIES)
+        {
+            break;
+        }
+
+        sampler->retries++;
+    }
+
+    if (sampler->flags & SAMPLE_COUNTERS)
+    {
+        if (sampler->backend->vm_counters == NULL ||
+            sampler->backend->vm_counters(&sys_mem->counters) != 0)
+        {
+            /* Keep sampling memory; just stop asking for counters */
+            fprintf(stderr, "Warning: Event counters are not available\n");
+            sampler->flags &= ~(unsigned)SAMPLE_COUNTERS;
+        }
+    }
+
+    if (sampler->flags & SAMPLE_PRESSURE)
+    {
+        if (sampler->backend->pressure_info != NULL &&
+            sampler->backend->pressure_info(&sys_mem->pressure) == 0)
+        {
+            sys_mem->pressure.valid = 1;
+        }
+        else
+        {
+            /* Common on older kernels; the heuristic takes over quietly */
+            sampler->flags &= ~(unsigned)SAMPLE_PRESSURE;
+        }
+    }
+
+    sampler->samples++;
+    return 0;
+}
+
+void sampler_cleanup(sampler_t *sampler)
+{
+    if (sampler == NULL || sampler->backend == NULL)
+    {
+        return;
+    }
+
+    memory_cleanup();
+    sampler->backend = NULL;
+}
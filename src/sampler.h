@@ -0,0 +1,84 @@
+/*
+ * sampler.h - Stateful memory sampler
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "memory.h"
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/* Re-reads allowed when counters come back inconsistent */
+#define SAMPLER_MAX_RETRIES 3
+
+/* Optional data collected by sampler_sample() */
+#define SAMPLE_COUNTERS 0x01 /* Paging/compression event counters */
+#define SAMPLE_PRESSURE 0x02 /* Kernel memory pressure (PSI, macOS level) */
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Sampler state
+ *
+ * Created once before the watch loop. Static facts (page size, installed
+ * memory, backend handles) are resolved by sampler_init(), so each
+ * sampler_sample() call only fetches the counters that change.
+ */
+typedef struct
+{
+    const memory_backend_t *backend;   /* Backend in use */
+    size_t                  page_size; /* Cached page size */
+    uint64_t                total;     /* Cached total memory */
+    unsigned                flags;     /* SAMPLE_* flags */
+    uint64_t                samples;   /* Samples taken */
+    uint64_t                retries;   /* Inconsistent reads retried */
+} sampler_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Initialize a sampler and the active memory backend
+ *
+ * @param sampler   Sampler to initialize
+ * @param flags     SAMPLE_* flags selecting optional data
+ * @return          0 on success, -1 on error
+ */
+int sampler_init(sampler_t *sampler, unsigned flags);
+
+/**
+ * Take one sample
+ *
+ * Retries up to SAMPLER_MAX_RETRIES times when the counters are
+ * inconsistent (they are read non-atomically by the kernel); the last
+ * read is kept if they never settle.
+ *
+ * @param sampler   Initialized sampler
+ * @param sys_mem   Sample to fill, including its monotonic timestamp
+ * @return          0 on success, -1 on error
+ */
+int sampler_sample(sampler_t *sampler, system_memory_t *sys_mem);
+
+/**
+ * Release resources held by a sampler
+ *
+ * @param sampler   Sampler to clean up
+ */
+void sampler_cleanup(sampler_t *sampler);
+
+#endif /* SAMPLER_H */
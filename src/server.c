@@ -0,0 +1,620 @@
+/*
+ * server.c - Unix socket snapshot server implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "server.h"
+
+#include "format.h"
+#include "frame.h"
+#include "memory.h"
+#include "sampler.h"
+#include "ticker.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Connected client
+ *
+ * Responses are queued in out and written as the socket accepts them.
+ * HISTORY replies are rendered lazily, one sample at a time, from
+ * history_next up to history_end, so a long reply needs no more buffer
+ * than a short one.
+ */
+typedef struct
+{
+    int      fd;                  /* Socket, -1 if the slot is free */
+    char     in[SERVER_LINE_MAX]; /* Partial request line(s) */
+    size_t   in_len;              /* Bytes used in in */
+    frame_t  out;                 /* Queued response bytes */
+    size_t   out_off;             /* Bytes of out already written */
+    int      subscribed;          /* Receives every new sample */
+    int      in_history;          /* A HISTORY reply is in progress */
+    uint64_t history_next;        /* Next sample number to send */
+    uint64_t history_end;         /* One past the last sample to send */
+    uint64_t dropped;             /* Samples skipped, not yet reported */
+    int      closing;             /* Close once out has been written */
+} client_t;
+
+/*
+ * ============================================================================
+ * Server State
+ * ============================================================================
+ */
+
+/* Recent samples; sample number n lives in slot n % SERVER_HISTORY */
+static system_memory_t g_history[SERVER_HISTORY];
+static uint64_t        g_samples = 0;
+
+static client_t g_clients[SERVER_MAX_CLIENTS];
+static frame_t  g_scratch;
+
+/*
+ * ============================================================================
+ * History Functions
+ * ============================================================================
+ */
+
+static uint64_t history_oldest(void)
+{
+    return g_samples > SERVER_HISTORY ? g_samples - SERVER_HISTORY : 0;
+}
+
+static const system_memory_t *history_get(uint64_t n)
+{
+    return &g_history[n % SERVER_HISTORY];
+}
+
+/*
+ * ============================================================================
+ * Output Functions
+ * ============================================================================
+ */
+
+/* Queue bytes for a client; -1 (nothing queued) if they don't fit */
+static int client_queue(client_t *client, const char *data, size_t len)
+{
+    frame_t *out = &client->out;
+
+    if (out->len + len > sizeof(out->buf) && client->out_off > 0)
+    {
+        /* Reclaim the space already written */
+        memmove(out->buf, out->buf + client->out_off,
+                out->len - client->out_off);
+        out->len -= client->out_off;
+        client->out_off = 0;
+    }
+
+    if (out->len + len > sizeof(out->buf))
+    {
+        return -1;
+    }
+
+    frame_append(out, data, len);
+    return 0;
+}
+
+static int client_queue_sample(client_t *client, const system_memory_t *sample,
+                               const options_t *opts)
+{
+    frame_reset(&g_scratch);
+    render_json(&g_scratch, sample, opts);
+
+    return client_queue(client, g_scratch.buf, g_scratch.len);
+}
+
+/* Tell a subscriber how many samples it was too slow to receive */
+static int client_report_dropped(client_t *client)
+{
+    char line[64];
+
+    if (client->dropped == 0)
+    {
+        return 0;
+    }
+
+    int len = snprintf(line, sizeof(line), "DROPPED %llu\n",
+                       (unsigned long long)client->dropped);
+    if (client_queue(client, line, (size_t)len) != 0)
+    {
+        return -1;
+    }
+
+    client->dropped = 0;
+    return 0;
+}
+
+/* Render as much of a pending HISTORY reply as fits */
+static void client_fill_history(client_t *client, const options_t *opts)
+{
+    while (client->in_history)
+    {
+        /* Samples overwritten while the client was reading are gone */
+        if (client->history_next < history_oldest())
+        {
+            client->history_next = history_oldest();
+        }
+
+        if (client->history_next >= client->history_end)
+        {
+            if (client_queue(client, "END\n", 4) == 0)
+            {
+                client->in_history = 0;
+            }
+            return;
+        }
+
+        if (client_queue_sample(client, history_get(client->history_next),
+                                opts) != 0)
+        {
+            return;
+        }
+        client->history_next++;
+    }
+}
+
+/*
+ * ============================================================================
+ * Request Handling
+ * ============================================================================
+ */
+
+static void client_reply(client_t *client, const char *line)
+{
+    if (client_queue(client, line, strlen(line)) != 0)
+    {
+        /* Only possible if the client never reads; give up on it */
+        client->closing = 1;
+    }
+}
+
+static void handle_request(client_t *client, char *line, const options_t *opts)
+{
+    char *cmd = strtok(line, " \t\r");
+    char *arg = strtok(NULL, " \t\r");
+
+    if (cmd == NULL)
+    {
+        return;
+    }
+
+    if (strcasecmp(cmd, "GET") == 0)
+    {
+        if (g_samples == 0 ||
+            client_queue_sample(client, history_get(g_samples - 1), opts) != 0)
+        {
+            client_reply(client, "ERR no sample\n");
+        }
+    }
+    else if (strcasecmp(cmd, "HISTORY") == 0)
+    {
+        uint64_t count = g_samples - history_oldest();
+
+        if (arg != NULL)
+        {
+            char              *end;
+            unsigned long long n = strtoull(arg, &end, 10);
+
+            if (end == arg || *end != '\0')
+            {
+                client_reply(client, "ERR invalid count\n");
+                return;
+            }
+            if (n < count)
+            {
+                count = n;
+            }
+        }
+
+        client->in_history   = 1;
+        client->history_end  = g_samples;
+        client->history_next = g_samples - count;
+        client_fill_history(client, opts);
+    }
+    else if (strcasecmp(cmd, "SUBSCRIBE") == 0)
+    {
+        client->subscribed = 1;
+    }
+    else if (strcasecmp(cmd, "QUIT") == 0)
+    {
+        client->closing = 1;
+    }
+    else
+    {
+        client_reply(client, "ERR unknown command\n");
+    }
+}
+
+/*
+ * Answer complete request lines in order. Stops while a HISTORY reply is
+ * still being sent so pipelined requests are answered in sequence.
+ */
+static void client_process(client_t *client, const options_t *opts)
+{
+    size_t start = 0;
+
+    while (!client->in_history && !client->closing)
+    {
+        char *nl = memchr(client->in + start, '\n', client->in_len - start);
+        if (nl == NULL)
+        {
+            break;
+        }
+
+        *nl = '\0';
+        handle_request(client, client->in + start, opts);
+        start = (size_t)(nl - client->in) + 1;
+    }
+
+    memmove(client->in, client->in + start, client->in_len - start);
+    client->in_len -= start;
+
+    if (client->in_len == sizeof(client->in) &&
+        memchr(client->in, '\n', client->in_len) == NULL)
+    {
+        client_reply(client, "ERR line too long\n");
+        client->closing = 1;
+    }
+}
+
+/*
+ * ============================================================================
+ * Connection Functions
+ * ============================================================================
+ */
+
+static void client_close(client_t *client)
+{
+    close(client->fd);
+    client->fd = -1;
+}
+
+static void accept_clients(int listen_fd)
+{
+    for (;;)
+    {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                perror("accept");
+            }
+            return;
+        }
+
+        client_t *client = NULL;
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+        {
+            if (g_clients[i].fd < 0)
+            {
+                client = &g_clients[i];
+                break;
+            }
+        }
+
+        if (client == NULL ||
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 ||
+            fcntl(fd, F_SETFD, FD_CLOEXEC) != 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        memset(client, 0, sizeof(client_t));
+        client->fd = fd;
+    }
+}
+
+/* Read whatever the client sent; -1 if the connection is finished */
+static int client_read(client_t *client, const options_t *opts)
+{
+    ssize_t n = read(client->fd, client->in + client->in_len,
+                     sizeof(client->in) - client->in_len);
+
+    if (n == 0)
+    {
+        return -1;
+    }
+    if (n < 0)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0
+                                                                          : -1;
+    }
+
+    client->in_len += (size_t)n;
+    client_process(client, opts);
+    return 0;
+}
+
+/* Write queued output; -1 if the connection is finished */
+static int client_write(client_t *client, const options_t *opts)
+{
+    while (client->out_off < client->out.len)
+    {
+        ssize_t n = write(client->fd, client->out.buf + client->out_off,
+                          client->out.len - client->out_off);
+        if (n < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+                       ? 0
+                       : -1;
+        }
+        client->out_off += (size_t)n;
+
+        if (client->out_off == client->out.len)
+        {
+            frame_reset(&client->out);
+            client->out_off = 0;
+
+            /* Room again: continue a HISTORY reply, then queued requests */
+            client_fill_history(client, opts);
+            client_process(client, opts);
+        }
+    }
+
+    return client->closing ? -1 : 0;
+}
+
+/* Hand a new sample to every subscriber that has room for it */
+static void publish_sample(const system_memory_t *sample, const options_t *opts)
+{
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+    {
+        client_t *client = &g_clients[i];
+
+        if (client->fd < 0 || !client->subscribed || client->closing)
+        {
+            continue;
+        }
+
+        if (client->in_history || client_report_dropped(client) != 0 ||
+            client_queue_sample(client, sample, opts) != 0)
+        {
+            client->dropped++;
+        }
+    }
+}
+
+/*
+ * ============================================================================
+ * Listening Socket
+ * ============================================================================
+ */
+
+static int open_listener(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat        st;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    /* Replace a socket left behind by a previous run, never a file */
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+            fprintf(stderr, "Error: %s is already being served\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "Error: Cannot listen on %s: %s\n", path,
+                strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 ||
+        fcntl(fd, F_SETFD, FD_CLOEXEC) != 0)
+    {
+        perror("fcntl");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*
+ * ============================================================================
+ * Event Loop
+ * ============================================================================
+ */
+
+int server_run(const options_t *opts, volatile int *running)
+{
+    sampler_t     sampler;
+    ticker_t      ticker;
+    struct pollfd fds[SERVER_MAX_CLIENTS + 1];
+    int           slot[SERVER_MAX_CLIENTS + 1];
+    uint64_t      interval = opts->interval > 0 ? opts->interval
+                                                : NSEC_PER_SEC;
+    int           status   = EXIT_SUCCESS;
+
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+    {
+        g_clients[i].fd = -1;
+    }
+
+    /* A client that disconnects mid-write must not kill the server */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (sampler_init(&sampler, (opts->rates ? SAMPLE_COUNTERS : 0) |
+                                   SAMPLE_PRESSURE) != 0)
+    {
+        fprintf(stderr, "Error: Failed to initialize memory sampling\n");
+        return EXIT_FAILURE;
+    }
+
+    int listen_fd = open_listener(opts->serve);
+    if (listen_fd < 0)
+    {
+        sampler_cleanup(&sampler);
+        return EXIT_FAILURE;
+    }
+
+    /* Take the first sample now so GET works as soon as clients connect */
+    ticker_init(&ticker, interval);
+    ticker.deadline = monotonic_ns();
+
+    while (*running)
+    {
+        int64_t missed = ticker_advance(&ticker);
+        if (missed >= 0)
+        {
+            system_memory_t *sample = &g_history[g_samples % SERVER_HISTORY];
+
+            if (sampler_sample(&sampler, sample) != 0)
+            {
+                fprintf(stderr,
+                        "Error: Failed to retrieve memory information\n");
+                status = EXIT_FAILURE;
+                break;
+            }
+            g_samples++;
+            publish_sample(sample, opts);
+
+            if (missed > 0)
+            {
+                fprintf(stderr, "Warning: missed %lld tick(s)\n",
+                        (long long)missed);
+            }
+
+            if (opts->count > 0 && g_samples >= (uint64_t)opts->count)
+            {
+                break;
+            }
+        }
+
+        /* Poll the listener and every client; only ask for what we need */
+        nfds_t nfds = 0;
+
+        fds[nfds].fd     = listen_fd;
+        fds[nfds].events = POLLIN;
+        slot[nfds++]     = -1;
+
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+        {
+            client_t *client = &g_clients[i];
+
+            if (client->fd < 0)
+            {
+                continue;
+            }
+
+            fds[nfds].fd     = client->fd;
+            fds[nfds].events = 0;
+            if (client->in_len < sizeof(client->in) && !client->closing)
+            {
+                fds[nfds].events |= POLLIN;
+            }
+            if (client->out_off < client->out.len)
+            {
+                fds[nfds].events |= POLLOUT;
+            }
+            slot[nfds++] = i;
+        }
+
+        int ready = poll(fds, nfds, ticker_timeout_ms(&ticker));
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("poll");
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        for (nfds_t i = 1; i < nfds && ready > 0; i++)
+        {
+            client_t *client = &g_clients[slot[i]];
+            int       done   = 0;
+
+            if (fds[i].revents == 0)
+            {
+                continue;
+            }
+            ready--;
+
+            if (fds[i].revents & (POLLERR | POLLNVAL))
+            {
+                done = 1;
+            }
+            if (!done && (fds[i].revents & (POLLIN | POLLHUP)))
+            {
+                done = client_read(client, opts) != 0;
+            }
+            if (!done)
+            {
+                done = client_write(client, opts) != 0;
+            }
+
+            if (done)
+            {
+                client_close(client);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            accept_clients(listen_fd);
+        }
+    }
+
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++)
+    {
+        if (g_clients[i].fd >= 0)
+        {
+            client_close(&g_clients[i]);
+        }
+    }
+
+    close(listen_fd);
+    unlink(opts->serve);
+    sampler_cleanup(&sampler);
+
+    return status;
+}
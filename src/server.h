@@ -0,0 +1,52 @@
+/*
+ * server.h - Unix socket snapshot server
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "utils.h"
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define SERVER_MAX_CLIENTS 64   /* Connections served at once */
+#define SERVER_HISTORY     3600 /* Samples kept for HISTORY requests */
+#define SERVER_LINE_MAX    256  /* Longest request line */
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Run the snapshot server until *running becomes 0
+ *
+ * Samples at opts->interval (1 second by default), keeps the last
+ * SERVER_HISTORY samples, and answers line-based requests on a Unix
+ * stream socket at opts->serve:
+ *
+ *   GET              Latest sample as one JSON line
+ *   HISTORY [N]      Last N (default: all) samples, oldest first, then "END"
+ *   SUBSCRIBE        Every new sample as it is taken, until disconnect
+ *   QUIT             Close the connection
+ *
+ * Requests may be pipelined; they are answered in order. Sockets are
+ * non-blocking and every client has a bounded output buffer, so a slow
+ * client only loses its own subscription samples and never delays
+ * sampling or other clients.
+ *
+ * @param opts      Options (serve path, interval, rates)
+ * @param running   Cleared by the signal handler to stop the server
+ * @return          EXIT_SUCCESS or EXIT_FAILURE
+ */
+int server_run(const options_t *opts, volatile int *running);
+
+#endif /* SERVER_H */
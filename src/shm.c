@@ -0,0 +1,278 @@
+/*
+ * shm.c - Shared memory seqlock implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * Segment Functions
+ * ============================================================================
+ */
+
+/*
+ * Check an existing segment before replacing it
+ *
+ * Only the header is read, so a segment left by a version with another
+ * record size is recognized too.
+ *
+ * @return  0 if there is none or it was stale and has been removed,
+ *          -1 if a live publisher owns it or it cannot be inspected
+ */
+static int remove_stale(const char *name)
+{
+    struct stat st;
+    size_t      header = offsetof(shm_segment_t, seq);
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return 0;
+        }
+        fprintf(stderr, "Error: shm_open %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "Error: fstat %s: %s\n", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    /* A segment too small for the header was never set up: stale */
+    if ((size_t)st.st_size >= header)
+    {
+        const shm_segment_t *seg =
+            mmap(NULL, header, PROT_READ, MAP_SHARED, fd, 0);
+        if (seg == MAP_FAILED)
+        {
+            perror("mmap");
+            close(fd);
+            return -1;
+        }
+
+        pid_t pid  = (pid_t)seg->pid;
+        int   live = seg->magic == SHM_MAGIC && pid > 0 && pid != getpid() &&
+                   (kill(pid, 0) == 0 || errno == EPERM);
+        munmap((void *)seg, header);
+
+        if (live)
+        {
+            fprintf(stderr, "Error: %s is already published by process %d\n",
+                    name, (int)pid);
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+
+    /* Left behind by a crash or an older version; start afresh */
+    if (shm_unlink(name) != 0 && errno != ENOENT)
+    {
+        fprintf(stderr, "Error: shm_unlink %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int shm_create(shm_handle_t *shm, const char *name, uint64_t interval)
+{
+    memset(shm, 0, sizeof(shm_handle_t));
+    shm->name = name;
+
+    if (remove_stale(name) != 0)
+    {
+        return -1;
+    }
+
+    /*
+     * Always a new object: macOS refuses ftruncate() on a POSIX shared
+     * memory object that already has a size
+     */
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: shm_open %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)sizeof(shm_segment_t)) != 0)
+    {
+        fprintf(stderr, "Error: ftruncate %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    void *map = mmap(NULL, sizeof(shm_segment_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        shm_unlink(name);
+        return -1;
+    }
+
+    shm->segment = (shm_segment_t *)map;
+    shm->owner   = 1;
+
+    /* Invalidate first so readers ignore the segment while we set it up */
+    shm->segment->magic = 0;
+    atomic_store_explicit(&shm->segment->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    shm->segment->version     = SHM_VERSION;
+    shm->segment->record_size = (uint32_t)sizeof(system_memory_t);
+    shm->segment->interval    = interval;
+    shm->segment->pid         = (int64_t)getpid();
+    atomic_thread_fence(memory_order_release);
+    shm->segment->magic = SHM_MAGIC;
+
+    return 0;
+}
+
+int shm_attach(shm_handle_t *shm, const char *name)
+{
+    struct stat st;
+
+    memset(shm, 0, sizeof(shm_handle_t));
+    shm->name = name;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: shm_open %s: %s (is a --daemon running?)\n",
+                name, strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_segment_t))
+    {
+        fprintf(stderr, "Error: %s is not a mac-free segment\n", name);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, sizeof(shm_segment_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+
+    shm->segment = (shm_segment_t *)map;
+
+    if (shm->segment->magic != SHM_MAGIC ||
+        shm->segment->version != SHM_VERSION ||
+        shm->segment->record_size != sizeof(system_memory_t))
+    {
+        fprintf(stderr, "Error: %s was published by an incompatible version\n",
+                name);
+        shm_close(shm);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Seqlock
+ * ============================================================================
+ */
+
+void shm_publish(shm_handle_t *shm, const system_memory_t *sys_mem)
+{
+    shm_segment_t *seg = shm->segment;
+    uint64_t       words[SHM_WORDS];
+    uint64_t seq = atomic_load_explicit(&seg->seq, memory_order_relaxed);
+
+    memset(words, 0, sizeof(words));
+    memcpy(words, sys_mem, sizeof(system_memory_t));
+
+    /* Odd: readers that overlap with the copy below will retry */
+    atomic_store_explicit(&seg->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < SHM_WORDS; i++)
+    {
+        atomic_store_explicit(&seg->data[i], words[i], memory_order_relaxed);
+    }
+
+    /* Even again: publishes the payload */
+    atomic_store_explicit(&seg->seq, seq + 2, memory_order_release);
+}
+
+int shm_read(const shm_handle_t *shm, system_memory_t *sys_mem)
+{
+    shm_segment_t *seg = shm->segment;
+    uint64_t       words[SHM_WORDS];
+
+    for (int attempt = 0; attempt < SHM_READ_RETRIES; attempt++)
+    {
+        uint64_t begin = atomic_load_explicit(&seg->seq, memory_order_acquire);
+        if (begin & 1)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < SHM_WORDS; i++)
+        {
+            words[i] =
+                atomic_load_explicit(&seg->data[i], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t end = atomic_load_explicit(&seg->seq, memory_order_relaxed);
+
+        if (begin == end)
+        {
+            if (begin == 0)
+            {
+                /* Publisher is up but has not produced a sample yet */
+                return -1;
+            }
+
+            memcpy(sys_mem, words, sizeof(system_memory_t));
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+void shm_close(shm_handle_t *shm)
+{
+    if (shm->segment != NULL)
+    {
+        munmap(shm->segment, sizeof(shm_segment_t));
+        shm->segment = NULL;
+    }
+
+    if (shm->owner)
+    {
+        shm_unlink(shm->name);
+        shm->owner = 0;
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * shm.h - Latest sample published through shared memory
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "memory.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+/* Default POSIX shared memory object (macOS limits names to 31 chars) */
+#define SHM_DEFAULT_NAME "/mac-free"
+
+#define SHM_MAGIC   0x45455246434d4146ULL /* "FAMCFREE" */
+#define SHM_VERSION 1
+
+/* Payload size in 64-bit words */
+#define SHM_WORDS ((sizeof(system_memory_t) + 7) / 8)
+
+/* Reader attempts before giving up on a writer that never settles */
+#define SHM_READ_RETRIES 1000
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Shared segment layout
+ *
+ * The sample is protected by a seqlock: the writer makes seq odd, stores
+ * the payload, then makes seq even again. Readers copy the payload and
+ * retry if seq was odd or changed meanwhile, so they never block the
+ * writer and need no syscalls once the segment is mapped. The payload is
+ * stored as atomic words so the concurrent copy is not a data race.
+ */
+typedef struct
+{
+    uint64_t         magic;            /* SHM_MAGIC */
+    uint32_t         version;          /* SHM_VERSION */
+    uint32_t         record_size;      /* sizeof(system_memory_t) */
+    uint64_t         interval;         /* Publisher interval in ns */
+    int64_t          pid;              /* Publisher process ID */
+    _Atomic uint64_t seq;              /* Even = stable, odd = writing */
+    _Atomic uint64_t data[SHM_WORDS];  /* system_memory_t payload */
+} shm_segment_t;
+
+/* A mapped segment */
+typedef struct
+{
+    const char    *name;    /* Shared memory object name */
+    shm_segment_t *segment; /* Mapping, NULL if not mapped */
+    int            owner;   /* Created by us (unlink on close) */
+} shm_handle_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Create (or take over) a segment for publishing
+ *
+ * @param shm       Handle to initialize
+ * @param name      Shared memory object name
+ * @param interval  Publishing interval in ns, advertised to readers
+ * @return          0 on success, -1 on error
+ */
+int shm_create(shm_handle_t *shm, const char *name, uint64_t interval);
+
+/**
+ * Map an existing segment read-only
+ *
+ * @param shm       Handle to initialize
+ * @param name      Shared memory object name
+ * @return          0 on success, -1 on error
+ */
+int shm_attach(shm_handle_t *shm, const char *name);
+
+/**
+ * Publish a sample (single writer)
+ *
+ * @param shm       Handle from shm_create()
+ * @param sys_mem   Sample to publish
+ */
+void shm_publish(shm_handle_t *shm, const system_memory_t *sys_mem);
+
+/**
+ * Read the latest published sample without locking
+ *
+ * @param shm       Handle from shm_attach()
+ * @param sys_mem   Sample to fill
+ * @return          0 on success, -1 if nothing was published yet or the
+ *                  writer kept changing it
+ */
+int shm_read(const shm_handle_t *shm, system_memory_t *sys_mem);
+
+/**
+ * Unmap the segment; the publisher also removes it
+ *
+ * @param shm       Handle to close
+ */
+void shm_close(shm_handle_t *shm);
+
+#endif /* SHM_H */
@@ -0,0 +1,206 @@
+/*
+ * stats.c - Self-instrumentation of the watch loop
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "stats.h"
+
+#include "utils.h"
+
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+/*
+ * ============================================================================
+ * Helper Functions
+ * ============================================================================
+ */
+
+static uint64_t timeval_ns(const struct timeval *tv)
+{
+    return (uint64_t)tv->tv_sec * NSEC_PER_SEC + (uint64_t)tv->tv_usec * 1000;
+}
+
+static void get_usage(usage_t *usage)
+{
+    struct rusage ru;
+
+    memset(usage, 0, sizeof(usage_t));
+
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+    {
+        usage->cpu_user    = timeval_ns(&ru.ru_utime);
+        usage->cpu_system  = timeval_ns(&ru.ru_stime);
+        usage->voluntary   = (uint64_t)ru.ru_nvcsw;
+        usage->involuntary = (uint64_t)ru.ru_nivcsw;
+    }
+
+    usage->has_syscalls = stats_syscalls(&usage->syscalls) == 0;
+}
+
+/* Duration with a unit that keeps 3-4 significant digits */
+static void format_ns(double ns, char *buf, size_t bufsize)
+{
+    const char *sign = ns < 0.0 ? "-" : "";
+    double      abs  = ns < 0.0 ? -ns : ns;
+
+    if (abs < 1e3)
+    {
+        snprintf(buf, bufsize, "%s%.0fns", sign, abs);
+    }
+    else if (abs < 1e6)
+    {
+        snprintf(buf, bufsize, "%s%.1fus", sign, abs / 1e3);
+    }
+    else if (abs < 1e9)
+    {
+        snprintf(buf, bufsize, "%s%.2fms", sign, abs / 1e6);
+    }
+    else
+    {
+        snprintf(buf, bufsize, "%s%.3fs", sign, abs / 1e9);
+    }
+}
+
+static void report_histogram(FILE *out, const char *label,
+                             const histogram_t *hist)
+{
+    static const double percentiles[] = {50.0, 90.0, 99.0, 100.0};
+    char                buf[32];
+
+    fprintf(out, "%-9s", label);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+    {
+        format_ns((double)histogram_percentile(hist, percentiles[i]), buf,
+                  sizeof(buf));
+        fprintf(out, " %10s", buf);
+    }
+}
+
+/*
+ * ============================================================================
+ * Statistics Functions
+ * ============================================================================
+ */
+
+void stats_start(stats_t *stats)
+{
+    memset(stats, 0, sizeof(stats_t));
+    stats->start = monotonic_ns();
+    get_usage(&stats->usage);
+}
+
+void stats_stage(stats_t *stats, stage_t stage, uint64_t start)
+{
+    uint64_t elapsed = monotonic_ns() - start;
+
+    histogram_record(&stats->stages[stage], elapsed);
+    stats->totals[stage] += elapsed;
+}
+
+void stats_sample(stats_t *stats, uint64_t timestamp)
+{
+    if (stats->iterations == 0)
+    {
+        stats->first_sample = timestamp;
+    }
+    stats->last_sample = timestamp;
+    stats->iterations++;
+}
+
+void stats_wake(stats_t *stats, const ticker_t *ticker)
+{
+    /* ticker_wait() has already moved on to the following deadline */
+    uint64_t deadline = ticker->deadline - ticker->interval;
+    uint64_t now      = monotonic_ns();
+
+    histogram_record(&stats->lateness, now > deadline ? now - deadline : 0);
+}
+
+void stats_report(const stats_t *stats, const ticker_t *ticker, FILE *out)
+{
+    static const char *names[STAGE_COUNT] = {"sample", "render", "write",
+                                             "sleep"};
+    usage_t            now;
+    char               a[32];
+    char               b[32];
+
+    get_usage(&now);
+
+    uint64_t wall = monotonic_ns() - stats->start;
+
+    format_ns((double)wall, a, sizeof(a));
+    fprintf(out, "\nStats: %llu sample(s) over %s",
+            (unsigned long long)stats->iterations, a);
+    if (ticker != NULL && ticker->interval > 0)
+    {
+        format_ns((double)ticker->interval, b, sizeof(b));
+        fprintf(out, ", interval %s", b);
+    }
+    fprintf(out, "\n");
+
+    fprintf(out, "%-9s %10s %10s %10s %10s %10s\n", "stage", "p50", "p90",
+            "p99", "max", "total");
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        if (stats->stages[i].total == 0)
+        {
+            continue;
+        }
+        report_histogram(out, names[i], &stats->stages[i]);
+        format_ns((double)stats->totals[i], a, sizeof(a));
+        fprintf(out, " %10s\n", a);
+    }
+    if (stats->lateness.total > 0)
+    {
+        report_histogram(out, "late", &stats->lateness);
+        fprintf(out, "\n");
+    }
+
+    /* Drift: how far the samples strayed from a perfect schedule */
+    if (ticker != NULL && ticker->interval > 0 && stats->iterations > 1)
+    {
+        uint64_t intervals = stats->iterations - 1 + ticker->missed;
+        double   span      = (double)(stats->last_sample - stats->first_sample);
+        double   drift = span - (double)intervals * (double)ticker->interval;
+
+        format_ns(drift, a, sizeof(a));
+        fprintf(out, "Drift:   %s%s over %llu interval(s), %llu missed\n",
+                drift >= 0.0 ? "+" : "", a, (unsigned long long)intervals,
+                (unsigned long long)ticker->missed);
+    }
+
+    uint64_t user   = now.cpu_user - stats->usage.cpu_user;
+    uint64_t system = now.cpu_system - stats->usage.cpu_system;
+
+    format_ns((double)user, a, sizeof(a));
+    format_ns((double)system, b, sizeof(b));
+    fprintf(out, "CPU:     %.2f%% (user %s, system %s)\n",
+            wall > 0 ? 100.0 * (double)(user + system) / (double)wall : 0.0, a,
+            b);
+
+    fprintf(out, "Context: %llu voluntary, %llu involuntary switch(es)\n",
+            (unsigned long long)(now.voluntary - stats->usage.voluntary),
+            (unsigned long long)(now.involuntary - stats->usage.involuntary));
+
+    if (now.has_syscalls && stats->usage.has_syscalls)
+    {
+        uint64_t calls = now.syscalls - stats->usage.syscalls;
+
+        fprintf(out, "Syscalls: %llu %s", (unsigned long long)calls,
+                stats_syscalls_scope());
+        if (stats->iterations > 0)
+        {
+            fprintf(out, " (%.2f per sample)",
+                    (double)calls / (double)stats->iterations);
+        }
+        fprintf(out, "\n");
+    }
+    else
+    {
+        fprintf(out, "Syscalls: not available\n");
+    }
+}
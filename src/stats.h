@@ -0,0 +1,128 @@
+/*
+ * stats.h - Self-instrumentation of the watch loop
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "histogram.h"
+#include "ticker.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/* Timed stages of one loop iteration */
+typedef enum
+{
+    STAGE_SAMPLE, /* Reading the counters */
+    STAGE_RENDER, /* Formatting the frame */
+    STAGE_WRITE,  /* Writing the frame */
+    STAGE_SLEEP,  /* Waiting for the next tick */
+    STAGE_COUNT
+} stage_t;
+
+/* Process-wide resource usage at one point in time */
+typedef struct
+{
+    uint64_t cpu_user;     /* User CPU time, ns */
+    uint64_t cpu_system;   /* System CPU time, ns */
+    uint64_t voluntary;    /* Voluntary context switches */
+    uint64_t involuntary;  /* Involuntary context switches */
+    uint64_t syscalls;     /* System calls (see stats_syscalls()) */
+    int      has_syscalls; /* syscalls is valid */
+} usage_t;
+
+/*
+ * Loop statistics
+ *
+ * Per-stage latencies and wake-up lateness go into fixed-size
+ * histograms, so instrumenting a long session costs no extra memory.
+ */
+typedef struct
+{
+    histogram_t stages[STAGE_COUNT]; /* Latency per stage, ns */
+    uint64_t    totals[STAGE_COUNT]; /* Total time per stage, ns */
+    histogram_t lateness;            /* Wake-up past the deadline, ns */
+    uint64_t    start;               /* Monotonic time stats began */
+    uint64_t    first_sample;        /* Monotonic time of the first sample */
+    uint64_t    last_sample;         /* Monotonic time of the last sample */
+    uint64_t    iterations;          /* Samples taken */
+    usage_t     usage;               /* Resource usage when stats began */
+} stats_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Reset statistics and snapshot resource usage
+ *
+ * @param stats     Statistics to start
+ */
+void stats_start(stats_t *stats);
+
+/**
+ * Record the duration of one stage
+ *
+ * @param stats     Statistics to update
+ * @param stage     Stage that ran
+ * @param start     Monotonic time the stage started
+ */
+void stats_stage(stats_t *stats, stage_t stage, uint64_t start);
+
+/**
+ * Record that a sample was taken at the given monotonic time
+ *
+ * @param stats     Statistics to update
+ * @param timestamp Monotonic time of the sample
+ */
+void stats_sample(stats_t *stats, uint64_t timestamp);
+
+/**
+ * Record how late a wake-up was relative to its deadline
+ *
+ * @param stats     Statistics to update
+ * @param ticker    Ticker that was just waited on
+ */
+void stats_wake(stats_t *stats, const ticker_t *ticker);
+
+/**
+ * Print the report: stage latencies, drift against the ticker interval,
+ * CPU time, context switches and system calls
+ *
+ * @param stats     Statistics to report
+ * @param ticker    Ticker used by the loop (NULL if it never ran)
+ * @param out       Stream to print to
+ */
+void stats_report(const stats_t *stats, const ticker_t *ticker, FILE *out);
+
+/**
+ * Count the system calls made by this process so far
+ *
+ * Platform specific: macOS counts every BSD and Mach call; Linux only
+ * counts read- and write-type calls (syscr + syscw in /proc/self/io).
+ *
+ * @param count     System call count
+ * @return          0 on success, -1 if not available
+ */
+int stats_syscalls(uint64_t *count);
+
+/**
+ * Short description of what stats_syscalls() counts
+ *
+ * @return  Description such as "read/write"
+ */
+const char *stats_syscalls_scope(void);
+
+#endif /* STATS_H */
@@ -0,0 +1,36 @@
+/*
+ * stats_darwin.c - System call counting for macOS
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "stats.h"
+
+#include <mach/mach.h>
+
+/*
+ * ============================================================================
+ * System Call Counting
+ * ============================================================================
+ */
+
+int stats_syscalls(uint64_t *count)
+{
+    task_events_info_data_t info;
+    mach_msg_type_number_t  size = TASK_EVENTS_INFO_COUNT;
+
+    if (task_info(mach_task_self(), TASK_EVENTS_INFO, (task_info_t)&info,
+                  &size) != KERN_SUCCESS)
+    {
+        return -1;
+    }
+
+    *count = (uint64_t)info.syscalls_unix + (uint64_t)info.syscalls_mach;
+    return 0;
+}
+
+const char *stats_syscalls_scope(void)
+{
+    return "BSD + Mach";
+}
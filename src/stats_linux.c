@@ -0,0 +1,70 @@
+/*
+ * stats_linux.c - System call counting for Linux
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "stats.h"
+
+#include "procfs.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * System Call Counting
+ * ============================================================================
+ */
+
+/* Linux keeps no total, but task I/O accounting counts reads and writes */
+typedef struct
+{
+    uint64_t syscr; /* read(), pread(), readv(), ... */
+    uint64_t syscw; /* write(), pwrite(), writev(), ... */
+} io_counts_t;
+
+/* Positions in io_keys, for the bits procfs_parse() returns */
+enum
+{
+    IO_SYSCR,
+    IO_SYSCW,
+    IO_NKEYS
+};
+
+static const procfs_key_t io_keys[IO_NKEYS] = {
+    [IO_SYSCR] = PROCFS_KEY("syscr", io_counts_t, syscr),
+    [IO_SYSCW] = PROCFS_KEY("syscw", io_counts_t, syscw),
+};
+
+#define IO_FOUND_ALL (PROCFS_FOUND(IO_SYSCR) | PROCFS_FOUND(IO_SYSCW))
+
+int stats_syscalls(uint64_t *count)
+{
+    char        buf[512];
+    io_counts_t io = {0, 0};
+
+    int fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    ssize_t len = procfs_read(fd, buf, sizeof(buf));
+    close(fd);
+
+    if (len <= 0 ||
+        procfs_parse(buf, (size_t)len, io_keys, IO_NKEYS, &io) != IO_FOUND_ALL)
+    {
+        return -1;
+    }
+
+    *count = io.syscr + io.syscw;
+    return 0;
+}
+
+const char *stats_syscalls_scope(void)
+{
+    return "read/write";
+}
@@ -0,0 +1,43 @@
+/*
+ * summary.c - Percentile summaries of a watch session
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "summary.h"
+
+/*
+ * ============================================================================
+ * Summary Functions
+ * ============================================================================
+ */
+
+void summary_reset(summary_t *summary)
+{
+    histogram_reset(&summary->used);
+    histogram_reset(&summary->available);
+    histogram_reset(&summary->compressed);
+    histogram_reset(&summary->swap_used);
+    summary->first = 0;
+    summary->last  = 0;
+}
+
+void summary_add(summary_t *summary, const system_memory_t *sys_mem)
+{
+    if (summary_count(summary) == 0)
+    {
+        summary->first = sys_mem->timestamp;
+    }
+    summary->last = sys_mem->timestamp;
+
+    histogram_record(&summary->used, sys_mem->mem.used);
+    histogram_record(&summary->available, sys_mem->mem.available);
+    histogram_record(&summary->compressed, sys_mem->mem.compressed);
+    histogram_record(&summary->swap_used, sys_mem->swap.used);
+}
+
+uint64_t summary_count(const summary_t *summary)
+{
+    return summary->used.total;
+}
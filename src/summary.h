@@ -0,0 +1,65 @@
+/*
+ * summary.h - Percentile summaries of a watch session
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef SUMMARY_H
+#define SUMMARY_H
+
+#include "histogram.h"
+#include "memory.h"
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Session summary
+ *
+ * One histogram per summarized field. Memory use is fixed, so a summary
+ * can run for as long as the watch loop does.
+ */
+typedef struct
+{
+    histogram_t used;       /* mem.used */
+    histogram_t available;  /* mem.available */
+    histogram_t compressed; /* mem.compressed */
+    histogram_t swap_used;  /* swap.used */
+    uint64_t    first;      /* Monotonic time of the first sample */
+    uint64_t    last;       /* Monotonic time of the latest sample */
+} summary_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Empty a summary
+ *
+ * @param summary   Summary to reset
+ */
+void summary_reset(summary_t *summary);
+
+/**
+ * Add a sample to a summary
+ *
+ * @param summary   Summary to add to
+ * @param sys_mem   Sample to add
+ */
+void summary_add(summary_t *summary, const system_memory_t *sys_mem);
+
+/**
+ * Number of samples in a summary
+ *
+ * @param summary   Summary to query
+ * @return          Samples added since the last reset
+ */
+uint64_t summary_count(const summary_t *summary);
+
+#endif /* SUMMARY_H */
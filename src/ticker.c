@@ -0,0 +1,174 @@
+/*
+ * ticker.c - Drift-free periodic scheduling implementation
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "ticker.h"
+
+#include "utils.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * ============================================================================
+ * Sleep Functions
+ * ============================================================================
+ */
+
+/*
+ * Linux has clock_nanosleep() with TIMER_ABSTIME; macOS does not, so there
+ * we sleep for the remaining time, which is recomputed from the absolute
+ * deadline on every call.
+ */
+int ticker_sleep_until(uint64_t deadline)
+{
+#ifdef __APPLE__
+    uint64_t now = monotonic_ns();
+    if (now >= deadline)
+    {
+        return 0;
+    }
+
+    uint64_t        remaining = deadline - now;
+    struct timespec ts        = {
+               .tv_sec  = (time_t)(remaining / NSEC_PER_SEC),
+               .tv_nsec = (long)(remaining % NSEC_PER_SEC),
+    };
+
+    return nanosleep(&ts, NULL) == 0 ? 0 : -1;
+#else
+    struct timespec ts = {
+        .tv_sec  = (time_t)(deadline / NSEC_PER_SEC),
+        .tv_nsec = (long)(deadline % NSEC_PER_SEC),
+    };
+
+    int err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    if (err != 0)
+    {
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+#endif
+}
+
+/*
+ * ============================================================================
+ * Ticker Functions
+ * ============================================================================
+ */
+
+void ticker_init(ticker_t *ticker, uint64_t interval)
+{
+    ticker->interval = interval;
+    ticker->deadline = monotonic_ns() + interval;
+    ticker->ticks    = 0;
+    ticker->missed   = 0;
+}
+
+/* Skip the deadlines that passed while we were busy */
+static uint64_t skip_missed(ticker_t *ticker, uint64_t now)
+{
+    uint64_t missed = 0;
+
+    if (now >= ticker->deadline + ticker->interval)
+    {
+        missed = (now - ticker->deadline) / ticker->interval;
+        ticker->deadline += missed * ticker->interval;
+        ticker->missed += missed;
+    }
+
+    return missed;
+}
+
+int64_t ticker_wait(ticker_t *ticker)
+{
+    uint64_t missed = skip_missed(ticker, monotonic_ns());
+
+    /* Sleep until the deadline; retried only if it hasn't been reached */
+    while (monotonic_ns() < ticker->deadline)
+    {
+        if (ticker_sleep_until(ticker->deadline) != 0 && errno == EINTR)
+        {
+            return -1;
+        }
+    }
+
+    ticker->deadline += ticker->interval;
+    ticker->ticks++;
+
+    return (int64_t)missed;
+}
+
+int64_t ticker_advance(ticker_t *ticker)
+{
+    uint64_t now = monotonic_ns();
+
+    if (now < ticker->deadline)
+    {
+        return -1;
+    }
+
+    uint64_t missed = skip_missed(ticker, now);
+
+    ticker->deadline += ticker->interval;
+    ticker->ticks++;
+
+    return (int64_t)missed;
+}
+
+void ticker_reschedule(ticker_t *ticker, uint64_t interval, uint64_t from)
+{
+    ticker->interval = interval;
+    ticker->deadline = from + interval;
+}
+
+int ticker_timeout_ms(const ticker_t *ticker)
+{
+    uint64_t now = monotonic_ns();
+
+    if (now >= ticker->deadline)
+    {
+        return 0;
+    }
+
+    /* Round up so we never wake just before the deadline */
+    uint64_t ms = (ticker->deadline - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+    return ms > INT_MAX ? INT_MAX : (int)ms;
+}
+
+int parse_interval(const char *str, uint64_t *interval)
+{
+    char  *end;
+    double seconds;
+
+    if (str == NULL || interval == NULL)
+    {
+        return -1;
+    }
+
+    errno   = 0;
+    seconds = strtod(str, &end);
+
+    if (errno != 0 || end == str || *end != '\0' || !isfinite(seconds))
+    {
+        return -1;
+    }
+
+    /* Reject anything that would overflow 64-bit nanoseconds */
+    if (seconds * (double)NSEC_PER_SEC < (double)TICKER_MIN_INTERVAL ||
+        seconds > 1e9)
+    {
+        return -1;
+    }
+
+    *interval = (uint64_t)(seconds * (double)NSEC_PER_SEC + 0.5);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * ticker.h - Drift-free periodic scheduling
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef TICKER_H
+#define TICKER_H
+
+#include <stdint.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define NSEC_PER_SEC  1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+
+/* Shortest supported refresh interval (10ms) */
+#define TICKER_MIN_INTERVAL (10 * NSEC_PER_MSEC)
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Periodic ticker
+ *
+ * Deadlines are absolute points on the monotonic clock spaced exactly
+ * one interval apart, so the time spent sampling and rendering does not
+ * accumulate into drift.
+ */
+typedef struct
+{
+    uint64_t interval; /* Tick interval in nanoseconds */
+    uint64_t deadline; /* Next absolute deadline in nanoseconds */
+    uint64_t ticks;    /* Deadlines reached */
+    uint64_t missed;   /* Deadlines skipped because we were late */
+} ticker_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Start a ticker; the first deadline is one interval from now
+ *
+ * @param ticker    Ticker to initialize
+ * @param interval  Interval in nanoseconds
+ */
+void ticker_init(ticker_t *ticker, uint64_t interval);
+
+/**
+ * Sleep until the next deadline
+ *
+ * If one or more whole intervals have already passed, those deadlines
+ * are skipped (not made up for) and counted as missed.
+ *
+ * @param ticker    Ticker to wait on
+ * @return          Deadlines missed before this one, or -1 if a signal
+ *                  interrupted the sleep
+ */
+int64_t ticker_wait(ticker_t *ticker);
+
+/**
+ * Advance past the current deadline without sleeping
+ *
+ * For event loops that wait in poll() themselves, using
+ * ticker_timeout_ms() as the timeout. Missed deadlines are skipped and
+ * counted as in ticker_wait().
+ *
+ * @param ticker    Ticker to advance
+ * @return          Deadlines missed before this one, or -1 if the
+ *                  deadline has not been reached yet
+ */
+int64_t ticker_advance(ticker_t *ticker);
+
+/**
+ * Change the interval
+ *
+ * The next deadline becomes one new interval after from; deadlines
+ * already behind by then are skipped by the next wait as usual.
+ *
+ * @param ticker    Ticker to change
+ * @param interval  New interval in nanoseconds
+ * @param from      Monotonic time to count from, e.g. the last tick
+ */
+void ticker_reschedule(ticker_t *ticker, uint64_t interval, uint64_t from);
+
+/**
+ * Milliseconds until the next deadline, rounded up
+ *
+ * @param ticker    Ticker to query
+ * @return          Timeout suitable for poll(), 0 if already due
+ */
+int ticker_timeout_ms(const ticker_t *ticker);
+
+/**
+ * Sleep until an absolute point on the monotonic clock
+ *
+ * @param deadline  Deadline in nanoseconds, as returned by monotonic_ns()
+ * @return          0 when reached or already past, -1 on error or signal
+ *                  (errno set)
+ */
+int ticker_sleep_until(uint64_t deadline);
+
+/**
+ * Parse an interval in (possibly fractional) seconds
+ *
+ * @param str       String such as "2", "0.5" or "0.05"
+ * @param interval  Parsed interval in nanoseconds
+ * @return          0 on success, -1 if invalid or below TICKER_MIN_INTERVAL
+ */
+int parse_interval(const char *str, uint64_t *interval);
+
+#endif /* TICKER_H */
@@ -0,0 +1,464 @@
+/*
+ * trend.c - Memory trends, exhaustion forecasts and alert hooks
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "trend.h"
+
+#include "ticker.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/*
+ * ============================================================================
+ * Trend Functions
+ * ============================================================================
+ */
+
+void trend_init(trend_t *trend)
+{
+    memset(trend, 0, sizeof(trend_t));
+    trend->exhaustion = -1.0;
+}
+
+double least_squares_slope(const double *t, const double *y, size_t n,
+                           double t_ref)
+{
+    double sum_t  = 0.0;
+    double sum_y  = 0.0;
+    double sum_tt = 0.0;
+    double sum_ty = 0.0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        /* Center on the reference time to keep the sums well conditioned */
+        double ti = t[i] - t_ref;
+
+        sum_t += ti;
+        sum_y += y[i];
+        sum_tt += ti * ti;
+        sum_ty += ti * y[i];
+    }
+
+    double denom = (double)n * sum_tt - sum_t * sum_t;
+    if (denom <= 0.0)
+    {
+        return 0.0;
+    }
+
+    return ((double)n * sum_ty - sum_t * sum_y) / denom;
+}
+
+/* Least squares slope of y over the window, in units per second */
+static double window_slope(const trend_t *trend, const double *y)
+{
+    return least_squares_slope(trend->t, y, trend->len, trend->last_t);
+}
+
+void trend_update(trend_t *trend, const system_memory_t *sys_mem)
+{
+    double available = (double)sys_mem->mem.available;
+    double swap_used = (double)sys_mem->swap.used;
+
+    if (trend->len == 0)
+    {
+        trend->origin         = sys_mem->timestamp;
+        trend->last_t         = 0.0;
+        trend->available_ewma = available;
+        trend->swap_used_ewma = swap_used;
+    }
+    else
+    {
+        if (sys_mem->timestamp <= trend->origin)
+        {
+            return;
+        }
+
+        double t  = (double)(sys_mem->timestamp - trend->origin) / NSEC_PER_SEC;
+        double dt = t - trend->last_t;
+        if (dt <= 0.0)
+        {
+            return;
+        }
+
+        /* First-order EWMA weight for an irregular sample spacing */
+        double alpha = dt / (TREND_EWMA_SECONDS + dt);
+
+        trend->available_ewma += alpha * (available - trend->available_ewma);
+        trend->swap_used_ewma += alpha * (swap_used - trend->swap_used_ewma);
+        trend->last_t = t;
+    }
+
+    trend->t[trend->head]         = trend->last_t;
+    trend->available[trend->head] = available;
+    trend->swap_used[trend->head] = swap_used;
+    trend->head                   = (trend->head + 1) % TREND_WINDOW;
+    if (trend->len < TREND_WINDOW)
+    {
+        trend->len++;
+    }
+
+    trend->pressure        = calculate_memory_pressure(sys_mem);
+    trend->pressure_kernel = (int)sys_mem->pressure.valid;
+    trend->exhaustion      = -1.0;
+
+    if (trend->len < TREND_MIN_POINTS)
+    {
+        trend->available_slope = 0.0;
+        trend->swap_slope      = 0.0;
+        return;
+    }
+
+    trend->available_slope = window_slope(trend, trend->available);
+    trend->swap_slope      = window_slope(trend, trend->swap_used);
+
+    /* Time until available memory reaches zero at the current slope */
+    if (trend->available_slope < 0.0)
+    {
+        trend->exhaustion = trend->available_ewma / -trend->available_slope;
+    }
+
+    /* Or until swap fills up, whichever comes first */
+    if (trend->swap_slope > 0.0 && sys_mem->swap.total > 0)
+    {
+        double headroom = (double)sys_mem->swap.total - trend->swap_used_ewma;
+        double seconds  = headroom > 0.0 ? headroom / trend->swap_slope : 0.0;
+
+        if (trend->exhaustion < 0.0 || seconds < trend->exhaustion)
+        {
+            trend->exhaustion = seconds;
+        }
+    }
+}
+
+/*
+ * ============================================================================
+ * Alert Functions
+ * ============================================================================
+ */
+
+void alert_init(alert_t *alert, const options_t *opts)
+{
+    memset(alert, 0, sizeof(alert_t));
+    alert->cmd      = opts->alert_cmd;
+    alert->fd       = opts->alert_fd;
+    alert->tte      = opts->alert_tte;
+    alert->pressure = opts->alert_pressure;
+    alert->fd_flags = -1;
+}
+
+int alert_open(alert_t *alert)
+{
+    struct stat st;
+
+    if (alert->fd < 0)
+    {
+        return 0;
+    }
+
+    int flags = fcntl(alert->fd, F_GETFL);
+    if (flags < 0 || fstat(alert->fd, &st) != 0)
+    {
+        perror("alert fd");
+        return -1;
+    }
+
+    /* Files and terminals do not stall on a reader; leave them be */
+    if (!S_ISFIFO(st.st_mode) && !S_ISSOCK(st.st_mode))
+    {
+        return 0;
+    }
+
+    /*
+     * Flags belong to the open file description, so the only way to tell
+     * whether stdout shares it is to look at stdout after the change
+     */
+    int out = fcntl(STDOUT_FILENO, F_GETFL);
+    if (fcntl(alert->fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        perror("fcntl alert fd");
+        return -1;
+    }
+    alert->fd_flags = flags;
+
+    if (alert->fd == STDOUT_FILENO ||
+        (out >= 0 && !(out & O_NONBLOCK) &&
+         (fcntl(STDOUT_FILENO, F_GETFL) & O_NONBLOCK)))
+    {
+        fcntl(alert->fd, F_SETFL, flags);
+        alert->fd_flags = -1;
+        fprintf(stderr, "Error: --alert-fd %d shares standard output; give "
+                        "alerts a pipe of their own\n",
+                alert->fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Variables the hook gets; inherited ones of the same name are dropped */
+static const char *const hook_vars[] = {"FREE_EVENT=", "FREE_PRESSURE=",
+                                        "FREE_EXHAUSTION=", "FREE_AVAILABLE="};
+
+#define HOOK_NVARS (sizeof(hook_vars) / sizeof(hook_vars[0]))
+
+static int is_hook_var(const char *entry)
+{
+    for (size_t i = 0; i < HOOK_NVARS; i++)
+    {
+        if (strncmp(entry, hook_vars[i], strlen(hook_vars[i])) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Forget hooks that have exited; only our own children are waited for */
+static void reap_hooks(alert_t *alert)
+{
+    size_t i = 0;
+
+    while (i < alert->running)
+    {
+        if (waitpid(alert->hooks[i], NULL, WNOHANG) == 0)
+        {
+            i++;
+            continue;
+        }
+        alert->hooks[i] = alert->hooks[--alert->running];
+    }
+}
+
+/*
+ * Start the hook command without waiting for it
+ *
+ * The environment is built before the child exists and handed to
+ * posix_spawn(): other threads (--async, --top) may hold the malloc
+ * lock, so the child must not call anything but exec.
+ */
+static void run_command(alert_t *alert, const char *event,
+                        const trend_t *trend, const system_memory_t *sys_mem)
+{
+    char  vars[HOOK_NVARS][64];
+    char  sh[]   = "sh";
+    char  flag[] = "-c";
+    char *argv[] = {sh, flag, (char *)alert->cmd, NULL};
+    pid_t pid;
+
+    if (alert->running == ALERT_MAX_HOOKS)
+    {
+        fprintf(stderr, "Warning: %d alert hooks still running, not "
+                        "starting another\n",
+                ALERT_MAX_HOOKS);
+        return;
+    }
+
+    snprintf(vars[0], sizeof(vars[0]), "%s%s", hook_vars[0], event);
+    snprintf(vars[1], sizeof(vars[1]), "%s%.3f", hook_vars[1],
+             trend->pressure);
+    snprintf(vars[2], sizeof(vars[2]), "%s%.0f", hook_vars[2],
+             trend->exhaustion);
+    snprintf(vars[3], sizeof(vars[3]), "%s%llu", hook_vars[3],
+             (unsigned long long)sys_mem->mem.available);
+
+    size_t count = 0;
+    while (environ[count] != NULL)
+    {
+        count++;
+    }
+
+    char **envp = malloc((count + HOOK_NVARS + 1) * sizeof(char *));
+    if (envp == NULL)
+    {
+        perror("malloc");
+        return;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_hook_var(environ[i]))
+        {
+            envp[n++] = environ[i];
+        }
+    }
+    for (size_t i = 0; i < HOOK_NVARS; i++)
+    {
+        envp[n++] = vars[i];
+    }
+    envp[n] = NULL;
+
+    int rc = posix_spawn(&pid, "/bin/sh", NULL, NULL, argv, envp);
+    free(envp);
+    if (rc != 0)
+    {
+        errno = rc;
+        perror("posix_spawn");
+        return;
+    }
+
+    alert->hooks[alert->running++] = pid;
+}
+
+/* Write one JSON line describing the transition */
+static void write_event(alert_t *alert, const char *event,
+                        const trend_t *trend, const system_memory_t *sys_mem)
+{
+    char line[256];
+
+    int len = snprintf(
+        line, sizeof(line),
+        "{\"event\":\"%s\",\"time\":%llu.%03llu,\"pressure\":%.3f,"
+        "\"exhaustion\":%.0f,\"available\":%llu,\"available_slope\":%.0f,"
+        "\"swap_used\":%llu,\"swap_slope\":%.0f}\n",
+        event, (unsigned long long)(sys_mem->walltime / NSEC_PER_SEC),
+        (unsigned long long)(sys_mem->walltime % NSEC_PER_SEC / NSEC_PER_MSEC),
+        trend->pressure, trend->exhaustion,
+        (unsigned long long)sys_mem->mem.available, trend->available_slope,
+        (unsigned long long)sys_mem->swap.used, trend->swap_slope);
+
+    if (len < 0 || (size_t)len >= sizeof(line))
+    {
+        return;
+    }
+
+    /*
+     * A pipe or socket is non-blocking (alert_open). A line this short is
+     * below PIPE_BUF, so a pipe takes all of it or none.
+     */
+    if (write(alert->fd, line, (size_t)len) < 0)
+    {
+        alert->dropped++;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            fprintf(stderr, "Warning: alert reader fell behind, %s event "
+                            "dropped\n",
+                    event);
+        }
+        else
+        {
+            perror("write alert fd");
+        }
+    }
+}
+
+/*
+ * The estimate runs high on any busy machine, while a tenth of the time
+ * stalled on memory is already severe, so each source has its own default
+ */
+static double pressure_threshold(const alert_t *alert, const trend_t *trend)
+{
+    if (alert->pressure > 0.0)
+    {
+        return alert->pressure;
+    }
+
+    return trend->pressure_kernel ? ALERT_DEFAULT_STALL
+                                  : ALERT_DEFAULT_PRESSURE;
+}
+
+int alert_check(alert_t *alert, const trend_t *trend,
+                const system_memory_t *sys_mem)
+{
+    double threshold = pressure_threshold(alert, trend);
+
+    int exhausting = trend->exhaustion >= 0.0 && trend->exhaustion < alert->tte;
+    int recovered  = trend->exhaustion < 0.0 ||
+                    trend->exhaustion > 2.0 * alert->tte;
+    int pressured  = trend->pressure >= threshold;
+    int relieved   = trend->pressure < threshold - ALERT_PRESSURE_HYSTERESIS;
+
+    reap_hooks(alert);
+
+    if (alert->active ? !(recovered && relieved) : !(exhausting || pressured))
+    {
+        return 0;
+    }
+
+    alert->active = !alert->active;
+    alert->fired++;
+
+    const char *event = alert->active ? "alert" : "clear";
+
+    if (alert->fd >= 0)
+    {
+        write_event(alert, event, trend, sys_mem);
+    }
+    if (alert->cmd != NULL)
+    {
+        run_command(alert, event, trend, sys_mem);
+    }
+
+    return 1;
+}
+
+void alert_cleanup(alert_t *alert)
+{
+    reap_hooks(alert);
+
+    if (alert->fd_flags >= 0)
+    {
+        fcntl(alert->fd, F_SETFL, alert->fd_flags);
+        alert->fd_flags = -1;
+    }
+
+    if (alert->dropped > 0)
+    {
+        fprintf(stderr, "Warning: %llu alert event(s) dropped in total\n",
+                (unsigned long long)alert->dropped);
+    }
+}
+
+/*
+ * ============================================================================
+ * Formatting Functions
+ * ============================================================================
+ */
+
+void format_duration(double seconds, char *buf, size_t bufsize)
+{
+    if (seconds < 0.0)
+    {
+        snprintf(buf, bufsize, "-");
+        return;
+    }
+
+    /* A nearly flat trend forecasts absurd times; don't print them */
+    if (seconds >= 100.0 * 86400.0)
+    {
+        snprintf(buf, bufsize, ">99d");
+        return;
+    }
+
+    unsigned long long s = (unsigned long long)(seconds + 0.5);
+
+    if (s < 60)
+    {
+        snprintf(buf, bufsize, "%llus", s);
+    }
+    else if (s < 3600)
+    {
+        snprintf(buf, bufsize, "%llum%02llus", s / 60, s % 60);
+    }
+    else if (s < 86400)
+    {
+        snprintf(buf, bufsize, "%lluh%02llum", s / 3600, s % 3600 / 60);
+    }
+    else
+    {
+        snprintf(buf, bufsize, "%llud%02lluh", s / 86400, s % 86400 / 3600);
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * trend.h - Memory trends, exhaustion forecasts and alert hooks
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef TREND_H
+#define TREND_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <sys/types.h>
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define TREND_WINDOW       60   /* Samples in the regression window */
+#define TREND_MIN_POINTS   3    /* Samples needed before forecasting */
+#define TREND_EWMA_SECONDS 10.0 /* EWMA time constant */
+
+/* Default alert thresholds */
+#define ALERT_DEFAULT_TTE      60.0 /* Seconds until exhaustion */
+#define ALERT_DEFAULT_PRESSURE 0.9  /* Estimated pressure ratio */
+#define ALERT_DEFAULT_STALL    0.1  /* Kernel pressure: share of time stalled */
+
+/* An alert clears only once pressure drops this far below its threshold */
+#define ALERT_PRESSURE_HYSTERESIS 0.05
+
+/* Hook commands that may run at once; further transitions skip the hook */
+#define ALERT_MAX_HOOKS 8
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * Trend state
+ *
+ * Smooths available memory and swap usage with an EWMA and fits a least
+ * squares line over the last TREND_WINDOW samples. The EWMA gives the
+ * current level, the regression slope the direction; together they
+ * forecast how long until either runs out.
+ */
+typedef struct
+{
+    double   t[TREND_WINDOW];         /* Sample times, s since the first */
+    double   available[TREND_WINDOW]; /* Available memory, bytes */
+    double   swap_used[TREND_WINDOW]; /* Swap used, bytes */
+    size_t   len;                     /* Samples in the window */
+    size_t   head;                    /* Slot for the next sample */
+    uint64_t origin;                  /* Monotonic time of the first sample */
+    double   last_t;                  /* Time of the latest sample */
+    double   available_ewma;          /* Smoothed available memory */
+    double   swap_used_ewma;          /* Smoothed swap used */
+    double   available_slope;         /* Bytes per second (< 0 shrinking) */
+    double   swap_slope;              /* Bytes per second (> 0 growing) */
+    double   exhaustion;              /* Seconds until exhaustion, -1 = none */
+    double   pressure;                /* Latest memory pressure, 0.0 - 1.0 */
+    int      pressure_kernel;         /* Pressure came from the kernel */
+} trend_t;
+
+/* Alert hook configuration and state */
+typedef struct
+{
+    const char *cmd;                    /* Shell command run per transition */
+    int         fd;                     /* Descriptor written to, or -1 */
+    double      tte;                    /* Exhaustion threshold in seconds */
+    double      pressure;               /* Pressure threshold, 0 = default */
+    int         active;                 /* Currently alerting */
+    uint64_t    fired;                  /* Transitions reported */
+    int         fd_flags;               /* Flags to restore, or -1 */
+    uint64_t    dropped;                /* Events the fd's reader missed */
+    pid_t       hooks[ALERT_MAX_HOOKS]; /* Hook commands still running */
+    size_t      running;                /* Entries in hooks */
+} alert_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Reset a trend to no samples
+ *
+ * @param trend     Trend to initialize
+ */
+void trend_init(trend_t *trend);
+
+/**
+ * Add a sample and update the EWMAs, slopes and forecast
+ *
+ * Samples not newer than the previous one are ignored.
+ *
+ * @param trend     Trend to update
+ * @param sys_mem   New sample
+ */
+void trend_update(trend_t *trend, const system_memory_t *sys_mem);
+
+/**
+ * Least squares slope of y over t
+ *
+ * The order of the points does not matter, so ring buffers can be passed
+ * as they are.
+ *
+ * @param t         Sample times
+ * @param y         Sample values
+ * @param n         Number of points
+ * @param t_ref     Time near the points, subtracted for precision
+ * @return          dy/dt, or 0.0 with fewer than two distinct times
+ */
+double least_squares_slope(const double *t, const double *y, size_t n,
+                           double t_ref);
+
+/**
+ * Configure alert hooks from the command line options
+ *
+ * @param alert     Alert to initialize
+ * @param opts      Options (alert_cmd, alert_fd, alert_tte, alert_pressure)
+ */
+void alert_init(alert_t *alert, const options_t *opts);
+
+/**
+ * Prepare the alert descriptor for writing from the sampling loop
+ *
+ * A pipe or socket is switched to non-blocking mode, so a reader that
+ * stops costs events rather than samples; alert_cleanup() restores its
+ * flags. Files and terminals are left as they are. A pipe or socket
+ * shared with standard output is refused: the frames written there
+ * must not see EAGAIN.
+ *
+ * @param alert     Configured alert
+ * @return          0 on success, -1 on error
+ */
+int alert_open(alert_t *alert);
+
+/**
+ * Check the thresholds and run the hooks if the alert state changed
+ *
+ * The alert starts when exhaustion is forecast within the threshold or
+ * pressure reaches its threshold, and clears when the forecast is more
+ * than twice the threshold away and pressure has dropped by
+ * ALERT_PRESSURE_HYSTERESIS. The command runs asynchronously; it is not
+ * waited for, but reaped on a later check. Events the descriptor cannot
+ * take at once are dropped and counted.
+ *
+ * @param alert     Alert to check
+ * @param trend     Up-to-date trend
+ * @param sys_mem   Latest sample
+ * @return          1 if the state changed, 0 otherwise
+ */
+int alert_check(alert_t *alert, const trend_t *trend,
+                const system_memory_t *sys_mem);
+
+/**
+ * Reap finished hook commands, restore the descriptor's flags and report
+ * dropped events on stderr
+ *
+ * Hooks still running are left to finish on their own.
+ *
+ * @param alert     Alert to clean up
+ */
+void alert_cleanup(alert_t *alert);
+
+/**
+ * Format a duration compactly ("42s", "5m12s", "3h04m", "2d05h")
+ *
+ * @param seconds   Duration, or a negative value for none ("-")
+ * @param buf       Output buffer
+ * @param bufsize   Size of buf
+ */
+void format_duration(double seconds, char *buf, size_t bufsize);
+
+#endif /* TREND_H */
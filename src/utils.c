@@ -7,8 +7,16 @@
 
 #include "utils.h"
 
+#include "adaptive.h"
+#include "cgtree.h"
+#include "record.h"
+#include "shm.h"
+#include "trend.h"
+#include "watch.h"
+
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 /*
  * ============================================================================
@@ -43,29 +51,138 @@ double convert_unit(uint64_t bytes, unit_type_t unit)
     }
 }
 
-void format_human(uint64_t bytes, char *buf, size_t bufsize)
+/*
+ * Divide and round to nearest, ties to even, which is what printf does
+ * for the exactly representable quotients we deal with.
+ */
+static uint64_t div_round(uint64_t value, uint64_t divisor)
+{
+    uint64_t quot = value / divisor;
+    uint64_t rem  = value % divisor;
+
+    if (rem > divisor - rem || (rem == divisor - rem && (quot & 1)))
+    {
+        quot++;
+    }
+
+    return quot;
+}
+
+uint64_t scale_unit(uint64_t bytes, unit_type_t unit)
+{
+    switch (unit)
+    {
+        case UNIT_KIBI:
+            return div_round(bytes, BYTES_PER_KB);
+        case UNIT_MEBI:
+            return div_round(bytes, BYTES_PER_MB);
+        case UNIT_GIBI:
+            return div_round(bytes, BYTES_PER_GB);
+        case UNIT_TEBI:
+            return div_round(bytes, BYTES_PER_GB * 1024ULL);
+        case UNIT_KILO:
+            return div_round(bytes, 1000ULL);
+        case UNIT_MEGA:
+            return div_round(bytes, 1000000ULL);
+        case UNIT_GIGA:
+            return div_round(bytes, 1000000000ULL);
+        case UNIT_TERA:
+            return div_round(bytes, 1000000000000ULL);
+        case UNIT_BYTES:
+        case UNIT_HUMAN:
+        default:
+            return bytes;
+    }
+}
+
+size_t format_uint(uint64_t value, char *buf)
 {
+    char   tmp[UINT_BUF_SIZE];
+    size_t len = 0;
+
+    /* Emit digits in reverse, then copy them out in order */
+    do
+    {
+        tmp[len++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] = tmp[len - 1 - i];
+    }
+    buf[len] = '\0';
+
+    return len;
+}
+
+size_t format_human(uint64_t bytes, char *buf, size_t bufsize)
+{
+    char        tmp[UINT_BUF_SIZE + 8];
+    uint64_t    divisor;
+    const char *suffix;
+    size_t      len;
+
     if (buf == NULL || bufsize == 0)
     {
-        return;
+        return 0;
     }
 
     if (bytes >= BYTES_PER_GB)
     {
-        snprintf(buf, bufsize, "%.1fGi", (double)bytes / BYTES_PER_GB);
+        divisor = BYTES_PER_GB;
+        suffix  = "Gi";
     }
     else if (bytes >= BYTES_PER_MB)
     {
-        snprintf(buf, bufsize, "%.1fMi", (double)bytes / BYTES_PER_MB);
+        divisor = BYTES_PER_MB;
+        suffix  = "Mi";
     }
     else if (bytes >= BYTES_PER_KB)
     {
-        snprintf(buf, bufsize, "%.1fKi", (double)bytes / BYTES_PER_KB);
+        divisor = BYTES_PER_KB;
+        suffix  = "Ki";
     }
     else
     {
-        snprintf(buf, bufsize, "%lluB", (unsigned long long)bytes);
+        divisor = 1;
+        suffix  = "B";
     }
+
+    if (divisor == 1)
+    {
+        len = format_uint(bytes, tmp);
+    }
+    else
+    {
+        /* One decimal place: whole part plus rounded tenths */
+        uint64_t whole  = bytes / divisor;
+        uint64_t tenths = div_round((bytes % divisor) * 10, divisor);
+
+        if (tenths == 10)
+        {
+            whole++;
+            tenths = 0;
+        }
+
+        len        = format_uint(whole, tmp);
+        tmp[len++] = '.';
+        tmp[len++] = (char)('0' + tenths);
+    }
+
+    while (*suffix != '\0')
+    {
+        tmp[len++] = *suffix++;
+    }
+
+    if (len >= bufsize)
+    {
+        len = bufsize - 1;
+    }
+    memcpy(buf, tmp, len);
+    buf[len] = '\0';
+
+    return len;
 }
 
 const char *get_unit_suffix(unit_type_t unit)
@@ -97,6 +214,26 @@ const char *get_unit_suffix(unit_type_t unit)
     }
 }
 
+/*
+ * ============================================================================
+ * Time Functions
+ * ============================================================================
+ */
+
+uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 /*
  * ============================================================================
  * Options Functions
@@ -110,12 +247,60 @@ void init_options(options_t *opts)
         return;
     }
 
-    opts->unit    = UNIT_KIBI;
-    opts->wide    = 0;
-    opts->seconds = 0;
-    opts->count   = -1;
-    opts->totals  = 0;
-    opts->lohi    = 0;
+    opts->unit     = UNIT_KIBI;
+    opts->format   = FORMAT_TABLE;
+    opts->wide     = 0;
+    opts->interval = 0;
+    opts->count    = -1;
+    opts->totals   = 0;
+    opts->lohi     = 0;
+    opts->rates    = 0;
+
+    opts->record          = NULL;
+    opts->replay          = NULL;
+    opts->replay_speed    = 1.0;
+    opts->record_capacity = 0;
+
+    opts->daemon   = 0;
+    opts->shm      = 0;
+    opts->shm_name = SHM_DEFAULT_NAME;
+    opts->serve    = NULL;
+
+    opts->trend          = 0;
+    opts->alert_cmd      = NULL;
+    opts->alert_fd       = -1;
+    opts->alert_tte      = ALERT_DEFAULT_TTE;
+    opts->alert_pressure = 0.0; /* Chosen by where pressure comes from */
+
+    opts->summary          = 0;
+    opts->summary_interval = 0;
+    opts->stats            = 0;
+
+    opts->async      = 0;
+    opts->sink_count = 0;
+
+    opts->top      = 0;
+    opts->group_by = GROUP_NONE;
+
+    opts->watch_pids = NULL;
+    opts->leak_rate  = WATCH_DEFAULT_RATE;
+    opts->maps_pid   = 0;
+
+    opts->cgroup      = 0;
+    opts->cgroup_path = NULL;
+
+    opts->cgroup_tree = 0;
+    opts->tree_root   = NULL;
+    opts->tree_depth  = CGTREE_DEFAULT_DEPTH;
+    opts->tree_min    = 0;
+
+    opts->numa        = 0;
+    opts->hugepages   = 0;
+    opts->compression = 0;
+
+    opts->adaptive       = 0;
+    opts->adaptive_fast  = 0;
+    opts->adaptive_delta = 0;
 }
 
 /*
@@ -140,8 +325,91 @@ void print_usage(const char *prog_name)
     printf("  -h, --human         Display human-readable output\n");
     printf("  -w, --wide          Wide output (show all memory categories)\n");
     printf("  -t, --total         Show total for RAM + swap\n");
-    printf("  -s N, --seconds N   Repeat printing every N seconds\n");
+    printf("  -s N, --seconds N   Repeat printing every N seconds (may be\n");
+    printf("                      fractional, down to 0.01)\n");
     printf("  -c N, --count N     Repeat printing N times, then exit\n");
+    printf("      --format=FMT    Output format: table (default), json, csv\n");
+    printf("                      or openmetrics\n");
+    printf("      --rates         Show paging and compression rates\n");
+    printf("      --record FILE   Append each sample to a binary ring file\n");
+    printf("      --record-capacity N\n");
+    printf("                      Samples held when creating the ring file\n");
+    printf("                      (default: %d)\n", RECORD_DEFAULT_CAPACITY);
+    printf("      --replay FILE   Print the samples held in a ring file\n");
+    printf("      --speed X       Replay at X times the recorded speed\n");
+    printf("                      (default: 1, 0 = no delay)\n");
+    printf("      --adaptive[=F]  Sample every -s seconds while memory is\n");
+    printf("                      steady, every F seconds (default: -s / %d)\n",
+           ADAPTIVE_FAST_DIVISOR);
+    printf("                      while it moves or stalls\n");
+    printf("      --adapt-delta SIZE\n");
+    printf("                      Change per -s interval that counts as\n");
+    printf("                      moving (default: %d%% of total)\n",
+           ADAPTIVE_DELTA_PERCENT);
+    printf("      --daemon        Publish samples to shared memory every -s\n");
+    printf("                      seconds (default 1) instead of printing\n");
+    printf("      --shm           Read samples published by --daemon\n");
+    printf("      --shm-name NAME Shared memory object (default: %s)\n",
+           SHM_DEFAULT_NAME);
+    printf("      --serve PATH    Answer GET, HISTORY and SUBSCRIBE\n");
+    printf("                      requests on a Unix socket\n");
+    printf("      --trend         Show available and swap trends, the time\n");
+    printf("                      until exhaustion and memory pressure\n");
+    printf("      --alert-cmd CMD Run CMD via /bin/sh when an alert\n");
+    printf("                      starts or clears\n");
+    printf("      --alert-fd N    Write a JSON line to descriptor N when an\n");
+    printf("                      alert starts or clears\n");
+    printf("      --alert-tte S   Alert when exhaustion is forecast\n");
+    printf("                      within S seconds (default: %.0f)\n",
+           ALERT_DEFAULT_TTE);
+    printf("      --alert-pressure P\n");
+    printf("                      Alert when pressure reaches P, 0-1\n");
+    printf("                      (default: %.2f with kernel pressure,\n",
+           ALERT_DEFAULT_STALL);
+    printf("                      %.2f when estimated)\n",
+           ALERT_DEFAULT_PRESSURE);
+    printf("      --summary[=N]   Print p50/p95/p99/max of used, available,\n");
+    printf("                      compressed and swap used at exit, or for\n");
+    printf("                      each N-second window\n");
+    printf("  -l, --lohi          Show low and high watermarks and when\n");
+    printf("                      the peaks occurred\n");
+    printf("      --stats         On exit, report time per stage, drift,\n");
+    printf("                      CPU use and system calls of this tool\n");
+    printf("      --top N         List the N processes with the largest\n");
+    printf("                      footprint (resident + swap + compressed)\n");
+    printf("      --group-by KEY  With --top, sum processes per 'uid' or\n");
+    printf("                      'command'\n");
+    printf("      --watch-pid PID[,PID...]\n");
+    printf("                      Track each process's memory and flag\n");
+    printf("                      sustained growth as a suspected leak\n");
+    printf("      --leak-rate R   Growth flagged by --watch-pid, bytes per\n");
+    printf("                      hour with K/M/G suffix (default: 10M)\n");
+    printf("      --maps PID      Break PID's address space down into heap,\n");
+    printf("                      stack, anon, file, shared and huge pages\n");
+    printf("                      (Linux)\n");
+    printf("      --cgroup[=DIR]  Report the memory of our own cgroup (or\n");
+    printf("                      DIR): its limit as total, its usage as\n");
+    printf("                      used (Linux, cgroup v2)\n");
+    printf("      --cgroup-tree[=ROOT]\n");
+    printf("                      Print the memory of every cgroup below\n");
+    printf("                      ROOT (default: the cgroup v2 mount) as a\n");
+    printf("                      tree, largest first (Linux)\n");
+    printf("      --tree-depth N  Levels below the root to walk\n");
+    printf("                      (default: %d)\n", CGTREE_DEFAULT_DEPTH);
+    printf("      --tree-min SIZE Hide cgroups smaller than SIZE, bytes\n");
+    printf("                      with K/M/G suffix\n");
+    printf("      --numa          Show total, used, free, file and anon\n");
+    printf("                      memory and miss rates per NUMA node\n");
+    printf("      --hugepages     Show each hugetlb pool and transparent\n");
+    printf("                      huge page usage\n");
+    printf("      --compression   Show what zswap, zram or the macOS\n");
+    printf("                      compressor holds, the RAM it takes,\n");
+    printf("                      the ratio and compression rates\n");
+    printf("      --async         Render and write on a separate thread so\n");
+    printf("                      slow output never delays sampling\n");
+    printf("      --sink SPEC     With --async, write to SPEC: '-' for\n");
+    printf("                      stdout, unix:PATH, or a file to append\n");
+    printf("                      to; repeatable (implies --async)\n");
     printf("      --help          Display this help message\n");
     printf("  -V, --version       Display version information\n");
     printf("\n");
@@ -161,6 +429,19 @@ void print_usage(const char *prog_name)
     printf("  %s -hw         Human-readable, wide format\n", name);
     printf("  %s -s 2        Refresh every 2 seconds\n", name);
     printf("  %s -s 1 -c 5   Refresh 5 times, 1 second apart\n", name);
+    printf("  %s -s 0.05     Refresh every 50 milliseconds\n", name);
+    printf("  %s --format=json -s 1\n", name);
+    printf("                  Stream one JSON object per second\n");
+    printf("  %s -s 0.1 --record mem.ring\n", name);
+    printf("                  Record a sample every 100 milliseconds\n");
+    printf("  %s --replay mem.ring --speed 10\n", name);
+    printf("                  Replay a recording ten times faster\n");
+    printf("  %s --daemon -s 0.5 &  %s --shm -h\n", name, name);
+    printf("                  Sample once, read from many processes\n");
+    printf("  %s --serve /run/free.sock &\n", name);
+    printf("                  Serve samples to collectors over a socket\n");
+    printf("  %s -s 1 --alert-cmd 'systemctl stop batch.service'\n", name);
+    printf("                  Shed load before memory runs out\n");
     printf("\n");
 }
 
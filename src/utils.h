@@ -27,6 +27,15 @@
 
 #define PROGRAM_NAME "free"
 
+/* Buffer size for a 64-bit unsigned integer in decimal, plus NUL */
+#define UINT_BUF_SIZE 21
+
+/* Output destinations accepted by --sink */
+#define MAX_SINKS 4
+
+/* Processes accepted by --watch-pid */
+#define MAX_WATCH_PIDS 16
+
 /*
  * ============================================================================
  * Type Definitions
@@ -50,15 +59,70 @@ typedef enum
     UNIT_HUMAN // Auto-select appropriate unit
 } unit_type_t;
 
+/* Output formats */
+typedef enum
+{
+    FORMAT_TABLE,      // Column layout of free(1)
+    FORMAT_JSON,       // One JSON object per sample (JSON Lines)
+    FORMAT_CSV,        // Header line, then one line per sample
+    FORMAT_OPENMETRICS // One exposition per sample
+} output_format_t;
+
+/* How --top combines processes */
+typedef enum
+{
+    GROUP_NONE,   // One row per process
+    GROUP_UID,    // One row per user ID
+    GROUP_COMMAND // One row per command name
+} group_by_t;
+
 /* Command-line options */
 typedef struct
 {
-    unit_type_t unit;    /* Output unit */
-    int         wide;    /* Wide output mode */
-    int         seconds; /* Refresh interval (0 = no refresh) */
-    int         count;   /* Number of iterations (-1 = infinite) */
-    int         totals;  /* Show totals line */
-    int         lohi;    /* Show low/high memory stats */
+    unit_type_t     unit;             /* Output unit */
+    output_format_t format;           /* Output format */
+    int             wide;             /* Wide output mode */
+    uint64_t        interval;         /* Refresh interval, ns (0 = once) */
+    int             count;            /* Number of iterations (-1 = infinite) */
+    int             totals;           /* Show totals line */
+    int             lohi;             /* Show low/high memory stats */
+    int             rates;            /* Show paging/compression rates */
+    const char     *record;           /* Ring file to append samples to */
+    const char     *replay;           /* Ring file to replay */
+    double          replay_speed;     /* Replay speed factor (0 = no delay) */
+    uint64_t        record_capacity;  /* Slots when creating a ring file */
+    int             daemon;           /* Publish samples to shared memory */
+    int             shm;              /* Read samples from shared memory */
+    const char     *shm_name;         /* Shared memory object name */
+    const char     *serve;            /* Unix socket to serve samples on */
+    int             trend;            /* Show trend and exhaustion forecast */
+    const char     *alert_cmd;        /* Command run when an alert changes */
+    int             alert_fd;         /* Descriptor alerts are written to */
+    double          alert_tte;        /* Exhaustion alert threshold, s */
+    double          alert_pressure;   /* Pressure alert threshold, 0-1 */
+    int             summary;          /* Print percentile summaries */
+    uint64_t        summary_interval; /* Summary window, ns (0 = at exit) */
+    int             stats;            /* Report the loop's own overhead */
+    int             async;            /* Write output on its own thread */
+    const char     *sinks[MAX_SINKS]; /* Output destinations for --async */
+    int             sink_count;       /* Entries in sinks */
+    int             top;              /* Largest processes to list */
+    group_by_t      group_by;         /* How --top combines processes */
+    const char     *watch_pids;       /* Comma-separated PIDs to watch */
+    double          leak_rate;        /* Growth flagged, bytes per hour */
+    int             maps_pid;         /* Process to break down (0 = none) */
+    int             cgroup;           /* Report a cgroup's memory */
+    const char     *cgroup_path;      /* Its directory (NULL = our own) */
+    int             cgroup_tree;      /* Print the cgroup hierarchy */
+    const char     *tree_root;        /* Its root (NULL = the mount point) */
+    int             tree_depth;       /* Levels below the root walked */
+    uint64_t        tree_min;         /* Smallest cgroup shown, bytes */
+    int             numa;             /* Show one row per NUMA node */
+    int             hugepages;        /* Show huge page pools and THP */
+    int             compression;      /* Show compressed memory stores */
+    int             adaptive;         /* Sample faster while memory moves */
+    uint64_t        adaptive_fast;    /* Fast interval, ns (0 = -s / 10) */
+    uint64_t        adaptive_delta;   /* Movement that counts (0 = 1%) */
 } options_t;
 
 /*
@@ -76,14 +140,37 @@ typedef struct
  */
 double convert_unit(uint64_t bytes, unit_type_t unit);
 
+/**
+ * Convert bytes to specified unit, rounded to the nearest integer
+ *
+ * Integer-only equivalent of printf("%.0f", convert_unit(bytes, unit)).
+ *
+ * @param bytes     Number of bytes to convert
+ * @param unit      Target unit type
+ * @return          Converted value
+ */
+uint64_t scale_unit(uint64_t bytes, unit_type_t unit);
+
+/**
+ * Format an unsigned integer in decimal
+ *
+ * @param value     Value to format
+ * @param buf       Output buffer of at least UINT_BUF_SIZE bytes
+ * @return          Length of the string written (excluding NUL)
+ */
+size_t format_uint(uint64_t value, char *buf);
+
 /**
  * Format bytes as human-readable string
  *
+ * Uses fixed-point arithmetic; output matches "%.1fGi"-style formatting.
+ *
  * @param bytes     Number of bytes to format
  * @param buf       Output buffer
  * @param bufsize   Size of output buffer
+ * @return          Length of the string written (excluding NUL)
  */
-void format_human(uint64_t bytes, char *buf, size_t bufsize);
+size_t format_human(uint64_t bytes, char *buf, size_t bufsize);
 
 /**
  * Get unit suffix string
@@ -93,6 +180,20 @@ void format_human(uint64_t bytes, char *buf, size_t bufsize);
  */
 const char *get_unit_suffix(unit_type_t unit);
 
+/**
+ * Read the monotonic clock
+ *
+ * @return          Nanoseconds since an arbitrary fixed point
+ */
+uint64_t monotonic_ns(void);
+
+/**
+ * Read the wall clock
+ *
+ * @return          Nanoseconds since the Unix epoch
+ */
+uint64_t realtime_ns(void);
+
 /**
  * Print usage information
  *
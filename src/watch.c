@@ -0,0 +1,212 @@
+/*
+ * watch.c - Leak detection for watched processes
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#include "watch.h"
+
+#include "ticker.h"
+#include "trend.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ============================================================================
+ * Argument Parsing
+ * ============================================================================
+ */
+
+int parse_pid_list(const char *str, int *pids, int *count)
+{
+    const char *p = str;
+
+    *count = 0;
+
+    for (;;)
+    {
+        char *end;
+        long  pid;
+
+        errno = 0;
+        pid   = strtol(p, &end, 10);
+        if (errno != 0 || end == p || pid < 1 || pid > 0x7fffffffL ||
+            (*end != ',' && *end != '\0') || *count >= MAX_WATCH_PIDS)
+        {
+            return -1;
+        }
+
+        pids[(*count)++] = (int)pid;
+
+        if (*end == '\0')
+        {
+            return 0;
+        }
+        p = end + 1;
+    }
+}
+
+int parse_rate(const char *str, double *rate)
+{
+    char  *end;
+    double value;
+
+    errno = 0;
+    value = strtod(str, &end);
+    if (errno != 0 || end == str || !isfinite(value) || value <= 0.0)
+    {
+        return -1;
+    }
+
+    switch (*end)
+    {
+        case 'K':
+        case 'k':
+            value *= BYTES_PER_KB;
+            end++;
+            break;
+        case 'M':
+        case 'm':
+            value *= BYTES_PER_MB;
+            end++;
+            break;
+        case 'G':
+        case 'g':
+            value *= BYTES_PER_GB;
+            end++;
+            break;
+        default:
+            break;
+    }
+
+    if (*end != '\0')
+    {
+        return -1;
+    }
+
+    *rate = value;
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Watch Functions
+ * ============================================================================
+ */
+
+int watch_init(watch_t *watch, const options_t *opts)
+{
+    int pids[MAX_WATCH_PIDS];
+    int count;
+
+    memset(watch, 0, sizeof(watch_t));
+    watch->threshold = opts->leak_rate / 3600.0;
+
+    if (parse_pid_list(opts->watch_pids, pids, &count) != 0)
+    {
+        fprintf(stderr, "Error: Invalid PID list: %s\n", opts->watch_pids);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        watch_entry_t *entry = &watch->entries[i];
+
+        if (proc_open(&entry->handle, (pid_t)pids[i]) != 0)
+        {
+            fprintf(stderr, "Error: Cannot watch PID %d: %s\n", pids[i],
+                    strerror(errno));
+            watch_cleanup(watch);
+            return -1;
+        }
+        entry->alive = 1;
+        watch->count++;
+    }
+
+    return 0;
+}
+
+/* Add a sample to the window and re-fit the growth line */
+static void update_growth(watch_entry_t *entry, uint64_t now)
+{
+    double footprint = (double)(entry->usage.rss + entry->usage.swap +
+                                entry->usage.compressed);
+
+    if (entry->len == 0)
+    {
+        entry->origin = now;
+    }
+    entry->last_t = (double)(now - entry->origin) / NSEC_PER_SEC;
+
+    entry->t[entry->head] = entry->last_t;
+    entry->y[entry->head] = footprint;
+    entry->head           = (entry->head + 1) % WATCH_WINDOW;
+    if (entry->len < WATCH_WINDOW)
+    {
+        entry->len++;
+    }
+
+    entry->slope = entry->len >= WATCH_MIN_POINTS
+                       ? least_squares_slope(entry->t, entry->y, entry->len,
+                                             entry->last_t)
+                       : 0.0;
+}
+
+static void report(const watch_entry_t *entry, const char *what)
+{
+    fprintf(stderr, "Warning: PID %d (%s) %s: %+.1f MiB/h over the last "
+                    "%zu sample(s)\n",
+            (int)entry->handle.pid, entry->handle.name, what,
+            entry->slope * 3600.0 / BYTES_PER_MB, entry->len);
+}
+
+void watch_sample(watch_t *watch)
+{
+    for (size_t i = 0; i < watch->count; i++)
+    {
+        watch_entry_t *entry = &watch->entries[i];
+
+        if (!entry->alive)
+        {
+            continue;
+        }
+
+        if (proc_sample(&entry->handle, &entry->usage) != 0)
+        {
+            entry->alive = 0;
+            proc_close(&entry->handle);
+            continue;
+        }
+
+        update_growth(entry, monotonic_ns());
+
+        entry->rising = entry->slope > watch->threshold ? entry->rising + 1
+                                                        : 0;
+
+        /* Flag on sustained growth, clear only once growth stops */
+        if (!entry->leaking && entry->rising >= WATCH_SUSTAIN)
+        {
+            entry->leaking = 1;
+            report(entry, "keeps growing");
+        }
+        else if (entry->leaking && entry->slope <= 0.0)
+        {
+            entry->leaking = 0;
+            report(entry, "stopped growing");
+        }
+    }
+}
+
+void watch_cleanup(watch_t *watch)
+{
+    for (size_t i = 0; i < watch->count; i++)
+    {
+        proc_close(&watch->entries[i].handle);
+    }
+    watch->count = 0;
+}
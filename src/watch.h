@@ -0,0 +1,118 @@
+/*
+ * watch.h - Leak detection for watched processes
+ *
+ * Part of mac-free: A 'free' command replacement for macOS
+ * License: MIT
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "procs.h"
+#include "utils.h"
+
+/*
+ * ============================================================================
+ * Constants
+ * ============================================================================
+ */
+
+#define WATCH_WINDOW     120 /* Samples in each regression window */
+#define WATCH_MIN_POINTS 10  /* Samples needed before judging growth */
+#define WATCH_SUSTAIN    60  /* Samples the growth must persist for */
+
+/* Growth flagged by default: 10 MiB per hour */
+#define WATCH_DEFAULT_RATE (10.0 * 1024 * 1024)
+
+/*
+ * ============================================================================
+ * Type Definitions
+ * ============================================================================
+ */
+
+/*
+ * One watched process
+ *
+ * Fits a least squares line over the last WATCH_WINDOW samples of
+ * resident + swapped + compressed memory. A process is flagged once the
+ * slope has stayed above the threshold for WATCH_SUSTAIN samples in a
+ * row, and cleared once it is no longer growing at all, so noise around
+ * the threshold does not make it flap.
+ */
+typedef struct
+{
+    proc_handle_t handle;          /* Open process */
+    proc_usage_t  usage;           /* Latest sample */
+    double        t[WATCH_WINDOW]; /* Sample times, s since the first */
+    double        y[WATCH_WINDOW]; /* Footprint, bytes */
+    size_t        len;             /* Samples in the window */
+    size_t        head;            /* Slot for the next sample */
+    uint64_t      origin;          /* Monotonic time of the first sample */
+    double        last_t;          /* Time of the latest sample */
+    double        slope;           /* Growth, bytes per second */
+    uint64_t      rising;          /* Consecutive samples above threshold */
+    int           alive;           /* Still running */
+    int           leaking;         /* Flagged as a suspected leak */
+} watch_entry_t;
+
+/* All watched processes */
+typedef struct
+{
+    watch_entry_t entries[MAX_WATCH_PIDS]; /* Watched processes */
+    size_t        count;                   /* Entries in use */
+    double        threshold;               /* Growth flagged, bytes/s */
+} watch_t;
+
+/*
+ * ============================================================================
+ * Function Prototypes
+ * ============================================================================
+ */
+
+/**
+ * Parse a comma-separated PID list
+ *
+ * @param str       List from the command line, e.g. "123,456"
+ * @param pids      Output array of MAX_WATCH_PIDS entries
+ * @param count     Entries stored
+ * @return          0 on success, -1 on a malformed or too long list
+ */
+int parse_pid_list(const char *str, int *pids, int *count);
+
+/**
+ * Parse a growth rate in bytes per hour, with an optional K, M or G
+ * (binary) suffix
+ *
+ * @param str       Rate from the command line, e.g. "50M"
+ * @param rate      Parsed rate, bytes per hour
+ * @return          0 on success, -1 if invalid
+ */
+int parse_rate(const char *str, double *rate);
+
+/**
+ * Open every process to watch
+ *
+ * @param watch     Watch to initialize
+ * @param opts      Options (watch_pids, watch_count, leak_rate)
+ * @return          0 on success, -1 if a process cannot be opened
+ */
+int watch_init(watch_t *watch, const options_t *opts);
+
+/**
+ * Sample every live process and update its growth estimate
+ *
+ * Processes that exit are closed and kept, marked not alive. Changes in
+ * the leak flag are reported on stderr.
+ *
+ * @param watch     Initialized watch
+ */
+void watch_sample(watch_t *watch);
+
+/**
+ * Close all watched processes
+ *
+ * @param watch     Watch to clean up
+ */
+void watch_cleanup(watch_t *watch);
+
+#endif /* WATCH_H */